@@ -0,0 +1,579 @@
+/*  Scalability benchmark: runs N PMAP instances concurrently, each connected through a pty to its own
+    simulated console, and reports how throughput, latency, CPU usage, serial I/O and thread count change as N grows.
+    Every console runs the same jobs: intake (ident data), EEPROM dump and EEPROM update.
+    With --net, the consoles are served over TCP on localhost instead, like by serial servers on remote benches
+    (raw, or with the RFC 2217 negotiation answered).
+    Syntax: pmap-bench [--profile=<profile>] [--speed=<speed>] [--pmap=<path>] [--net=tcp|rfc2217[:<depth>]] [<N>...] */
+#ifdef __linux__
+#define _GNU_SOURCE // For posix_openpt() and cfmakeraw()
+#endif
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "../base/platform.h"
+#include "../base/sim.h"
+#include "../base/net.h"
+
+#define BENCH_MAX_CONSOLES 64
+#define BENCH_POLL_MS      20
+
+#define BENCH_NET_NONE     0
+#define BENCH_NET_TCP      1
+#define BENCH_NET_RFC2217  2
+
+// Choices of the main menu (main.c) and the EEPROM menu (MenuEEPROM() in eeprom-main.c) that the jobs make. Keep in step with the menus.
+#define BENCH_MAIN_EEPROM   "1"
+#define BENCH_MAIN_IDENT    "4"
+#define BENCH_MAIN_QUIT     "5"
+#define BENCH_EEPROM_DUMP   "2"
+#define BENCH_EEPROM_UPDATE "17"
+#define BENCH_EEPROM_QUIT   "19"
+
+// The work directory (for mkdtemp()), and room for the paths within it: <work directory>/<console>/pmap.out.
+#define BENCH_WORK_DIR      "/tmp/pmap-bench-XXXXXX"
+#define BENCH_PATH_MAX      (sizeof(BENCH_WORK_DIR) + 32)
+
+// Answers to the EEPROM update questions (MECHACON replaced, OP pre-check, optical block, object lens, proceed), per simulator profile.
+static const struct BenchProfile
+{
+    const char *name, *update;
+} BenchProfiles[] = {
+    {"md36", "n\n2\ny\n"},
+    {"f", "n\nn\n1\n2\ny\n"},
+    {"g", "n\nn\n1\ny\n"},
+    {"g2", "n\nn\n1\ny\n"},
+    {NULL, NULL}};
+
+struct BenchConsole
+{
+    pid_t sim, pmap;
+    u64 start, end;
+    unsigned char done, ok;
+    u64 calls, reads, ReadBytes; // I/O totals of the PMAP instance.
+    double drain;
+};
+
+static struct BenchConsole consoles[BENCH_MAX_CONSOLES];
+static char WorkDir[sizeof(BENCH_WORK_DIR)], jobs[128];
+static const char *NetDepth = "";
+static int SimFd, NetMode = BENCH_NET_NONE;
+static unsigned char TelnetState, TelnetSub[16], TelnetSubLen;
+
+// Answers COM Port Control requests by confirming them, like a serial server that accepts any setting.
+static void BenchTelnetReply(void)
+{
+    unsigned char frame[sizeof(TelnetSub) * 2 + 4];
+    int i, len;
+
+    if (TelnetSubLen < 2 || TelnetSub[0] != TELNET_OPT_COM_PORT || TelnetSub[1] >= COM_PORT_SERVER)
+        return;
+
+    frame[0] = TELNET_IAC;
+    frame[1] = TELNET_SB;
+    frame[2] = TELNET_OPT_COM_PORT;
+    frame[3] = TelnetSub[1] + COM_PORT_SERVER;
+    for (i = 2, len = 4; i < TelnetSubLen; i++)
+    {
+        frame[len++] = TelnetSub[i];
+        if (TelnetSub[i] == TELNET_IAC)
+            frame[len++] = TELNET_IAC;
+    }
+    frame[len++] = TELNET_IAC;
+    frame[len++] = TELNET_SE;
+    if (write(SimFd, frame, len) != len)
+        return;
+}
+
+// Removes the Telnet commands from the received data, in place. Option negotiation is not answered.
+static int BenchTelnetDecode(unsigned char *data, int n)
+{
+    int i, len;
+
+    for (i = 0, len = 0; i < n; i++)
+    {
+        switch (TelnetState)
+        {
+            case 0: // Data
+                if (data[i] == TELNET_IAC)
+                    TelnetState = 1;
+                else
+                    data[len++] = data[i];
+                break;
+            case 1: // IAC
+                if (data[i] == TELNET_IAC)
+                    data[len++] = data[i];
+                TelnetSubLen = 0;
+                TelnetState  = data[i] == TELNET_SB ? 3 : (data[i] >= TELNET_WILL && data[i] <= TELNET_DONT ? 2 : 0);
+                break;
+            case 2: // Option of WILL, WONT, DO or DONT
+                TelnetState = 0;
+                break;
+            case 3: // Subnegotiation
+                if (data[i] == TELNET_IAC)
+                    TelnetState = 4;
+                else if (TelnetSubLen < sizeof(TelnetSub))
+                    TelnetSub[TelnetSubLen++] = data[i];
+                break;
+            case 4: // IAC within a subnegotiation
+                if (data[i] == TELNET_SE)
+                {
+                    BenchTelnetReply();
+                    TelnetState = 0;
+                }
+                else
+                {
+                    if (TelnetSubLen < sizeof(TelnetSub))
+                        TelnetSub[TelnetSubLen++] = data[i];
+                    TelnetState = 3;
+                }
+                break;
+        }
+    }
+
+    return len;
+}
+
+static int BenchReceive(char *data, int n)
+{
+    int result;
+
+    do
+    {
+        while ((result = read(SimFd, data, n)) < 0 && errno == EINTR)
+            ;
+        if (result > 0 && NetMode == BENCH_NET_RFC2217 && (result = BenchTelnetDecode((unsigned char *)data, result)) == 0)
+            result = -EAGAIN; // Only Telnet commands were received.
+    } while (result == -EAGAIN);
+
+    return result;
+}
+
+static int BenchSend(const char *data, int n)
+{
+    return write(SimFd, data, n);
+}
+
+static pid_t BenchStartPTY(int index, const char *profile, const char *speed, char *port, size_t size)
+{
+    struct termios options;
+    char spec[64];
+    int master;
+    pid_t pid;
+
+    if ((master = posix_openpt(O_RDWR | O_NOCTTY)) < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+    {
+        PlatShowMessage("Cannot create a pty: %s\n", strerror(errno));
+        if (master >= 0)
+            close(master);
+        return -1;
+    }
+    snprintf(port, size, "%s", ptsname(master));
+    tcgetattr(master, &options);
+    cfmakeraw(&options);
+    tcsetattr(master, TCSANOW, &options);
+
+    fflush(stdout); // Or the child would write it out again.
+    if ((pid = fork()) == 0)
+    { // Keep the slave open, so that the link stays up while PMAP opens and configures it.
+        open(port, O_RDWR | O_NOCTTY);
+        if (freopen("/dev/null", "w", stdout) == NULL)
+            _exit(1);
+        SimFd = master;
+        snprintf(spec, sizeof(spec), "%s:%s:%d", profile, speed, index + 1);
+        _exit(SimServe(spec, &BenchReceive, &BenchSend) == 0 ? 0 : 1);
+    }
+    close(master);
+
+    return pid;
+}
+
+// A serial server stand-in: the simulator serves the first connection to a port on localhost.
+static pid_t BenchStartServer(int index, const char *profile, const char *speed, char *port, size_t size)
+{
+    struct sockaddr_in address;
+    socklen_t len;
+    char spec[64];
+    int listener, on;
+    pid_t pid;
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family      = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port        = 0; // Any free port
+    len                     = sizeof(address);
+    if ((listener = socket(AF_INET, SOCK_STREAM, 0)) < 0 || bind(listener, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+        listen(listener, 1) != 0 || getsockname(listener, (struct sockaddr *)&address, &len) != 0)
+    {
+        PlatShowMessage("Cannot create a server socket: %s\n", strerror(errno));
+        if (listener >= 0)
+            close(listener);
+        return -1;
+    }
+    snprintf(port, size, "%s:127.0.0.1:%u%s%s", NetMode == BENCH_NET_RFC2217 ? "rfc2217" : "tcp", ntohs(address.sin_port),
+             NetDepth[0] != '\0' ? ":" : "", NetDepth);
+
+    fflush(stdout);
+    if ((pid = fork()) == 0)
+    {
+        if (freopen("/dev/null", "w", stdout) == NULL || (SimFd = accept(listener, NULL, NULL)) < 0)
+            _exit(1);
+        close(listener);
+        on = 1; // Responses are sent as soon as they are ready, like by a serial server.
+        setsockopt(SimFd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        snprintf(spec, sizeof(spec), "%s:%s:%d", profile, speed, index + 1);
+        _exit(SimServe(spec, &BenchReceive, &BenchSend) == 0 ? 0 : 1);
+    }
+    close(listener);
+
+    return pid;
+}
+
+static pid_t BenchStartSim(int index, const char *profile, const char *speed, char *port, size_t size)
+{
+    return (NetMode != BENCH_NET_NONE ? BenchStartServer(index, profile, speed, port, size) : BenchStartPTY(index, profile, speed, port, size));
+}
+
+static pid_t BenchStartPMAP(int index, const char *pmap, const char *port)
+{
+    char dir[BENCH_PATH_MAX];
+    int fd;
+    pid_t pid;
+
+    snprintf(dir, sizeof(dir), "%s/%02d", WorkDir, index);
+    if (mkdir(dir, 0700) != 0 && errno != EEXIST)
+        return -1;
+
+    fflush(stdout);
+    if ((pid = fork()) == 0)
+    {
+        if (chdir(dir) != 0)
+            _exit(127);
+
+        if ((fd = open("jobs.txt", O_RDWR | O_CREAT | O_TRUNC, 0600)) < 0 || write(fd, jobs, strlen(jobs)) != (ssize_t)strlen(jobs))
+            _exit(127);
+        lseek(fd, 0, SEEK_SET);
+        dup2(fd, STDIN_FILENO);
+        close(fd);
+
+        if ((fd = open("pmap.out", O_WRONLY | O_CREAT | O_TRUNC, 0600)) < 0)
+            _exit(127);
+        dup2(fd, STDOUT_FILENO);
+        dup2(fd, STDERR_FILENO);
+        close(fd);
+
+        execl(pmap, pmap, port, (char *)NULL);
+        _exit(127);
+    }
+
+    return pid;
+}
+
+// All jobs completed, according to the output of the PMAP instance. Also reads the I/O totals of the instance.
+static unsigned char BenchCheckOutput(int index)
+{
+    char path[BENCH_PATH_MAX], line[256];
+    unsigned long long writes, reads, selects, wakeups;
+    double PerRead, drain, blocked;
+    unsigned char found;
+    FILE *file;
+
+    snprintf(path, sizeof(path), "%s/%02d/pmap.out", WorkDir, index);
+    if ((file = fopen(path, "r")) == NULL)
+        return 0;
+
+    found = 0;
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        if (strstr(line, "CFD:") != NULL)
+            found |= 1;
+        if (strstr(line, "Dump completed") != NULL)
+            found |= 2;
+        if (strstr(line, "EEPROM update: completed") != NULL)
+            found |= 4;
+        if (sscanf(line, "I/O total: %llu writes, %llu reads (%lf bytes/read), %llu selects, %llu empty wakeups, tcdrain %lfs, blocked %lfs",
+                   &writes, &reads, &PerRead, &selects, &wakeups, &drain, &blocked) == 7)
+        {
+            consoles[index].calls     = writes + reads + selects;
+            consoles[index].reads     = reads;
+            consoles[index].ReadBytes = (u64)(PerRead * reads + 0.5);
+            consoles[index].drain     = drain;
+        }
+    }
+    fclose(file);
+
+    return found == 7;
+}
+
+// Returns the number of threads of the process, or -1 if unknown (i.e. no procfs).
+static int BenchGetThreads(pid_t pid)
+{
+    char path[64], line[128];
+    FILE *file;
+    int threads;
+
+    snprintf(path, sizeof(path), "/proc/%d/status", (int)pid);
+    if ((file = fopen(path, "r")) == NULL)
+        return -1;
+
+    threads = -1;
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        if (!strncmp(line, "Threads:", 8))
+        {
+            threads = atoi(&line[8]);
+            break;
+        }
+    }
+    fclose(file);
+
+    return threads;
+}
+
+static double BenchCPUTime(const struct rusage *usage)
+{
+    return usage->ru_utime.tv_sec + usage->ru_utime.tv_usec / 1e6 + usage->ru_stime.tv_sec + usage->ru_stime.tv_usec / 1e6;
+}
+
+static int BenchRemove(const char *path, const struct stat *st, int flag, struct FTW *ftw)
+{
+    (void)st;
+    (void)flag;
+    (void)ftw;
+
+    return remove(path);
+}
+
+static int BenchRun(int count, const char *profile, const char *speed, const char *pmap, double *BaseLatency)
+{
+    struct BenchConsole *console;
+    struct rusage usage;
+    char port[64];
+    double PMAPCPU, SimCPU, wall, mean, longest, drain;
+    int i, running, status, threads, PeakThreads, sample, completed;
+    u64 first, last, now, calls, reads, ReadBytes;
+    pid_t pid;
+
+    memset(consoles, 0, sizeof(consoles));
+    PMAPCPU     = 0.0;
+    SimCPU      = 0.0;
+    PeakThreads = 0;
+
+    for (i = 0, console = consoles; i < count; i++, console++)
+    {
+        if ((console->sim = BenchStartSim(i, profile, speed, port, sizeof(port))) < 0)
+            break;
+        console->start = PlatGetTime();
+        if ((console->pmap = BenchStartPMAP(i, pmap, port)) < 0)
+        {
+            kill(console->sim, SIGTERM);
+            break;
+        }
+    }
+    if (i < count)
+    {
+        PlatShowMessage("Could only start %d of %d consoles.\n", i, count);
+        count = i;
+    }
+
+    for (running = count; running > 0;)
+    {
+        if ((pid = wait4(-1, &status, WNOHANG, &usage)) > 0)
+        {
+            now = PlatGetTime();
+            for (i = 0, console = consoles; i < count; i++, console++)
+            {
+                if (console->pmap == pid)
+                {
+                    console->end  = now;
+                    console->done = 1;
+                    console->ok   = WIFEXITED(status) && WEXITSTATUS(status) == 0 && BenchCheckOutput(i);
+                    PMAPCPU += BenchCPUTime(&usage);
+                    running--;
+                    break;
+                }
+                if (console->sim == pid)
+                { // The simulator stopped early.
+                    SimCPU += BenchCPUTime(&usage);
+                    console->sim = 0;
+                    break;
+                }
+            }
+            continue;
+        }
+
+        // Sum the threads of every process of the benchmark, including this one.
+        threads = BenchGetThreads(getpid());
+        for (i = 0, console = consoles; i < count && threads >= 0; i++, console++)
+        {
+            if (!console->done && (sample = BenchGetThreads(console->pmap)) > 0)
+                threads += sample;
+            if (console->sim > 0 && (sample = BenchGetThreads(console->sim)) > 0)
+                threads += sample;
+        }
+        if (threads > PeakThreads)
+            PeakThreads = threads;
+
+        PlatSleep(BENCH_POLL_MS);
+    }
+
+    for (i = 0, console = consoles; i < count; i++, console++)
+    {
+        if (console->sim > 0)
+        {
+            kill(console->sim, SIGTERM);
+            if (wait4(console->sim, &status, 0, &usage) > 0)
+                SimCPU += BenchCPUTime(&usage);
+        }
+    }
+
+    first     = (u64)-1;
+    last      = 0;
+    mean      = 0.0;
+    longest   = 0.0;
+    completed = 0;
+    calls     = 0;
+    reads     = 0;
+    ReadBytes = 0;
+    drain     = 0.0;
+    for (i = 0, console = consoles; i < count; i++, console++)
+    {
+        calls += console->calls;
+        reads += console->reads;
+        ReadBytes += console->ReadBytes;
+        drain += console->drain;
+        if (console->start < first)
+            first = console->start;
+        if (console->end > last)
+            last = console->end;
+        mean += (console->end - console->start) / 1e9;
+        if ((console->end - console->start) / 1e9 > longest)
+            longest = (console->end - console->start) / 1e9;
+        if (console->ok)
+            completed++;
+    }
+    if (count == 0)
+        return -1;
+
+    mean /= count;
+    wall = (last - first) / 1e9;
+    if (*BaseLatency <= 0.0)
+        *BaseLatency = mean;
+
+    PlatShowMessage("%8d %9d %7.1fs %10.0f %7.2fs %7.2fs %8.2fx %8.1f%% %7.1f%% %8llu %6.1f %6.2fs ",
+                    count, completed, wall, wall > 0.0 ? completed * 3600.0 / wall : 0.0, mean, longest, mean / *BaseLatency,
+                    wall > 0.0 ? PMAPCPU * 100.0 / wall : 0.0, wall > 0.0 ? SimCPU * 100.0 / wall : 0.0,
+                    calls / count, reads > 0 ? (double)ReadBytes / reads : 0.0, drain / count);
+    if (PeakThreads > 0)
+        PlatShowMessage("%7d\n", PeakThreads);
+    else
+        PlatShowMessage("%7s\n", "-");
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *profile = "g", *speed = "1", *pmap = "./pmap";
+    static const int DefaultCounts[] = {1, 2, 4, 8, 16, 32, 64};
+    const struct BenchProfile *selected;
+    int counts[32], CountCount, i;
+    char path[PATH_MAX];
+    double BaseLatency;
+
+    CountCount = 0;
+    for (i = 1; i < argc; i++)
+    {
+        if (!strncmp(argv[i], "--profile=", 10))
+            profile = &argv[i][10];
+        else if (!strncmp(argv[i], "--speed=", 8))
+            speed = &argv[i][8];
+        else if (!strncmp(argv[i], "--pmap=", 7))
+            pmap = &argv[i][7];
+        else if (!strncmp(argv[i], "--net=tcp", 9) || !strncmp(argv[i], "--net=rfc2217", 13))
+        {
+            NetMode = argv[i][6] == 't' ? BENCH_NET_TCP : BENCH_NET_RFC2217;
+            if ((NetDepth = strchr(&argv[i][6], ':')) != NULL)
+                NetDepth++;
+            else
+                NetDepth = "";
+        }
+        else if (atoi(argv[i]) >= 1 && atoi(argv[i]) <= BENCH_MAX_CONSOLES && CountCount < (int)(sizeof(counts) / sizeof(counts[0])))
+            counts[CountCount++] = atoi(argv[i]);
+        else
+        {
+            PlatShowMessage("Syntax: pmap-bench [--profile=<profile>] [--speed=<speed>] [--pmap=<path>] [--net=tcp|rfc2217[:<depth>]] [<N>...]\n"
+                            "\tN: number of consoles (1-%d). Default: 1 2 4 8 16 32 64\n"
+                            "\t--net: serve the consoles over TCP on localhost, optionally with PMAP sending depth EEPROM reads at once\n"
+                            "\tProfiles: md36, f, g (default), g2\n",
+                            BENCH_MAX_CONSOLES);
+            return EINVAL;
+        }
+    }
+
+    for (selected = BenchProfiles; selected->name != NULL; selected++)
+    {
+        if (!strcmp(selected->name, profile))
+            break;
+    }
+    if (selected->name == NULL)
+    {
+        PlatShowMessage("Unsupported profile: %s\n", profile);
+        return EINVAL;
+    }
+    // Intake, dump (with the default filename), update, quit.
+    snprintf(jobs, sizeof(jobs),
+             BENCH_MAIN_IDENT "\n" BENCH_MAIN_EEPROM "\n" BENCH_EEPROM_DUMP "\ny\n" BENCH_EEPROM_QUIT "\n"
+             BENCH_MAIN_EEPROM "\n" BENCH_EEPROM_UPDATE "\n%s" BENCH_EEPROM_QUIT "\n" BENCH_MAIN_QUIT "\n",
+             selected->update);
+    if (CountCount == 0)
+    {
+        for (; CountCount < (int)(sizeof(DefaultCounts) / sizeof(DefaultCounts[0])); CountCount++)
+            counts[CountCount] = DefaultCounts[CountCount];
+    }
+
+    if (realpath(pmap, path) == NULL || access(path, X_OK) != 0)
+    {
+        PlatShowMessage("Cannot find %s.\n", pmap);
+        return ENOENT;
+    }
+
+    strcpy(WorkDir, BENCH_WORK_DIR);
+    if (mkdtemp(WorkDir) == NULL)
+    {
+        PlatShowMessage("Cannot create a work directory.\n");
+        return EIO;
+    }
+
+    PlatShowMessage("Profile %s, speed %s%s%s%s. Jobs per console: intake, EEPROM dump, EEPROM update.\n"
+                    "Consoles Completed    Wall  Consoles/h    Mean     Max Inflation PMAP CPU Sim CPU Syscalls B/read   Drain Threads\n",
+                    profile, speed, NetMode == BENCH_NET_NONE ? "" : (NetMode == BENCH_NET_TCP ? ", over TCP" : ", over RFC 2217"),
+                    NetDepth[0] != '\0' ? ", depth " : "", NetDepth);
+
+    BaseLatency = 0.0;
+    for (i = 0; i < CountCount; i++)
+    {
+        if (BenchRun(counts[i], profile, speed, path, &BaseLatency) != 0)
+            break;
+    }
+
+    nftw(WorkDir, &BenchRemove, 16, FTW_DEPTH | FTW_PHYS);
+
+    return 0;
+}
@@ -1,8 +1,12 @@
+#ifdef __linux__
+#define _GNU_SOURCE // For pthread_setaffinity_np()
+#endif
 #include <errno.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdarg.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <fcntl.h>
 #include <termios.h>
 #include <dirent.h>
@@ -10,20 +14,369 @@
 #include <sys/ioctl.h>
 #include <time.h>
 #include <ctype.h>
+#include <sched.h>
+#include <signal.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 
 #include "../base/platform.h"
 #include "../base/mecha.h"
+#include "../base/log.h"
 
-static int ComPortHandle = -1;
+static int ComPortHandles[PLAT_COM_PORTS] = {-1, -1, -1, -1, -1, -1, -1, -1}, ComPort = 0, NetPortHandle = -1;
 static unsigned short RxTimeout;
 static FILE *DebugOutputFile = NULL;
+static int (*CancelHandler)(void) = NULL;
+static u64 WriteStarts[PLAT_COM_PORTS], WriteEnds[PLAT_COM_PORTS], ReadTimes[PLAT_COM_PORTS]; // See PlatGetCOMPortTimes().
+
+// I/O accounting (see PlatGetIOStats()). The counters are updated by both the UI thread and the RT I/O thread.
+enum PLAT_IO_STAT
+{
+    PLAT_IO_WRITES = 0,
+    PLAT_IO_READS,
+    PLAT_IO_SELECTS,
+    PLAT_IO_READ_BYTES,
+    PLAT_IO_EMPTY_WAKEUPS,
+    PLAT_IO_DRAIN_TIME,
+    PLAT_IO_BLOCKED_TIME,
+
+    PLAT_IO_STAT_COUNT
+};
+
+static atomic_ullong IOStats[PLAT_IO_STAT_COUNT];
+
+static void PlatCountIO(int stat, u64 value)
+{
+    atomic_fetch_add_explicit(&IOStats[stat], value, memory_order_relaxed);
+}
+
+// Accounts for one system call, which started at the given time.
+static void PlatCountCall(int stat, u64 start)
+{
+    PlatCountIO(stat, 1);
+    PlatCountIO(PLAT_IO_BLOCKED_TIME, PlatGetTime() - start);
+}
+
+static void PlatDrain(int fd)
+{
+    u64 start, elapsed;
+
+    start = PlatGetTime();
+    tcdrain(fd);
+    elapsed = PlatGetTime() - start;
+    PlatCountIO(PLAT_IO_DRAIN_TIME, elapsed);
+    PlatCountIO(PLAT_IO_BLOCKED_TIME, elapsed);
+}
+
+/*  Optional real-time I/O thread.
+    The thread owns the serial port: it runs under SCHED_FIFO with locked memory and (optionally) a fixed CPU,
+    so that bytes are sent and received without being delayed by the UI thread or by other processes.
+    Data is exchanged with the UI thread over single-producer, single-consumer rings. A pipe is used to wake up the other side.
+    The times of the transfers are taken by the I/O thread: every byte received carries the time of the read() that
+    returned it, and PlatWriteCOMPort() waits until the I/O thread has sent (drained) the data, then takes the times
+    of the write from it. If the UI thread does not keep up and the RX ring fills, the I/O thread waits for it to make
+    room (blocked on a pipe, so that the UI thread can run even if it shares the CPU). */
+#define PLAT_RING_SIZE     1024 // Must be a power of 2
+#define PLAT_TX_TIMEOUT_MS 2000 // Longest wait for the I/O thread to send the data of PlatWriteCOMPort().
+
+struct PlatRing
+{
+    atomic_uint head, tail;
+    char data[PLAT_RING_SIZE];
+    u64 times[PLAT_RING_SIZE]; // Time at which each byte was received (RX only).
+};
+
+static struct PlatRing RxRing, TxRing;
+static pthread_t IOThread;
+static atomic_int IOThreadStop, RxWaiting;
+static atomic_uint TxDone;                    // Position in TxRing up to which the data was sent.
+static atomic_ullong TxWriteStart, TxWriteEnd; // Times of the last write of the I/O thread.
+static int IOThreadEnabled = 0, IOThreadRunning = 0, IOThreadCPU = -1;
+static int RxNotify[2] = {-1, -1}, TxNotify[2] = {-1, -1}, RxSpace[2] = {-1, -1}, TxSent[2] = {-1, -1};
+
+static int PlatRingPush(struct PlatRing *ring, const char *data, int n, u64 time)
+{
+    unsigned int head, tail;
+    int i;
+
+    head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    for (i = 0; i < n && head - tail < PLAT_RING_SIZE; i++, head++)
+    {
+        ring->data[head & (PLAT_RING_SIZE - 1)]  = data[i];
+        ring->times[head & (PLAT_RING_SIZE - 1)] = time;
+    }
+    atomic_store_explicit(&ring->head, head, memory_order_release);
+
+    return i;
+}
+
+// time (optional): time of the last byte popped.
+static int PlatRingPop(struct PlatRing *ring, char *data, int n, u64 *time)
+{
+    unsigned int head, tail;
+    int i;
+
+    tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    for (i = 0; i < n && tail != head; i++, tail++)
+        data[i] = ring->data[tail & (PLAT_RING_SIZE - 1)];
+    if (i > 0 && time != NULL)
+        *time = ring->times[(tail - 1) & (PLAT_RING_SIZE - 1)];
+    atomic_store_explicit(&ring->tail, tail, memory_order_release);
+
+    return i;
+}
+
+static void PlatNotify(int fd)
+{
+    u64 start;
+
+    start = PlatGetTime();
+    if (write(fd, "", 1) < 0)
+    {
+        // The pipe is full, so the other side has been notified already.
+    }
+    PlatCountCall(PLAT_IO_WRITES, start);
+}
+
+static void PlatDrainNotify(int fd)
+{
+    char discard[32];
+    int result;
+    u64 start;
+
+    do
+    {
+        start  = PlatGetTime();
+        result = read(fd, discard, sizeof(discard));
+        PlatCountCall(PLAT_IO_READS, start);
+    } while (result > 0);
+}
+
+// Waits (without a timeout) for fd to become readable, then empties it.
+static void PlatWaitNotify(int fd)
+{
+    fd_set readfds;
+    u64 start;
+
+    FD_ZERO(&readfds);
+    FD_SET(fd, &readfds);
+    start = PlatGetTime();
+    while (select(fd + 1, &readfds, NULL, NULL, NULL) < 0 && errno == EINTR)
+        ;
+    PlatCountCall(PLAT_IO_SELECTS, start);
+    PlatDrainNotify(fd);
+}
+
+// Pushes received data into the RX ring, waiting for the UI thread to make room if it is full.
+static void PlatIOThreadPush(const char *data, int n, u64 time)
+{
+    int pushed;
+
+    for (pushed = 0; pushed < n && !atomic_load(&IOThreadStop);)
+    {
+        pushed += PlatRingPush(&RxRing, data + pushed, n - pushed, time);
+        if (pushed < n)
+        { // The UI thread is not keeping up: let it read what was received, then wait for it.
+            PlatNotify(RxNotify[1]);
+            atomic_store(&RxWaiting, 1);
+            atomic_thread_fence(memory_order_seq_cst); // Either the UI thread sees RxWaiting, or the room that it made is seen here.
+            if (atomic_load(&RxRing.tail) == atomic_load_explicit(&RxRing.head, memory_order_relaxed) - PLAT_RING_SIZE)
+                PlatWaitNotify(RxSpace[0]);
+            atomic_store(&RxWaiting, 0);
+        }
+    }
+}
+
+static void *PlatIOThreadMain(void *arg)
+{
+    char buffer[64];
+    fd_set readfds;
+    sigset_t signals;
+    int result, nfds;
+    u64 start, end, call;
+
+    // Ctrl-C is handled by the UI thread.
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+    nfds = (ComPortHandles[0] > TxNotify[0] ? ComPortHandles[0] : TxNotify[0]) + 1;
+    while (!atomic_load(&IOThreadStop))
+    {
+        FD_ZERO(&readfds);
+        FD_SET(ComPortHandles[0], &readfds);
+        FD_SET(TxNotify[0], &readfds);
+
+        result = select(nfds, &readfds, NULL, NULL, NULL);
+        PlatCountIO(PLAT_IO_SELECTS, 1); // Waiting for work is not blocked time.
+        if (result < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        if (FD_ISSET(TxNotify[0], &readfds))
+        {
+            PlatDrainNotify(TxNotify[0]);
+            start = PlatGetTime();
+            while ((result = PlatRingPop(&TxRing, buffer, sizeof(buffer), NULL)) > 0)
+            {
+                call = PlatGetTime();
+                if (write(ComPortHandles[0], buffer, result) != result)
+                    result = -1;
+                PlatCountCall(PLAT_IO_WRITES, call);
+                if (result < 0)
+                    break;
+            }
+            PlatDrain(ComPortHandles[0]);
+            atomic_store(&TxWriteStart, start);
+            atomic_store(&TxWriteEnd, PlatGetTime());
+            atomic_store_explicit(&TxDone, atomic_load_explicit(&TxRing.tail, memory_order_relaxed), memory_order_release);
+            PlatNotify(TxSent[1]);
+        }
+
+        if (FD_ISSET(ComPortHandles[0], &readfds))
+        {
+            start  = PlatGetTime();
+            result = read(ComPortHandles[0], buffer, sizeof(buffer));
+            end    = PlatGetTime();
+            PlatCountCall(PLAT_IO_READS, start);
+            if (result <= 0)
+                PlatCountIO(PLAT_IO_EMPTY_WAKEUPS, 1);
+            else
+            {
+                PlatCountIO(PLAT_IO_READ_BYTES, result);
+                PlatIOThreadPush(buffer, result, end);
+                PlatNotify(RxNotify[1]);
+            }
+        }
+    }
+
+    return NULL;
+}
+
+int PlatEnableRTIO(int cpu)
+{
+    IOThreadEnabled = 1;
+    IOThreadCPU     = cpu;
+    return 0;
+}
+
+static int PlatStartIOThread(void)
+{
+    struct sched_param param;
+    pthread_attr_t attr;
+    int result;
+
+    if (pipe(RxNotify) != 0 || pipe(TxNotify) != 0 || pipe(RxSpace) != 0 || pipe(TxSent) != 0)
+        return errno;
+    fcntl(RxNotify[0], F_SETFL, O_NONBLOCK);
+    fcntl(RxNotify[1], F_SETFL, O_NONBLOCK);
+    fcntl(TxNotify[0], F_SETFL, O_NONBLOCK);
+    fcntl(TxNotify[1], F_SETFL, O_NONBLOCK);
+    fcntl(RxSpace[0], F_SETFL, O_NONBLOCK);
+    fcntl(RxSpace[1], F_SETFL, O_NONBLOCK);
+    fcntl(TxSent[0], F_SETFL, O_NONBLOCK);
+    fcntl(TxSent[1], F_SETFL, O_NONBLOCK);
+
+    atomic_init(&RxRing.head, 0);
+    atomic_init(&RxRing.tail, 0);
+    atomic_init(&TxRing.head, 0);
+    atomic_init(&TxRing.tail, 0);
+    atomic_init(&TxDone, 0);
+    atomic_init(&TxWriteStart, 0);
+    atomic_init(&TxWriteEnd, 0);
+    atomic_init(&RxWaiting, 0);
+    atomic_init(&IOThreadStop, 0);
+
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+        PlatShowMessage("RT I/O: unable to lock memory (error %d).\n", errno);
+
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+    param.sched_priority = sched_get_priority_max(SCHED_FIFO);
+    pthread_attr_setschedparam(&attr, &param);
+    if ((result = pthread_create(&IOThread, &attr, &PlatIOThreadMain, NULL)) != 0)
+    { // Not permitted to use SCHED_FIFO: fall back to the normal scheduling policy.
+        PlatShowMessage("RT I/O: SCHED_FIFO not available (error %d), using normal priority.\n", result);
+        result = pthread_create(&IOThread, NULL, &PlatIOThreadMain, NULL);
+    }
+    pthread_attr_destroy(&attr);
+
+    if (result != 0)
+        return result;
+
+#ifdef __linux__
+    if (IOThreadCPU >= 0)
+    {
+        cpu_set_t set;
+
+        CPU_ZERO(&set);
+        CPU_SET(IOThreadCPU, &set);
+        if (pthread_setaffinity_np(IOThread, sizeof(set), &set) != 0)
+            PlatShowMessage("RT I/O: unable to bind to CPU %d.\n", IOThreadCPU);
+    }
+#else
+    if (IOThreadCPU >= 0)
+        PlatShowMessage("RT I/O: CPU affinity is not supported on this platform.\n");
+#endif
+
+    IOThreadRunning = 1;
+    PlatShowMessage("RT I/O thread started.\n");
+
+    return 0;
+}
+
+static void PlatStopIOThread(void)
+{
+    if (IOThreadRunning)
+    {
+        atomic_store(&IOThreadStop, 1);
+        PlatNotify(TxNotify[1]);
+        PlatNotify(RxSpace[1]);
+        pthread_join(IOThread, NULL);
+        IOThreadRunning = 0;
+        munlockall();
+    }
+
+    if (RxNotify[0] >= 0)
+    {
+        close(RxNotify[0]);
+        close(RxNotify[1]);
+        close(TxNotify[0]);
+        close(TxNotify[1]);
+        RxNotify[0] = RxNotify[1] = TxNotify[0] = TxNotify[1] = -1;
+    }
+    if (RxSpace[0] >= 0)
+    {
+        close(RxSpace[0]);
+        close(RxSpace[1]);
+        RxSpace[0] = RxSpace[1] = -1;
+    }
+    if (TxSent[0] >= 0)
+    {
+        close(TxSent[0]);
+        close(TxSent[1]);
+        TxSent[0] = TxSent[1] = -1;
+    }
+}
 
 int PlatOpenCOMPort(const char *device)
 {
     struct termios options;
     int result;
 
-    if (ComPortHandle == -1)
+    if (ComPortHandles[ComPort] == -1)
     {
         // List available serial devices
         PlatShowMessage("Available serial devices in /dev/:\n");
@@ -53,18 +406,18 @@ int PlatOpenCOMPort(const char *device)
 
         PlatShowMessage("Opening COM port: %s\n", device);
 
-        ComPortHandle = open(device, O_RDWR | O_NOCTTY | O_NDELAY);
+        ComPortHandles[ComPort] = open(device, O_RDWR | O_NOCTTY | O_NDELAY);
 
-        if (ComPortHandle != -1)
+        if (ComPortHandles[ComPort] != -1)
         {
             PlatShowMessage("COM port opened successfully.\n");
 
-            fcntl(ComPortHandle, F_SETFL, 0);
-            if (tcgetattr(ComPortHandle, &options) == -1)
+            fcntl(ComPortHandles[ComPort], F_SETFL, 0);
+            if (tcgetattr(ComPortHandles[ComPort], &options) == -1)
             {
                 PlatShowMessage("Failed to get terminal attributes. Error code: %d\n", errno);
-                close(ComPortHandle);
-                ComPortHandle = -1;
+                close(ComPortHandles[ComPort]);
+                ComPortHandles[ComPort] = -1;
                 return errno;
             }
 
@@ -79,19 +432,19 @@ int PlatOpenCOMPort(const char *device)
             options.c_lflag = 0;
             options.c_oflag = 0;
 
-            if (tcsetattr(ComPortHandle, TCSANOW, &options) == -1)
+            if (tcsetattr(ComPortHandles[ComPort], TCSANOW, &options) == -1)
             {
                 PlatShowMessage("Failed to set terminal attributes. Error code: %d\n", errno);
-                close(ComPortHandle);
-                ComPortHandle = -1;
+                close(ComPortHandles[ComPort]);
+                ComPortHandles[ComPort] = -1;
                 return errno;
             }
 
-            if (tcflush(ComPortHandle, TCIOFLUSH) == -1)
+            if (tcflush(ComPortHandles[ComPort], TCIOFLUSH) == -1)
             {
                 PlatShowMessage("Failed to flush terminal I/O. Error code: %d\n", errno);
-                close(ComPortHandle);
-                ComPortHandle = -1;
+                close(ComPortHandles[ComPort]);
+                ComPortHandles[ComPort] = -1;
                 return errno;
             }
 
@@ -99,6 +452,15 @@ int PlatOpenCOMPort(const char *device)
 
             PlatShowMessage("COM port configuration set.\n");
             result = 0;
+
+            // The RT I/O thread serves the first COM port only.
+            if (IOThreadEnabled && ComPort == 0 && (result = PlatStartIOThread()) != 0)
+            {
+                PlatShowMessage("Failed to start the RT I/O thread. Error code: %d\n", result);
+                PlatStopIOThread();
+                close(ComPortHandles[ComPort]);
+                ComPortHandles[ComPort] = -1;
+            }
         }
         else
         {
@@ -117,9 +479,10 @@ int PlatOpenCOMPort(const char *device)
 
 int PlatReadCOMPort(char *data, int n, unsigned short timeout)
 {
-    int result;
+    int result, woken;
+    u64 start;
 
-    if (ComPortHandle == -1)
+    if (ComPortHandles[ComPort] == -1)
     {
         PlatShowMessage("COM port is not open.\n");
         return -1; // Return an error code indicating that the COM port is not open.
@@ -128,27 +491,74 @@ int PlatReadCOMPort(char *data, int n, unsigned short timeout)
     fd_set readfds;
     struct timeval tv;
 
+    if (IOThreadRunning && ComPort == 0)
+    {
+        for (woken = 0; (result = PlatRingPop(&RxRing, data, n, &ReadTimes[0])) == 0; woken = 1)
+        {
+            if (woken) // The notification was for data that an earlier call took.
+                PlatCountIO(PLAT_IO_EMPTY_WAKEUPS, 1);
+
+            FD_ZERO(&readfds);
+            FD_SET(RxNotify[0], &readfds);
+
+            tv.tv_sec  = timeout / 1000;
+            tv.tv_usec = (timeout % 1000) * 1000;
+
+            start = PlatGetTime();
+            while ((result = select(RxNotify[0] + 1, &readfds, NULL, NULL, &tv)) < 0 && errno == EINTR)
+                ; // Interrupted by Ctrl-C: the response is still expected.
+            PlatCountCall(PLAT_IO_SELECTS, start);
+            if (result > 0)
+                PlatDrainNotify(RxNotify[0]);
+            else
+            {
+                PlatCountIO(PLAT_IO_EMPTY_WAKEUPS, 1);
+                if (result == 0)
+                    PlatShowMessage("Read from COM port timed out.\n");
+                else
+                    PlatShowMessage("Select function error.\n");
+                break;
+            }
+        }
+        atomic_thread_fence(memory_order_seq_cst);
+        if (result > 0 && atomic_exchange(&RxWaiting, 0))
+            PlatNotify(RxSpace[1]); // The I/O thread is waiting for room in the ring.
+
+        return result;
+    }
+
     FD_ZERO(&readfds);
-    FD_SET(ComPortHandle, &readfds);
+    FD_SET(ComPortHandles[ComPort], &readfds);
 
     tv.tv_sec  = timeout / 1000;
     tv.tv_usec = (timeout % 1000) * 1000;
 
-    result     = select(ComPortHandle + 1, &readfds, NULL, NULL, &tv);
+    start = PlatGetTime();
+    while ((result = select(ComPortHandles[ComPort] + 1, &readfds, NULL, NULL, &tv)) < 0 && errno == EINTR)
+        ; // Interrupted by Ctrl-C: the response is still expected.
+    PlatCountCall(PLAT_IO_SELECTS, start);
 
     if (result > 0)
     {
         // Data is available, read it
-        result = read(ComPortHandle, data, n);
+        start              = PlatGetTime();
+        result             = read(ComPortHandles[ComPort], data, n);
+        ReadTimes[ComPort] = PlatGetTime();
+        PlatCountCall(PLAT_IO_READS, start);
 
         if (result < 0)
         {
             PlatShowMessage("Read from COM port failed.\n");
         }
+        else if (result == 0)
+            PlatCountIO(PLAT_IO_EMPTY_WAKEUPS, 1);
+        else
+            PlatCountIO(PLAT_IO_READ_BYTES, result);
     }
     else if (result == 0)
     {
         // Timeout
+        PlatCountIO(PLAT_IO_EMPTY_WAKEUPS, 1);
         PlatShowMessage("Read from COM port timed out.\n");
     }
     else
@@ -160,10 +570,59 @@ int PlatReadCOMPort(char *data, int n, unsigned short timeout)
     return result;
 }
 
+// Queues the data for the I/O thread, then waits until it was sent.
+static int PlatWriteIOThread(const char *data)
+{
+    struct timeval tv;
+    fd_set readfds;
+    unsigned int end;
+    int result, ready;
+    u64 start;
+
+    result = PlatRingPush(&TxRing, data, strlen(data), 0);
+    end    = atomic_load_explicit(&TxRing.head, memory_order_relaxed);
+    PlatNotify(TxNotify[1]);
+
+    while ((int)(atomic_load_explicit(&TxDone, memory_order_acquire) - end) < 0)
+    {
+        FD_ZERO(&readfds);
+        FD_SET(TxSent[0], &readfds);
+        tv.tv_sec  = PLAT_TX_TIMEOUT_MS / 1000;
+        tv.tv_usec = (PLAT_TX_TIMEOUT_MS % 1000) * 1000;
+
+        start = PlatGetTime();
+        while ((ready = select(TxSent[0] + 1, &readfds, NULL, NULL, &tv)) < 0 && errno == EINTR)
+            ;
+        PlatCountCall(PLAT_IO_SELECTS, start);
+        if (ready <= 0)
+        {
+            PlatShowMessage("Write to COM port timed out.\n");
+            return -1;
+        }
+        PlatDrainNotify(TxSent[0]);
+    }
+
+    WriteStarts[0] = atomic_load(&TxWriteStart);
+    WriteEnds[0]   = atomic_load(&TxWriteEnd);
+
+    return result;
+}
+
 int PlatWriteCOMPort(const char *data)
 {
-    int result = write(ComPortHandle, data, strlen(data));
-    tcdrain(ComPortHandle);
+    int result;
+    u64 start;
+
+    if (IOThreadRunning && ComPort == 0)
+        return PlatWriteIOThread(data);
+
+    start = PlatGetTime();
+    while ((result = write(ComPortHandles[ComPort], data, strlen(data))) < 0 && errno == EINTR)
+        ;
+    PlatCountCall(PLAT_IO_WRITES, start);
+    PlatDrain(ComPortHandles[ComPort]);
+    WriteStarts[ComPort] = start;
+    WriteEnds[ComPort]   = PlatGetTime();
 
     if (result < 0)
     {
@@ -175,11 +634,13 @@ int PlatWriteCOMPort(const char *data)
 
 void PlatCloseCOMPort(void)
 {
-    if (ComPortHandle != -1)
+    if (ComPortHandles[ComPort] != -1)
     {
         PlatShowMessage("Closing COM port...\n");
-        close(ComPortHandle);
-        ComPortHandle = -1;
+        if (ComPort == 0)
+            PlatStopIOThread();
+        close(ComPortHandles[ComPort]);
+        ComPortHandles[ComPort] = -1;
         PlatShowMessage("COM port closed.\n");
     }
     else
@@ -188,11 +649,296 @@ void PlatCloseCOMPort(void)
     }
 }
 
+void PlatGetCOMPortTimes(u64 *WriteStart, u64 *WriteEnd, u64 *ReadTime)
+{
+    if (WriteStart != NULL)
+        *WriteStart = WriteStarts[ComPort];
+    if (WriteEnd != NULL)
+        *WriteEnd = WriteEnds[ComPort];
+    if (ReadTime != NULL)
+        *ReadTime = ReadTimes[ComPort];
+}
+
+int PlatSelectCOMPort(int port)
+{
+    if (port < 0 || port >= PLAT_COM_PORTS)
+        return EINVAL;
+
+    ComPort = port;
+    return 0;
+}
+
+int PlatOpenNetPort(const char *host, const char *port)
+{
+    struct addrinfo hints, *addresses, *address;
+    int result, on;
+
+    if (NetPortHandle != -1)
+    {
+        PlatShowMessage("Network port is already open.\n");
+        return EMFILE;
+    }
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if ((result = getaddrinfo(host, port, &hints, &addresses)) != 0)
+    {
+        PlatShowMessage("Cannot resolve %s: %s\n", host, gai_strerror(result));
+        return ENXIO;
+    }
+
+    PlatShowMessage("Connecting to %s:%s\n", host, port);
+    result = ECONNREFUSED;
+    for (address = addresses; address != NULL; address = address->ai_next)
+    {
+        if ((NetPortHandle = socket(address->ai_family, address->ai_socktype, address->ai_protocol)) < 0)
+            continue;
+        if (connect(NetPortHandle, address->ai_addr, address->ai_addrlen) == 0)
+        {
+            result = 0;
+            break;
+        }
+        result = errno;
+        close(NetPortHandle);
+        NetPortHandle = -1;
+    }
+    freeaddrinfo(addresses);
+
+    if (result != 0)
+    {
+        PlatShowMessage("Failed to connect. Error code: %d\n", result);
+        return result;
+    }
+
+    // Commands are short: send them immediately, rather than waiting to fill a segment.
+    on = 1;
+    setsockopt(NetPortHandle, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+#ifdef SO_NOSIGPIPE
+    setsockopt(NetPortHandle, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+    PlatShowMessage("Connected.\n");
+
+    return 0;
+}
+
+int PlatReadNetPort(char *data, int n, unsigned short timeout)
+{
+    fd_set readfds;
+    struct timeval tv;
+    int result;
+    u64 start;
+
+    if (NetPortHandle == -1)
+        return -EBADF;
+
+    FD_ZERO(&readfds);
+    FD_SET(NetPortHandle, &readfds);
+
+    tv.tv_sec  = timeout / 1000;
+    tv.tv_usec = (timeout % 1000) * 1000;
+
+    start = PlatGetTime();
+    while ((result = select(NetPortHandle + 1, &readfds, NULL, NULL, &tv)) < 0 && errno == EINTR)
+        ; // Interrupted by Ctrl-C: the response is still expected.
+    PlatCountCall(PLAT_IO_SELECTS, start);
+
+    if (result > 0)
+    {
+        start  = PlatGetTime();
+        result = recv(NetPortHandle, data, n, 0);
+        PlatCountCall(PLAT_IO_READS, start);
+        if (result <= 0)
+        {
+            PlatShowMessage(result == 0 ? "The server closed the connection.\n" : "Read from network port failed.\n");
+            result = -EPIPE;
+        }
+        else
+            PlatCountIO(PLAT_IO_READ_BYTES, result);
+    }
+    else if (result == 0)
+    {
+        PlatCountIO(PLAT_IO_EMPTY_WAKEUPS, 1);
+        PlatShowMessage("Read from network port timed out.\n");
+    }
+    else
+        PlatShowMessage("Select function error.\n");
+
+    return result;
+}
+
+int PlatWriteNetPort(const char *data, int n)
+{
+    int result, sent;
+    u64 start;
+
+#ifdef MSG_NOSIGNAL
+    const int flags = MSG_NOSIGNAL;
+#else
+    const int flags = 0;
+#endif
+
+    for (sent = 0; sent < n; sent += result)
+    {
+        start = PlatGetTime();
+        while ((result = send(NetPortHandle, data + sent, n - sent, flags)) < 0 && errno == EINTR)
+            ;
+        PlatCountCall(PLAT_IO_WRITES, start);
+        if (result < 0)
+        {
+            PlatShowMessage("Write to network port failed.\n");
+            return -EPIPE;
+        }
+    }
+
+    return sent;
+}
+
+void PlatCloseNetPort(void)
+{
+    if (NetPortHandle != -1)
+    {
+        close(NetPortHandle);
+        NetPortHandle = -1;
+        PlatShowMessage("Network port closed.\n");
+    }
+}
+
+void PlatGetIOStats(PlatIOStats_t *stats)
+{
+    stats->writes       = atomic_load_explicit(&IOStats[PLAT_IO_WRITES], memory_order_relaxed);
+    stats->reads        = atomic_load_explicit(&IOStats[PLAT_IO_READS], memory_order_relaxed);
+    stats->selects      = atomic_load_explicit(&IOStats[PLAT_IO_SELECTS], memory_order_relaxed);
+    stats->ReadBytes    = atomic_load_explicit(&IOStats[PLAT_IO_READ_BYTES], memory_order_relaxed);
+    stats->EmptyWakeups = atomic_load_explicit(&IOStats[PLAT_IO_EMPTY_WAKEUPS], memory_order_relaxed);
+    stats->DrainTime    = atomic_load_explicit(&IOStats[PLAT_IO_DRAIN_TIME], memory_order_relaxed);
+    stats->BlockedTime  = atomic_load_explicit(&IOStats[PLAT_IO_BLOCKED_TIME], memory_order_relaxed);
+}
+
+void PlatResetIOStats(void)
+{
+    int i;
+
+    for (i = 0; i < PLAT_IO_STAT_COUNT; i++)
+        atomic_store_explicit(&IOStats[i], 0, memory_order_relaxed);
+}
+
 void PlatSleep(unsigned short int msec)
 {
     usleep((useconds_t)msec * 1000);
 }
 
+u64 PlatGetTime(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (u64)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+int PlatListFiles(const char *path, int (*callback)(const char *file, void *arg), void *arg)
+{
+    DIR *dir;
+    struct dirent *entry;
+    struct stat st;
+    char file[PATH_MAX];
+    int result;
+
+    if (stat(path, &st) != 0)
+        return -errno;
+    if (S_ISREG(st.st_mode))
+        return callback(path, arg);
+    if (!S_ISDIR(st.st_mode))
+        return 0;
+
+    if ((dir = opendir(path)) == NULL)
+        return -errno;
+
+    result = 0;
+    while (result == 0 && (entry = readdir(dir)) != NULL)
+    {
+        if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, ".."))
+            continue;
+        snprintf(file, sizeof(file), "%s/%s", path, entry->d_name);
+        result = PlatListFiles(file, callback, arg);
+    }
+    closedir(dir);
+
+    return result;
+}
+
+struct PlatThread
+{
+    pthread_t thread;
+    int index, count;
+    void (*function)(int thread, int count, void *arg);
+    void *arg;
+};
+
+static void *PlatThreadMain(void *arg)
+{
+    struct PlatThread *thread = (struct PlatThread *)arg;
+
+    thread->function(thread->index, thread->count, thread->arg);
+    return NULL;
+}
+
+int PlatRunThreads(int count, void (*function)(int thread, int count, void *arg), void *arg)
+{
+    struct PlatThread *threads;
+    int i, started;
+
+    if (count <= 0 && (count = (int)sysconf(_SC_NPROCESSORS_ONLN)) <= 0)
+        count = 1;
+
+    if ((threads = malloc(count * sizeof(struct PlatThread))) == NULL)
+    {
+        function(0, 1, arg);
+        return 1;
+    }
+
+    for (started = 0; started < count; started++)
+    {
+        threads[started].index    = started;
+        threads[started].count    = count;
+        threads[started].function = function;
+        threads[started].arg      = arg;
+        if (pthread_create(&threads[started].thread, NULL, &PlatThreadMain, &threads[started]) != 0)
+            break;
+    }
+
+    // Threads that could not be started are run on this thread.
+    for (i = started; i < count; i++)
+        function(i, count, arg);
+    for (i = 0; i < started; i++)
+        pthread_join(threads[i].thread, NULL);
+    free(threads);
+
+    return count;
+}
+
+static void PlatSignalHandler(int signum)
+{
+    if (CancelHandler == NULL || !CancelHandler())
+    {
+        signal(signum, SIG_DFL);
+        raise(signum);
+    }
+}
+
+int PlatSetCancelHandler(int (*handler)(void))
+{
+    struct sigaction action;
+
+    CancelHandler = handler;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = &PlatSignalHandler;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = 0; // Not SA_RESTART, so that a wait for the user to press ENTER is interrupted.
+
+    return (sigaction(SIGINT, &action, NULL) == 0 ? 0 : errno);
+}
+
 void PlatShowEMessage(const char *format, ...)
 {
     if (format == NULL)
@@ -209,7 +955,7 @@ void PlatShowEMessage(const char *format, ...)
     va_end(args);
 
     // Print to debug output file, if specified
-    if (DebugOutputFile != NULL)
+    if (DebugOutputFile != NULL && LogEnabled(LOG_UI, LOG_ERROR))
     {
         va_start(args, format);
         vfprintf(DebugOutputFile, format, args);
@@ -233,7 +979,7 @@ void PlatShowMessage(const char *format, ...)
     va_end(args);
 
     // Print to debug output file, if specified
-    if (DebugOutputFile != NULL)
+    if (DebugOutputFile != NULL && LogEnabled(LOG_UI, LOG_INFO))
     {
         va_start(args, format);
         vfprintf(DebugOutputFile, format, args);
@@ -243,6 +989,8 @@ void PlatShowMessage(const char *format, ...)
 
 void PlatShowMessageB(const char *format, ...)
 {
+    int c;
+
     if (format == NULL)
     {
         fprintf(stderr, "Error: format string is NULL\n");
@@ -254,22 +1002,23 @@ void PlatShowMessageB(const char *format, ...)
     // Print to standard output
     va_start(args, format);
     vprintf(format, args);
-    vprintf(format, args);
     va_end(args); // Clean up after using args for vprintf
 
     // Print to debug output file, if specified
-    if (DebugOutputFile != NULL)
+    if (DebugOutputFile != NULL && LogEnabled(LOG_UI, LOG_INFO))
     {
         va_start(args, format); // Reinitialize args for vfprintf
         vfprintf(DebugOutputFile, format, args);
         va_end(args); // Clean up after using args for vfprintf
     }
 
-    // Block until the user presses ENTER
-    while (getchar() != '\n')
+    // Block until the user presses ENTER (or Ctrl-C interrupts the wait)
+    while ((c = getchar()) != '\n' && c != EOF)
     {
         // Wait for newline character
     }
+    if (c == EOF)
+        clearerr(stdin);
 }
 
 void PlatDebugInit(void)
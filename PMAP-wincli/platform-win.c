@@ -2,16 +2,26 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdlib.h>
+#include <winsock2.h> // Before Windows.h, which would include the older winsock.h.
+#include <ws2tcpip.h>
 #include <Windows.h>
 #include <time.h>
 #include <ctype.h>
 
 #include "platform.h"
 #include "mecha.h"
+#include "log.h"
 
-static HANDLE ComPortHandle = INVALID_HANDLE_VALUE;
-static unsigned short RxTimeout;
+static HANDLE ComPortHandles[PLAT_COM_PORTS] = {INVALID_HANDLE_VALUE, INVALID_HANDLE_VALUE, INVALID_HANDLE_VALUE, INVALID_HANDLE_VALUE,
+                                                 INVALID_HANDLE_VALUE, INVALID_HANDLE_VALUE, INVALID_HANDLE_VALUE, INVALID_HANDLE_VALUE};
+static SOCKET NetPortHandle                   = INVALID_SOCKET;
+static unsigned short RxTimeouts[PLAT_COM_PORTS];
+static int ComPort = 0;
 static FILE *DebugOutputFile = NULL;
+static PlatIOStats_t IOStats; // The ports are only used by one thread.
+static int (*CancelHandler)(void) = NULL;
+static u64 WriteStarts[PLAT_COM_PORTS], WriteEnds[PLAT_COM_PORTS], ReadTimes[PLAT_COM_PORTS]; // See PlatGetCOMPortTimes().
 
 void ListSerialDevices()
 {
@@ -31,6 +41,12 @@ void ListSerialDevices()
     }
 }
 
+int PlatEnableRTIO(int cpu)
+{
+    PlatShowMessage("RT I/O is not supported on this platform.\n");
+    return ENOSYS;
+}
+
 int PlatOpenCOMPort(const char *device)
 {
     ListSerialDevices();
@@ -38,25 +54,25 @@ int PlatOpenCOMPort(const char *device)
     DCB DeviceControlBlock;
     int result;
 
-    if (ComPortHandle == INVALID_HANDLE_VALUE)
+    if (ComPortHandles[ComPort] == INVALID_HANDLE_VALUE)
     {
-        if ((ComPortHandle = CreateFileA(device, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL)) != INVALID_HANDLE_VALUE)
+        if ((ComPortHandles[ComPort] = CreateFileA(device, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL)) != INVALID_HANDLE_VALUE)
         {
             memset(&DeviceControlBlock, 0, sizeof(DeviceControlBlock));
             DeviceControlBlock.DCBlength = sizeof(DCB);
-            GetCommState(ComPortHandle, &DeviceControlBlock);
+            GetCommState(ComPortHandles[ComPort], &DeviceControlBlock);
             DeviceControlBlock.BaudRate = CBR_57600;
             DeviceControlBlock.fParity  = FALSE;
             DeviceControlBlock.ByteSize = 8;
             DeviceControlBlock.StopBits = ONESTOPBIT;
-            SetCommState(ComPortHandle, &DeviceControlBlock);
+            SetCommState(ComPortHandles[ComPort], &DeviceControlBlock);
             CommTimeout.ReadIntervalTimeout        = 0;
             CommTimeout.ReadTotalTimeoutMultiplier = 0;
-            CommTimeout.ReadTotalTimeoutConstant = RxTimeout = MECHA_TASK_NORMAL_TO;
+            CommTimeout.ReadTotalTimeoutConstant = RxTimeouts[ComPort] = MECHA_TASK_NORMAL_TO;
             CommTimeout.WriteTotalTimeoutConstant            = 0;
             CommTimeout.WriteTotalTimeoutMultiplier          = 0;
-            SetCommTimeouts(ComPortHandle, &CommTimeout);
-            PurgeComm(ComPortHandle, PURGE_RXCLEAR | PURGE_TXCLEAR);
+            SetCommTimeouts(ComPortHandles[ComPort], &CommTimeout);
+            PurgeComm(ComPortHandles[ComPort], PURGE_RXCLEAR | PURGE_TXCLEAR);
             result = 0;
         }
         else
@@ -76,20 +92,29 @@ int PlatReadCOMPort(char *data, int n, unsigned short timeout)
     COMMTIMEOUTS CommTimeout;
     DWORD BytesRead;
     int result;
+    u64 start;
 
-    if (RxTimeout != timeout)
+    if (RxTimeouts[ComPort] != timeout)
     {
         CommTimeout.ReadIntervalTimeout        = 0;
         CommTimeout.ReadTotalTimeoutMultiplier = 0;
-        CommTimeout.ReadTotalTimeoutConstant = RxTimeout = timeout;
+        CommTimeout.ReadTotalTimeoutConstant = RxTimeouts[ComPort] = timeout;
         CommTimeout.WriteTotalTimeoutConstant            = 0;
         CommTimeout.WriteTotalTimeoutMultiplier          = 0;
-        SetCommTimeouts(ComPortHandle, &CommTimeout);
+        SetCommTimeouts(ComPortHandles[ComPort], &CommTimeout);
     }
-    if (ReadFile(ComPortHandle, data, n, &BytesRead, NULL) == TRUE)
+    start = PlatGetTime();
+    if (ReadFile(ComPortHandles[ComPort], data, n, &BytesRead, NULL) == TRUE)
         result = BytesRead;
     else
         result = -EIO;
+    ReadTimes[ComPort] = PlatGetTime();
+    IOStats.reads++;
+    IOStats.BlockedTime += PlatGetTime() - start;
+    if (result == 0) // Timed out.
+        IOStats.EmptyWakeups++;
+    else if (result > 0)
+        IOStats.ReadBytes += result;
 
     return result;
 }
@@ -98,11 +123,17 @@ int PlatWriteCOMPort(const char *data)
 {
     DWORD BytesWritten;
     int result;
+    u64 start;
 
-    if (WriteFile(ComPortHandle, data, strlen(data), &BytesWritten, NULL) == TRUE)
+    start = PlatGetTime();
+    if (WriteFile(ComPortHandles[ComPort], data, strlen(data), &BytesWritten, NULL) == TRUE)
         result = BytesWritten;
     else
         result = -EIO;
+    WriteStarts[ComPort] = start;
+    WriteEnds[ComPort]   = PlatGetTime();
+    IOStats.writes++;
+    IOStats.BlockedTime += PlatGetTime() - start;
 
     if (result < 0)
     {
@@ -114,11 +145,11 @@ int PlatWriteCOMPort(const char *data)
 
 void PlatCloseCOMPort(void)
 {
-    if (ComPortHandle != INVALID_HANDLE_VALUE)
+    if (ComPortHandles[ComPort] != INVALID_HANDLE_VALUE)
     {
         PlatShowMessage("Closing COM port...\n");
-        CloseHandle(ComPortHandle);
-        ComPortHandle = INVALID_HANDLE_VALUE;
+        CloseHandle(ComPortHandles[ComPort]);
+        ComPortHandles[ComPort] = INVALID_HANDLE_VALUE;
         PlatShowMessage("COM port closed.\n");
     }
     else
@@ -127,11 +158,291 @@ void PlatCloseCOMPort(void)
     }
 }
 
+void PlatGetCOMPortTimes(u64 *WriteStart, u64 *WriteEnd, u64 *ReadTime)
+{
+    if (WriteStart != NULL)
+        *WriteStart = WriteStarts[ComPort];
+    if (WriteEnd != NULL)
+        *WriteEnd = WriteEnds[ComPort];
+    if (ReadTime != NULL)
+        *ReadTime = ReadTimes[ComPort];
+}
+
+int PlatSelectCOMPort(int port)
+{
+    if (port < 0 || port >= PLAT_COM_PORTS)
+        return EINVAL;
+
+    ComPort = port;
+    return 0;
+}
+
+int PlatOpenNetPort(const char *host, const char *port)
+{
+    struct addrinfo hints, *addresses, *address;
+    WSADATA WsaData;
+    int result;
+    BOOL on;
+
+    if (NetPortHandle != INVALID_SOCKET)
+    {
+        PlatShowMessage("Network port is already open.\n");
+        return EMFILE;
+    }
+
+    if (WSAStartup(MAKEWORD(2, 2), &WsaData) != 0)
+        return ENOSYS;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+    if (getaddrinfo(host, port, &hints, &addresses) != 0)
+    {
+        PlatShowMessage("Cannot resolve %s.\n", host);
+        WSACleanup();
+        return ENXIO;
+    }
+
+    PlatShowMessage("Connecting to %s:%s\n", host, port);
+    result = ECONNREFUSED;
+    for (address = addresses; address != NULL; address = address->ai_next)
+    {
+        if ((NetPortHandle = socket(address->ai_family, address->ai_socktype, address->ai_protocol)) == INVALID_SOCKET)
+            continue;
+        if (connect(NetPortHandle, address->ai_addr, (int)address->ai_addrlen) == 0)
+        {
+            result = 0;
+            break;
+        }
+        closesocket(NetPortHandle);
+        NetPortHandle = INVALID_SOCKET;
+    }
+    freeaddrinfo(addresses);
+
+    if (result != 0)
+    {
+        PlatShowMessage("Failed to connect. Error code: %d\n", WSAGetLastError());
+        WSACleanup();
+        return result;
+    }
+
+    // Commands are short: send them immediately, rather than waiting to fill a segment.
+    on = TRUE;
+    setsockopt(NetPortHandle, IPPROTO_TCP, TCP_NODELAY, (const char *)&on, sizeof(on));
+    PlatShowMessage("Connected.\n");
+
+    return 0;
+}
+
+int PlatReadNetPort(char *data, int n, unsigned short timeout)
+{
+    fd_set readfds;
+    struct timeval tv;
+    int result;
+    u64 start;
+
+    if (NetPortHandle == INVALID_SOCKET)
+        return -EBADF;
+
+    FD_ZERO(&readfds);
+    FD_SET(NetPortHandle, &readfds);
+
+    tv.tv_sec  = timeout / 1000;
+    tv.tv_usec = (timeout % 1000) * 1000;
+
+    start  = PlatGetTime();
+    result = select(0, &readfds, NULL, NULL, &tv);
+    IOStats.selects++;
+    IOStats.BlockedTime += PlatGetTime() - start;
+    if (result > 0)
+    {
+        start  = PlatGetTime();
+        result = recv(NetPortHandle, data, n, 0);
+        IOStats.reads++;
+        IOStats.BlockedTime += PlatGetTime() - start;
+        if (result <= 0)
+        {
+            PlatShowMessage(result == 0 ? "The server closed the connection.\n" : "Read from network port failed.\n");
+            result = -EPIPE;
+        }
+        else
+            IOStats.ReadBytes += result;
+    }
+    else if (result == 0)
+    {
+        IOStats.EmptyWakeups++;
+        PlatShowMessage("Read from network port timed out.\n");
+    }
+    else
+    {
+        PlatShowMessage("Select function error.\n");
+        result = -EIO;
+    }
+
+    return result;
+}
+
+int PlatWriteNetPort(const char *data, int n)
+{
+    int result, sent;
+    u64 start;
+
+    for (sent = 0; sent < n; sent += result)
+    {
+        start  = PlatGetTime();
+        result = send(NetPortHandle, data + sent, n - sent, 0);
+        IOStats.writes++;
+        IOStats.BlockedTime += PlatGetTime() - start;
+        if (result == SOCKET_ERROR)
+        {
+            PlatShowMessage("Write to network port failed.\n");
+            return -EPIPE;
+        }
+    }
+
+    return sent;
+}
+
+void PlatCloseNetPort(void)
+{
+    if (NetPortHandle != INVALID_SOCKET)
+    {
+        closesocket(NetPortHandle);
+        NetPortHandle = INVALID_SOCKET;
+        WSACleanup();
+        PlatShowMessage("Network port closed.\n");
+    }
+}
+
+void PlatGetIOStats(PlatIOStats_t *stats)
+{
+    *stats = IOStats;
+}
+
+void PlatResetIOStats(void)
+{
+    memset(&IOStats, 0, sizeof(IOStats));
+}
+
 void PlatSleep(unsigned short int msec)
 {
     Sleep(msec);
 }
 
+u64 PlatGetTime(void)
+{
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER now;
+
+    if (frequency.QuadPart == 0)
+        QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&now);
+
+    return (u64)(now.QuadPart / frequency.QuadPart) * 1000000000ULL + (u64)(now.QuadPart % frequency.QuadPart) * 1000000000ULL / frequency.QuadPart;
+}
+
+int PlatListFiles(const char *path, int (*callback)(const char *file, void *arg), void *arg)
+{
+    WIN32_FIND_DATAA data;
+    HANDLE find;
+    DWORD attributes;
+    char pattern[MAX_PATH], file[MAX_PATH];
+    int result;
+
+    if ((attributes = GetFileAttributesA(path)) == INVALID_FILE_ATTRIBUTES)
+        return -ENOENT;
+    if (!(attributes & FILE_ATTRIBUTE_DIRECTORY))
+        return callback(path, arg);
+
+    snprintf(pattern, sizeof(pattern), "%s\\*", path);
+    if ((find = FindFirstFileA(pattern, &data)) == INVALID_HANDLE_VALUE)
+        return -ENOENT;
+
+    result = 0;
+    do
+    {
+        if (!strcmp(data.cFileName, ".") || !strcmp(data.cFileName, ".."))
+            continue;
+        snprintf(file, sizeof(file), "%s\\%s", path, data.cFileName);
+        result = PlatListFiles(file, callback, arg);
+    } while (result == 0 && FindNextFileA(find, &data));
+    FindClose(find);
+
+    return result;
+}
+
+struct PlatThread
+{
+    HANDLE thread;
+    int index, count;
+    void (*function)(int thread, int count, void *arg);
+    void *arg;
+};
+
+static DWORD WINAPI PlatThreadMain(LPVOID arg)
+{
+    struct PlatThread *thread = (struct PlatThread *)arg;
+
+    thread->function(thread->index, thread->count, thread->arg);
+    return 0;
+}
+
+int PlatRunThreads(int count, void (*function)(int thread, int count, void *arg), void *arg)
+{
+    struct PlatThread *threads;
+    SYSTEM_INFO info;
+    int i, started;
+
+    if (count <= 0)
+    {
+        GetSystemInfo(&info);
+        count = info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+    }
+
+    if ((threads = malloc(count * sizeof(struct PlatThread))) == NULL)
+    {
+        function(0, 1, arg);
+        return 1;
+    }
+
+    for (started = 0; started < count; started++)
+    {
+        threads[started].index    = started;
+        threads[started].count    = count;
+        threads[started].function = function;
+        threads[started].arg      = arg;
+        if ((threads[started].thread = CreateThread(NULL, 0, &PlatThreadMain, &threads[started], 0, NULL)) == NULL)
+            break;
+    }
+
+    // Threads that could not be started are run on this thread.
+    for (i = started; i < count; i++)
+        function(i, count, arg);
+    for (i = 0; i < started; i++)
+    {
+        WaitForSingleObject(threads[i].thread, INFINITE);
+        CloseHandle(threads[i].thread);
+    }
+    free(threads);
+
+    return count;
+}
+
+static BOOL WINAPI PlatConsoleCtrlHandler(DWORD type)
+{
+    if (type != CTRL_C_EVENT || CancelHandler == NULL)
+        return FALSE;
+
+    return (CancelHandler() ? TRUE : FALSE); // FALSE: the default handler terminates the program.
+}
+
+int PlatSetCancelHandler(int (*handler)(void))
+{
+    CancelHandler = handler;
+    return (SetConsoleCtrlHandler(&PlatConsoleCtrlHandler, TRUE) ? 0 : EINVAL);
+}
+
 void PlatShowEMessage(const char *format, ...)
 {
     if (format == NULL)
@@ -148,7 +459,7 @@ void PlatShowEMessage(const char *format, ...)
     va_end(args);
 
     // Print to debug output file, if specified
-    if (DebugOutputFile != NULL)
+    if (DebugOutputFile != NULL && LogEnabled(LOG_UI, LOG_ERROR))
     {
         va_start(args, format);
         vfprintf(DebugOutputFile, format, args);
@@ -172,7 +483,7 @@ void PlatShowMessage(const char *format, ...)
     va_end(args);
 
     // Print to debug output file, if specified
-    if (DebugOutputFile != NULL)
+    if (DebugOutputFile != NULL && LogEnabled(LOG_UI, LOG_INFO))
     {
         va_start(args, format);
         vfprintf(DebugOutputFile, format, args);
@@ -182,6 +493,8 @@ void PlatShowMessage(const char *format, ...)
 
 void PlatShowMessageB(const char *format, ...)
 {
+    int c;
+
     if (format == NULL)
     {
         fprintf(stderr, "Error: format string is NULL\n");
@@ -196,7 +509,7 @@ void PlatShowMessageB(const char *format, ...)
     va_end(args); // Clean up after using args for vprintf
 
     // Print to debug output file, if specified
-    if (DebugOutputFile != NULL)
+    if (DebugOutputFile != NULL && LogEnabled(LOG_UI, LOG_INFO))
     {
         va_start(args, format); // Reinitialize args for vfprintf
         vfprintf(DebugOutputFile, format, args);
@@ -204,10 +517,12 @@ void PlatShowMessageB(const char *format, ...)
     }
 
     // Block until the user presses ENTER
-    while (getchar() != '\n')
+    while ((c = getchar()) != '\n' && c != EOF)
     {
         // Wait for newline character
     }
+    if (c == EOF)
+        clearerr(stdin); // The read was interrupted by Ctrl-C.
 }
 
 void PlatDebugInit(void)
@@ -167,6 +167,8 @@ static int UpdateEEPROM(HWND hwndDlg)
                 PlatShowMessage("\tTray\n");
             if (result & UPDATE_REGION_EEGS)
                 PlatShowMessage("\tEE & GS\n");
+            if (result & UPDATE_REGION_OSD2)
+                PlatShowMessage("\tOSD2 init bit\n");
             if (result & UPDATE_REGION_ECR)
                 PlatShowMessage("\tRTC ECR\n");
             if (result & UPDATE_REGION_RTC)
@@ -179,6 +181,8 @@ static int UpdateEEPROM(HWND hwndDlg)
             }
             if (result & UPDATE_REGION_DEFAULTS)
                 PlatShowMessage("\tMechacon defaults\n");
+            if (result & UPDATE_REGION_CONFIG)
+                PlatShowMessage("\tMechacon configuration\n");
 
             do
             {
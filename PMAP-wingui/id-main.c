@@ -114,7 +114,7 @@ extern unsigned char ConType, ConCEXDEX;
                         case 11:
                         case 12:
                         case 13:
-                            PlatShowMessage("MechaInit: %s\n", MechaInitMechacon(choice, 0) == 0 ? "done" : "failed");
+                            PlatShowMessage("MechaInit: %s\n", MechaInitMechacon(choice - 1, 0) == 0 ? "done" : "failed");
                             break;
                         case 14:
                             done = 1;
@@ -132,7 +132,7 @@ extern unsigned char ConType, ConCEXDEX;
                         case 5:
                         case 6:
                         case 7:
-                            PlatShowMessage("MechaInit: %s\n", MechaInitMechacon(choice, 1) == 0 ? "done" : "failed");
+                            PlatShowMessage("MechaInit: %s\n", MechaInitMechacon(choice - 1, 1) == 0 ? "done" : "failed");
                             break;
                         case 8:
                             done = 1;
@@ -2,18 +2,22 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdlib.h>
 #include <Windows.h>
 #include <time.h>
 #include <ctype.h>
 
 #include "platform.h"
 #include "mecha.h"
+#include "log.h"
 
 extern HWND g_mainWin;
 
 static HANDLE ComPortHandle = INVALID_HANDLE_VALUE;
 static unsigned short RxTimeout;
 static FILE *DebugOutputFile = NULL;
+static PlatIOStats_t IOStats; // The ports are only used by one thread.
+static u64 WriteStart, WriteEnd, ReadTime; // See PlatGetCOMPortTimes().
 
 /* void ListSerialDevices()
 {
@@ -33,6 +37,12 @@ static FILE *DebugOutputFile = NULL;
     }
 } */
 
+int PlatEnableRTIO(int cpu)
+{
+    PlatShowMessage("RT I/O is not supported on this platform.\n");
+    return ENOSYS;
+}
+
 int PlatOpenCOMPort(const char *device)
 {
     // ListSerialDevices();
@@ -78,6 +88,7 @@ int PlatReadCOMPort(char *data, int n, unsigned short timeout)
     COMMTIMEOUTS CommTimeout;
     DWORD BytesRead;
     int result;
+    u64 start;
 
     if (RxTimeout != timeout)
     {
@@ -88,10 +99,18 @@ int PlatReadCOMPort(char *data, int n, unsigned short timeout)
         CommTimeout.WriteTotalTimeoutMultiplier          = 0;
         SetCommTimeouts(ComPortHandle, &CommTimeout);
     }
+    start = PlatGetTime();
     if (ReadFile(ComPortHandle, data, n, &BytesRead, NULL) == TRUE)
         result = BytesRead;
     else
         result = -EIO;
+    ReadTime = PlatGetTime();
+    IOStats.reads++;
+    IOStats.BlockedTime += PlatGetTime() - start;
+    if (result == 0) // Timed out.
+        IOStats.EmptyWakeups++;
+    else if (result > 0)
+        IOStats.ReadBytes += result;
 
     return result;
 }
@@ -100,11 +119,17 @@ int PlatWriteCOMPort(const char *data)
 {
     DWORD BytesWritten;
     int result;
+    u64 start;
 
+    start = PlatGetTime();
     if (WriteFile(ComPortHandle, data, strlen(data), &BytesWritten, NULL) == TRUE)
         result = BytesWritten;
     else
         result = -EIO;
+    WriteStart = start;
+    WriteEnd   = PlatGetTime();
+    IOStats.writes++;
+    IOStats.BlockedTime += PlatGetTime() - start;
 
     if (result < 0)
     {
@@ -129,11 +154,159 @@ void PlatCloseCOMPort(void)
     }
 }
 
+void PlatGetCOMPortTimes(u64 *start, u64 *end, u64 *received)
+{
+    if (start != NULL)
+        *start = WriteStart;
+    if (end != NULL)
+        *end = WriteEnd;
+    if (received != NULL)
+        *received = ReadTime;
+}
+
+int PlatSelectCOMPort(int port)
+{
+    return (port == 0 ? 0 : ENOSYS);
+}
+
+int PlatOpenNetPort(const char *host, const char *port)
+{
+    return ENOSYS;
+}
+
+int PlatReadNetPort(char *data, int n, unsigned short timeout)
+{
+    return -ENOSYS;
+}
+
+int PlatWriteNetPort(const char *data, int n)
+{
+    return -ENOSYS;
+}
+
+void PlatCloseNetPort(void)
+{
+}
+
+void PlatGetIOStats(PlatIOStats_t *stats)
+{
+    *stats = IOStats;
+}
+
+void PlatResetIOStats(void)
+{
+    memset(&IOStats, 0, sizeof(IOStats));
+}
+
 void PlatSleep(unsigned short int msec)
 {
     Sleep(msec);
 }
 
+u64 PlatGetTime(void)
+{
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER now;
+
+    if (frequency.QuadPart == 0)
+        QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&now);
+
+    return (u64)(now.QuadPart / frequency.QuadPart) * 1000000000ULL + (u64)(now.QuadPart % frequency.QuadPart) * 1000000000ULL / frequency.QuadPart;
+}
+
+int PlatListFiles(const char *path, int (*callback)(const char *file, void *arg), void *arg)
+{
+    WIN32_FIND_DATAA data;
+    HANDLE find;
+    DWORD attributes;
+    char pattern[MAX_PATH], file[MAX_PATH];
+    int result;
+
+    if ((attributes = GetFileAttributesA(path)) == INVALID_FILE_ATTRIBUTES)
+        return -ENOENT;
+    if (!(attributes & FILE_ATTRIBUTE_DIRECTORY))
+        return callback(path, arg);
+
+    snprintf(pattern, sizeof(pattern), "%s\\*", path);
+    if ((find = FindFirstFileA(pattern, &data)) == INVALID_HANDLE_VALUE)
+        return -ENOENT;
+
+    result = 0;
+    do
+    {
+        if (!strcmp(data.cFileName, ".") || !strcmp(data.cFileName, ".."))
+            continue;
+        snprintf(file, sizeof(file), "%s\\%s", path, data.cFileName);
+        result = PlatListFiles(file, callback, arg);
+    } while (result == 0 && FindNextFileA(find, &data));
+    FindClose(find);
+
+    return result;
+}
+
+struct PlatThread
+{
+    HANDLE thread;
+    int index, count;
+    void (*function)(int thread, int count, void *arg);
+    void *arg;
+};
+
+static DWORD WINAPI PlatThreadMain(LPVOID arg)
+{
+    struct PlatThread *thread = (struct PlatThread *)arg;
+
+    thread->function(thread->index, thread->count, thread->arg);
+    return 0;
+}
+
+int PlatRunThreads(int count, void (*function)(int thread, int count, void *arg), void *arg)
+{
+    struct PlatThread *threads;
+    SYSTEM_INFO info;
+    int i, started;
+
+    if (count <= 0)
+    {
+        GetSystemInfo(&info);
+        count = info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+    }
+
+    if ((threads = malloc(count * sizeof(struct PlatThread))) == NULL)
+    {
+        function(0, 1, arg);
+        return 1;
+    }
+
+    for (started = 0; started < count; started++)
+    {
+        threads[started].index    = started;
+        threads[started].count    = count;
+        threads[started].function = function;
+        threads[started].arg      = arg;
+        if ((threads[started].thread = CreateThread(NULL, 0, &PlatThreadMain, &threads[started], 0, NULL)) == NULL)
+            break;
+    }
+
+    // Threads that could not be started are run on this thread.
+    for (i = started; i < count; i++)
+        function(i, count, arg);
+    for (i = 0; i < started; i++)
+    {
+        WaitForSingleObject(threads[i].thread, INFINITE);
+        CloseHandle(threads[i].thread);
+    }
+    free(threads);
+
+    return count;
+}
+
+int PlatSetCancelHandler(int (*handler)(void))
+{
+    return ENOSYS;
+}
+
 void PlatShowEMessage(const char *format, ...)
 {
     char buffer[256];
@@ -150,7 +323,7 @@ void PlatShowEMessage(const char *format, ...)
     vsnprintf(buffer, sizeof(buffer), format, args);
     va_end(args); // Clean up args after vsnprintf
 
-    if (DebugOutputFile != NULL)
+    if (DebugOutputFile != NULL && LogEnabled(LOG_UI, LOG_ERROR))
     {
         va_start(args, format); // Reinitialize args for vfprintf
         vfprintf(DebugOutputFile, format, args);
@@ -176,7 +349,7 @@ void PlatShowMessage(const char *format, ...)
     vsnprintf(buffer, sizeof(buffer), format, args);
     va_end(args); // Clean up args after vsnprintf
 
-    if (DebugOutputFile != NULL)
+    if (DebugOutputFile != NULL && LogEnabled(LOG_UI, LOG_INFO))
     {
         va_start(args, format); // Reinitialize args for vfprintf
         vfprintf(DebugOutputFile, format, args);
@@ -202,7 +375,7 @@ void PlatShowMessageB(const char *format, ...)
     vsnprintf(buffer, sizeof(buffer), format, args);
     va_end(args); // Clean up args after vsnprintf
 
-    if (DebugOutputFile != NULL)
+    if (DebugOutputFile != NULL && LogEnabled(LOG_UI, LOG_INFO))
     {
         va_start(args, format); // Reinitialize args for vfprintf
         vfprintf(DebugOutputFile, format, args);
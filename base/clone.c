@@ -0,0 +1,250 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "platform.h"
+#include "main.h"
+#include "mecha.h"
+#include "eeprom.h"
+#include "clone.h"
+
+static const MechaTransport_t *SourceLink, *TargetLink;
+
+// When both consoles are on COM ports, the target is on the second one.
+static const MechaTransport_t CloneCOMTransport = {&PlatReadCOMPort, &PlatWriteCOMPort, NULL, 0, 1, &PlatGetCOMPortTimes};
+
+// Identity of a console: i.LINK ID and console ID (which holds the model ID, serial number and EMCS).
+static const u16 CloneIDWords[] = {
+    EEPROM_MAP_ILINK_ID_0, EEPROM_MAP_ILINK_ID_1, EEPROM_MAP_ILINK_ID_2, EEPROM_MAP_ILINK_ID_3,
+    EEPROM_MAP_CON_ID_0, EEPROM_MAP_CON_ID_1, EEPROM_MAP_CON_ID_2, EEPROM_MAP_CON_ID_3, 0xFFFF};
+static const u16 CloneIDWordsNew[] = {
+    EEPROM_MAP_ILINK_ID_NEW_0, EEPROM_MAP_ILINK_ID_NEW_1, EEPROM_MAP_ILINK_ID_NEW_2, EEPROM_MAP_ILINK_ID_NEW_3,
+    EEPROM_MAP_CON_ID_NEW_0, EEPROM_MAP_CON_ID_NEW_1, EEPROM_MAP_CON_ID_NEW_2, EEPROM_MAP_CON_ID_NEW_3, 0xFFFF};
+
+static int CloneOpen(const char *source, const char *target)
+{
+    int SourceType, TargetType, result;
+
+    SourceType = GetConsolePortType(source);
+    TargetType = GetConsolePortType(target);
+    if (SourceType == TargetType && SourceType != CONSOLE_PORT_COM)
+    {
+        PlatShowMessage("The consoles cannot both be simulated, or both be on serial servers.\n");
+        return -EINVAL;
+    }
+
+    if ((result = OpenConsole(source)) != 0)
+    {
+        PlatShowMessage("Cannot open %s.\n", source);
+        return result;
+    }
+    SourceLink = MechaGetTransport();
+    MechaSetTransport(NULL);
+
+    if (SourceType == CONSOLE_PORT_COM && TargetType == CONSOLE_PORT_COM)
+    {
+        PlatSelectCOMPort(1);
+        result = PlatOpenCOMPort(target);
+        PlatSelectCOMPort(0);
+        TargetLink = &CloneCOMTransport;
+    }
+    else
+    {
+        result     = OpenConsole(target);
+        TargetLink = MechaGetTransport();
+    }
+    if (result != 0)
+    {
+        PlatShowMessage("Cannot open %s.\n", target);
+        CloseConsole(source);
+        return result;
+    }
+
+    return 0;
+}
+
+static void CloneClose(const char *source, const char *target)
+{
+    if (TargetLink == &CloneCOMTransport)
+    {
+        PlatSelectCOMPort(1);
+        PlatCloseCOMPort();
+        PlatSelectCOMPort(0);
+    }
+    else
+        CloseConsole(target);
+    CloseConsole(source);
+    MechaSetTransport(NULL);
+}
+
+// Returns the MD version of the console on link, or a negative number if it cannot be identified.
+static int CloneIdentify(const MechaTransport_t *link, const char *port, char *desc, int size)
+{
+    u8 tm, md;
+
+    MechaSetTransport(link);
+    if (MechaInitModel() != 0)
+    {
+        PlatShowMessage("Cannot identify the console on %s.\n", port);
+        return -EIO;
+    }
+
+    MechaGetMode(&tm, &md);
+    snprintf(desc, size, "%s", MechaGetDesc());
+    PlatShowMessage("%s:\tTestMode.%d MD1.%d\t%s\n", port, tm, md, desc);
+
+    return md;
+}
+
+static int CloneCollectRead(unsigned short int word, u16 *data)
+{
+    char buffer[MECHA_RX_BUFFER_SIZE];
+    int result;
+
+    if ((result = MechaCommandCollect(MECHA_TASK_NORMAL_TO, buffer, sizeof(buffer))) == 9 && buffer[0] == '0')
+    {
+        *data = (u16)strtoul(buffer + 5, NULL, 16);
+        return 0;
+    }
+
+    if (result > 0) // Data was read.
+        result = (int)strtoul(buffer, NULL, 16);
+    PlatShowMessage("\nEEPROM read error %d:%d\n", word, result);
+
+    return (result != 0 ? result : -EIO);
+}
+
+// Like EEPROMWriteWord(), the response of the Dragon MECHACON is not checked.
+static int CloneCollectWrite(unsigned short int word, int md)
+{
+    char buffer[MECHA_RX_BUFFER_SIZE];
+    int result;
+
+    if ((result = MechaCommandCollect(MECHA_TASK_NORMAL_TO, buffer, sizeof(buffer))) == 9 || (md == 40 && result >= 0))
+        return 0;
+
+    if (result > 0) // Data was read.
+        result = (int)strtoul(buffer, NULL, 16);
+    PlatShowMessage("\nEEPROM write error %d:%d\n", word, result);
+
+    return (result != 0 ? result : -EIO);
+}
+
+static int CloneRxHandler(MechaTask_t *task, const char *result, short int len)
+{
+    return (result[0] == '0' ? 0 : MechaDefaultHandleRes1(task, result, len));
+}
+
+static int CloneEEPROM(int md, int KeepID)
+{
+    char args[9], buffer[MECHA_RX_BUFFER_SIZE];
+    const u16 *IDWords;
+    u16 id[8], data;
+    int i, j, progress, result;
+    u64 start;
+
+    IDWords = md == 40 ? CloneIDWordsNew : CloneIDWords;
+    if (KeepID)
+    {
+        MechaSetTransport(TargetLink);
+        for (i = 0; IDWords[i] != 0xFFFF; i++)
+        {
+            if ((result = EEPROMReadWord(IDWords[i], &id[i])) != 0)
+            {
+                PlatShowMessage("Cannot read the ID of the target console.\n");
+                return result;
+            }
+        }
+    }
+
+    PlatShowMessage("\nCloning EEPROM:\n");
+    start = PlatGetTime();
+    if ((result = MechaCommandPost(SourceLink, MECHA_CMD_EEPROM_READ, "0000")) == 0)
+        result = CloneCollectRead(0, &data);
+    for (i = 0; result == 0 && i < CLONE_EEPROM_WORDS; i++)
+    {
+        putchar('\r');
+        PlatShowMessage("Progress: ");
+        putchar('[');
+        for (progress = 0; progress <= (i * 20 / CLONE_EEPROM_WORDS); progress++)
+            putchar('#');
+        for (; progress < 20; progress++)
+            putchar(' ');
+        putchar(']');
+
+        for (j = 0; KeepID && IDWords[j] != 0xFFFF; j++)
+        {
+            if (IDWords[j] == i)
+                data = id[j];
+        }
+
+        snprintf(args, 9, "%04x%04x", i, data);
+        if ((result = MechaCommandPost(TargetLink, MECHA_CMD_EEPROM_WRITE, args)) != 0)
+            break;
+        // The next word is read from the source while this one is written to the target.
+        if (i + 1 < CLONE_EEPROM_WORDS)
+        {
+            snprintf(args, 5, "%04x", i + 1);
+            if ((result = MechaCommandPost(SourceLink, MECHA_CMD_EEPROM_READ, args)) != 0)
+                break;
+        }
+
+        if ((result = CloneCollectWrite(i, md)) == 0 && i + 1 < CLONE_EEPROM_WORDS)
+            result = CloneCollectRead(i + 1, &data);
+    }
+    putchar('\n');
+
+    // Discard the responses that are still outstanding after an error.
+    while (MechaCommandCollect(MECHA_TASK_NORMAL_TO, buffer, sizeof(buffer)) != -EINVAL)
+        ;
+
+    if (result == 0)
+        PlatShowMessage("%d words cloned in %.1fs.\n", CLONE_EEPROM_WORDS, (PlatGetTime() - start) / 1e9);
+
+    if (result == 0 && KeepID)
+    {
+        MechaSetTransport(TargetLink);
+        if ((result = MechaAddPostEEPROMWrCmds(1)) == 0)
+            result = MechaCommandExecuteList(NULL, &CloneRxHandler);
+        else
+            MechaCommandListClear();
+    }
+
+    return result;
+}
+
+int CloneConsole(const char *source, const char *target, int KeepID)
+{
+    char SourceDesc[64], TargetDesc[64];
+    int SourceMD, TargetMD, result;
+
+    if ((result = CloneOpen(source, target)) != 0)
+        return result;
+    PlatSetCancelHandler(&MechaCancel);
+
+    PlatShowMessage("\nSource and target consoles:\n");
+    if ((SourceMD = CloneIdentify(SourceLink, source, SourceDesc, sizeof(SourceDesc))) < 0 ||
+        (TargetMD = CloneIdentify(TargetLink, target, TargetDesc, sizeof(TargetDesc))) < 0)
+        result = -EIO;
+    else if (SourceMD != TargetMD)
+    {
+        PlatShowMessage("The consoles have different MECHACONs: their EEPROMs are not interchangeable.\n");
+        result = -EINVAL;
+    }
+    else
+    {
+        if (strcmp(SourceDesc, TargetDesc) != 0)
+            PlatShowMessage("Warning: the consoles are of different chassis.\n");
+
+        if ((result = CloneEEPROM(SourceMD, KeepID)) == 0)
+            PlatShowMessage("Clone completed.\n"
+                            "Please reboot the MECHACON of the target console, by pressing its RESET button.\n");
+        else
+            PlatShowMessage("Clone failed: the EEPROM of the target console is incomplete.\n");
+    }
+
+    CloneClose(source, target);
+
+    return result;
+}
@@ -0,0 +1,10 @@
+/*  Console-to-console clone: copies the EEPROM of a source console onto a target console, with both connected at once.
+        PMAP --clone <source port> <target port> [--keep-id]
+    Each word is written to the target while the next one is read from the source, so that a swap takes about
+    as long as a single pass over the EEPROM. Both consoles must have the same MECHACON (MD version).
+    The ports may be two COM ports, or a COM port and the simulator or a serial server (but not two of either).
+    --keep-id: the i.LINK ID and the console ID (model ID, serial number and EMCS) of the target are kept,
+    and its EEPROM checksum is then rewritten. */
+#define CLONE_EEPROM_WORDS 0x200
+
+int CloneConsole(const char *source, const char *target, int KeepID);
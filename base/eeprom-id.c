@@ -81,42 +81,82 @@ static int EEPROMIDRxHandler(MechaTask_t *task, const char *result, short int le
 
 struct RegionData
 {
-    u8 region, vmode;
+    u8 model, region, vmode;
 };
 
-int MechaInitMechacon(int model, int IsDex)
+// Indexed by the choices of the initialization menu.
+static const struct RegionData CEXregions[MECHA_INIT_CEX_MODELS] = {
+    {0, 0, 0},  // 00 Japan
+    {1, 1, 0},  // 01 USA
+    {2, 3, 1},  // 02 Australia
+    {3, 2, 1},  // 03 Great Britian
+    {4, 2, 1},  // 04 Europe
+    {5, 4, 0},  // 05 Korea
+    {6, 4, 0},  // 06 Hong Kong
+    {7, 4, 0},  // 07 Taiwan
+    {8, 5, 1},  // 08 Russia
+    {9, 6, 0},  // 09 Mainland China
+    {10, 1, 0}, // 10 Canada (PAL or NTSC ??)
+    {11, 7, 0}, // 11 Mexico
+};
+static const struct RegionData DEXregions[MECHA_INIT_DEX_MODELS] = {
+    {0, 0, 0}, // 00
+    {1, 1, 0}, // 01
+    {2, 1, 1}, // 02
+    {5, 0, 0}, // 05
+    {6, 0, 0}, // 06
+    {8, 1, 1}, // 08
+    {9, 6, 0}, // 09
+};
+
+int MechaFindInitModel(int model, int IsDex)
 {
-    const struct RegionData CEXregions[] = {
-        {0, 0}, // 00 Japan
-        {1, 0}, // 01 USA
-        {3, 1}, // 02 Australia
-        {2, 1}, // 03 Great Britian
-        {2, 1}, // 04 Europe
-        {4, 0}, // 05 Korea
-        {4, 0}, // 06 Hong Kong
-        {4, 0}, // 07 Taiwan
-        {5, 1}, // 08 Russia
-        {6, 0}, // 09 Mainland China
-        {1, 0}, // 10 Canada (PAL or NTSC ??)
-        {7, 0}, // 11 Mexico
-    };
-    const struct RegionData DEXregions[] = {
-        {0, 0}, // 00
-        {1, 0}, // 01
-        {1, 1}, // 02
-        {0, 0}, // 05
-        {0, 0}, // 06
-        {1, 1}, // 08
-        {6, 0}, // 09
-    };
+    int i;
+
+    for (i = 0; i < (IsDex ? MECHA_INIT_DEX_MODELS : MECHA_INIT_CEX_MODELS); i++)
+    {
+        if ((IsDex ? DEXregions[i].model : CEXregions[i].model) == model)
+            return i;
+    }
+
+    return -EINVAL;
+}
+
+int MechaGetInitVMode(int index, int IsDex)
+{
+    return (IsDex ? DEXregions[index].vmode : CEXregions[index].vmode);
+}
+
+// data must be at least MECHA_SHIMUKE_SIZE characters long.
+void MechaMakeShimuke(int index, int IsDex, char *data)
+{
+    static unsigned char seeded = 0;
     time_t TimeNow;
     struct tm *tm;
-    const struct RegionData *region;
-    char data[26];
+    u8 region;
+
+    region = IsDex ? DEXregions[index].region : CEXregions[index].region;
+    time(&TimeNow);
+    if (!seeded)
+    { // Only once, so that the boards of a batch do not share the random number.
+        srand((unsigned int)TimeNow);
+        seeded = 1;
+    }
+    tm = localtime(&TimeNow);
+    // Format: RRYYMMDDHHMMSSrrrr, where R = MagicGate region, Y = Year (from 2000), M = Month (1-12), D = Day of month (1-31), H = Hour (0-23), M = minute (0-59), S = second (0-59), r = random number (first 4 digits from the right).
+    // The time and date format is made with Ctime::Format %y%m%d%H%M%S
+    snprintf(data, MECHA_SHIMUKE_SIZE, "%02x%02d%02d%02d%02d%02d%02d%04d", region, tm->tm_year - 100, tm->tm_mon + 1, tm->tm_mday, tm->tm_hour, tm->tm_min, tm->tm_sec, rand() % 10000);
+}
+
+int MechaInitMechacon(int model, int IsDex)
+{
+    char data[MECHA_SHIMUKE_SIZE];
     unsigned char id;
 
-    region = IsDex ? &DEXregions[model] : &CEXregions[model];
-    id     = 1;
+    if (model < 0 || model >= (IsDex ? MECHA_INIT_DEX_MODELS : MECHA_INIT_CEX_MODELS))
+        return -EINVAL;
+
+    id = 1;
     MechaCommandAdd(MECHA_TASK_UI_CMD_WAIT, NULL, MECHA_TASK_ID_UI, 0, 100, "EEPROM WAIT 100ms");
     if(MechaIdentRaw.cfc == 0)	//Check that the MECHACON ID is 0. Because this command works only in EEP_CS high mode, which sets the CFC to 0.
     {
@@ -129,19 +169,14 @@ int MechaInitMechacon(int model, int IsDex)
         MechaCommandAdd(MECHA_TASK_UI_CMD_WAIT, NULL, MECHA_TASK_ID_UI, 0, 100, "EEPROM WAIT 100ms");
     }
 
-    time(&TimeNow);
-    srand((unsigned int)TimeNow);
-    tm = localtime(&TimeNow);
-    // Format: RRYYMMDDHHMMSSrrrr, where R = MagicGate region, Y = Year (from 2000), M = Month (1-12), D = Day of month (1-31), H = Hour (0-23), M = minute (0-59), S = second (0-59), r = random number (first 4 digits from the right).
-    // The time and date format is made with Ctime::Format %y%m%d%H%M%S
-    snprintf(data, 19, "%02x%02d%02d%02d%02d%02d%02d%04d", region->region, tm->tm_year - 100, tm->tm_mon + 1, tm->tm_mday, tm->tm_hour, tm->tm_min, tm->tm_sec, rand() % 10000);
+    MechaMakeShimuke(model, IsDex, data);
     PlatShowMessage("Shimuke: %s (%zu)\n", data, strlen(data));
     MechaCommandAdd(MECHA_CMD_INIT_SHIMUKE, data, id++, 0, 6000, "WR INIT SHIMUKE");
     MechaCommandAdd(MECHA_TASK_UI_CMD_WAIT, NULL, MECHA_TASK_ID_UI, 0, 100, "EEPROM WAIT 100ms");
     //	}
     MechaCommandAdd(MECHA_CMD_CLEAR_CONF, "00", id++, 0, 6000, "WR INIT ALL DEFAULT");
     MechaCommandAdd(MECHA_TASK_UI_CMD_WAIT, NULL, MECHA_TASK_ID_UI, 0, 100, "EEPROM WAIT 100ms");
-    if (region->vmode == 0)
+    if (MechaGetInitVMode(model, IsDex) == 0)
         MechaCommandAdd(MECHA_CMD_SETUP_OSD, "00", id++, 0, 6000, "WR INIT NTSC");
     else
         MechaCommandAdd(MECHA_CMD_SETUP_OSD, "01", id++, 0, 6000, "WR INIT PAL");
@@ -1,5 +1,12 @@
+#define MECHA_INIT_CEX_MODELS 12
+#define MECHA_INIT_DEX_MODELS 7
+#define MECHA_SHIMUKE_SIZE    19
+
 int EEPROMInitID(void);
-int MechaInitMechacon(int model, int IsDex);
+int MechaInitMechacon(int model, int IsDex); // model: index of the region (0 = the first choice of the menu).
+int MechaFindInitModel(int model, int IsDex); // model: number at the end of the model name (i.e. 4 for SCPH-xx004). Returns its index.
+int MechaGetInitVMode(int index, int IsDex);  // 0 = NTSC, 1 = PAL
+void MechaMakeShimuke(int index, int IsDex, char *data);
 int EEPROMNTSCPALDefaults(int vmode);
 
 void EEPROMGetiLinkID(u8 *id);
@@ -9,17 +9,23 @@
 #include "mecha.h"
 #include "eeprom.h"
 #include "updates.h"
+#include "elect.h"
+#include "session.h"
+
+extern char RTCData[19];
+
+#define DUMP_BLOCK_WORDS 32 // Words read per command list.
 
 static int DumpEEPROM(const char *filename)
 {
     FILE *dump;
     int i, progress, result;
-    u16 data;
+    u16 data[DUMP_BLOCK_WORDS];
 
     PlatShowMessage("\nDumping EEPROM:\n");
     if ((dump = fopen(filename, "wb")) != NULL)
     {
-        for (i = 0; i < 1024 / 2; i++)
+        for (i = 0; i < 1024 / 2; i += DUMP_BLOCK_WORDS)
         {
             putchar('\r');
             PlatShowMessage("Progress: ");
@@ -30,12 +36,12 @@ static int DumpEEPROM(const char *filename)
                 putchar(' ');
             putchar(']');
 
-            if ((result = EEPROMReadWord(i, &data)) != 0)
+            if ((result = EEPROMReadWords(i, DUMP_BLOCK_WORDS, data)) != 0)
             {
-                PlatShowMessage("EEPROM read error %d:%d\n", i, result);
+                PlatShowMessage("EEPROM read error %d-%d:%d\n", i, i + DUMP_BLOCK_WORDS - 1, result);
                 break;
             }
-            if (fwrite(&data, sizeof(u16), 1, dump) != 1)
+            if (fwrite(data, sizeof(u16), DUMP_BLOCK_WORDS, dump) != DUMP_BLOCK_WORDS)
                 break;
         }
         putchar('\n');
@@ -90,83 +96,150 @@ static int RestoreEEPROM(const char *filename)
 #define EEPROM_UPDATE_FLAG_SANYO    1 // Supports SANYO OP
 #define EEPROM_UPDATE_FLAG_NEW_SONY 2 // No support for the old T487
 
-static int UpdateEEPROM(int chassis)
+struct UpdateData
+{
+    int (*update)(int ClearOSD2InitBit, int ReplacedMecha, int lens, int opt);
+    unsigned int flags;
+};
+
+static const struct UpdateData UpdateFunctions[MECHA_CHASSIS_MODEL_COUNT] = {
+    {&MechaUpdateChassisCex10000, 0},
+    {&MechaUpdateChassisA, 0},
+    {&MechaUpdateChassisAB, 0},
+    {&MechaUpdateChassisB, 0},
+    {&MechaUpdateChassisC, 0},
+    {&MechaUpdateChassisD, 0},
+    {&MechaUpdateChassisF, EEPROM_UPDATE_FLAG_SANYO},
+    {&MechaUpdateChassisG, EEPROM_UPDATE_FLAG_SANYO | EEPROM_UPDATE_FLAG_NEW_SONY},
+    {&MechaUpdateChassisH, EEPROM_UPDATE_FLAG_SANYO | EEPROM_UPDATE_FLAG_NEW_SONY},
+    {&MechaUpdateChassisDexA, 0},
+    {&MechaUpdateChassisDexA2, 0},
+    {&MechaUpdateChassisDexA3, 0},
+    {&MechaUpdateChassisDexB, 0},
+    {&MechaUpdateChassisDexD, 0},
+    {&MechaUpdateChassisDexH, EEPROM_UPDATE_FLAG_SANYO | EEPROM_UPDATE_FLAG_NEW_SONY},
+};
+
+/*  Reads a choice from 1 to count. If a choice was proposed (1 or more), an empty line selects it. */
+static int UpdatePromptChoice(const char *label, int count, int proposed)
 {
-    struct UpdateData
+    char line[16];
+    int choice;
+
+    do
     {
-        int (*update)(int ClearOSD2InitBit, int ReplacedMecha, int lens, int opt);
-        unsigned int flags;
-    };
-    int ClearOSD2InitBit, ReplacedMecha, OpticalBlock, ObjectLens, result;
+        if (proposed > 0)
+            PlatShowMessage("Your choice [%d]: ", proposed);
+        else
+            PlatShowMessage("Your choice: ");
+        choice = 0;
+        SessionWaitBegin(label);
+        if (fgets(line, sizeof(line), stdin) != NULL)
+            choice = (line[0] == '\n' || line[0] == '\r') ? proposed : atoi(line);
+        SessionWaitEnd();
+    } while (choice < 1 || choice > count);
+
+    return choice;
+}
+
+/*  Offers the OP pre-check, so that a wrong optical block is not only found out by the ELECT adjustment.
+    If the CD DET value fits both types of OP, the one that the EEPROM is set up for is kept, unless the MECHACON was replaced.
+    Returns the type of OP to propose, or -1. */
+static int UpdateProposeOP(int ReplacedMecha)
+{
+    unsigned char types;
     char choice;
-    struct UpdateData *selected;
-    struct UpdateData data[MECHA_CHASSIS_MODEL_COUNT] = {
-        {&MechaUpdateChassisCex10000, 0},
-        {&MechaUpdateChassisA, 0},
-        {&MechaUpdateChassisAB, 0},
-        {&MechaUpdateChassisB, 0},
-        {&MechaUpdateChassisC, 0},
-        {&MechaUpdateChassisD, 0},
-        {&MechaUpdateChassisF, EEPROM_UPDATE_FLAG_SANYO},
-        {&MechaUpdateChassisG, EEPROM_UPDATE_FLAG_SANYO | EEPROM_UPDATE_FLAG_NEW_SONY},
-        {&MechaUpdateChassisH, EEPROM_UPDATE_FLAG_SANYO | EEPROM_UPDATE_FLAG_NEW_SONY},
-        {&MechaUpdateChassisDexA, 0},
-        {&MechaUpdateChassisDexA2, 0},
-        {&MechaUpdateChassisDexA3, 0},
-        {&MechaUpdateChassisDexB, 0},
-        {&MechaUpdateChassisDexD, 0},
-        {&MechaUpdateChassisDexH, EEPROM_UPDATE_FLAG_SANYO | EEPROM_UPDATE_FLAG_NEW_SONY},
-    };
+    int result, current;
+
+    do
+    {
+        PlatShowMessage("Detect the optical block with the test CD first (y/n)? ");
+        SessionWaitBegin("Detect optical block?");
+        choice = getchar();
+        while (getchar() != '\n')
+        {
+        };
+        SessionWaitEnd();
+    } while (choice != 'y' && choice != 'n');
+    if (choice == 'n')
+        return -1;
+
+    if ((result = ElectDetectOP(&types)) != 0)
+    {
+        if (result == -ENOTSUP)
+            PlatShowMessage("The optical block cannot be detected with this MECHACON.\n");
+        else
+            PlatShowMessage("OP pre-check failed: %d\n", result);
+        return -1;
+    }
+
+    current = ReplacedMecha ? -1 : MechaGetOP();
+    switch (types)
+    {
+        case 1 << MECHA_OP_SONY:
+            PlatShowMessage("A SONY OP is installed.\n");
+            return MECHA_OP_SONY;
+        case 1 << MECHA_OP_SANYO:
+            PlatShowMessage("A SANYO OP is installed.\n");
+            return MECHA_OP_SANYO;
+        case (1 << MECHA_OP_SONY) | (1 << MECHA_OP_SANYO):
+            if (current == MECHA_OP_SONY || current == MECHA_OP_SANYO)
+            {
+                PlatShowMessage("Either OP may be installed. The EEPROM is set up for a %s OP, which fits.\n", current == MECHA_OP_SONY ? "SONY" : "SANYO");
+                return current;
+            }
+            PlatShowMessage("Either OP may be installed.\n");
+            return -1;
+        default:
+            PlatShowMessage("The CD DET value fits neither OP. Check the OP and the test CD.\n");
+            return -1;
+    }
+}
+
+static int UpdateEEPROM(int chassis)
+{
+    int ClearOSD2InitBit, ReplacedMecha, OpticalBlock, ObjectLens, ProposedOP, lens, result;
+    char choice;
+    const struct UpdateData *selected;
 
     PlatShowMessage("Update EEPROM\n\n");
     if (chassis >= 0)
     {
-        selected = &data[chassis];
+        selected = &UpdateFunctions[chassis];
 
         do
         {
             PlatShowMessage("Was the MECHACON replaced (y/n)? ");
+            SessionWaitBegin("MECHACON replaced?");
             choice = getchar();
             while (getchar() != '\n')
             {
             };
+            SessionWaitEnd();
         } while (choice != 'y' && choice != 'n');
         ReplacedMecha = choice == 'y';
 
         if (selected->flags & EEPROM_UPDATE_FLAG_SANYO)
         {
-            do
-            {
-                PlatShowMessage("Please select the optical block:\n"
-                                "\t1. SONY\n"
-                                "\t2. SANYO\n"
-                                "Your choice: ");
-                OpticalBlock = 0;
-                if (scanf("%d", &OpticalBlock))
-                    while (getchar() != '\n')
-                    {
-                    };
-            } while (OpticalBlock < 1 || OpticalBlock > 2);
-            OpticalBlock--;
+            ProposedOP = UpdateProposeOP(ReplacedMecha);
+            PlatShowMessage("Please select the optical block:\n"
+                            "\t1. SONY\n"
+                            "\t2. SANYO\n");
+            OpticalBlock = UpdatePromptChoice("Optical block", 2, ProposedOP >= 0 ? ProposedOP + 1 : 0) - 1;
         }
         else
             OpticalBlock = MECHA_OP_SONY;
 
         if (!(selected->flags & EEPROM_UPDATE_FLAG_NEW_SONY) && (OpticalBlock != MECHA_OP_SANYO))
         {
-            do
-            {
-                PlatShowMessage("Please select the object lens:\n"
-                                "\t1. T487\n"
-                                "\t2. T609K\n"
-                                "Your choice: ");
-                ObjectLens = 0;
-                if (scanf("%d", &ObjectLens))
-                    while (getchar() != '\n')
-                    {
-                    };
-            } while (ObjectLens < 1 || ObjectLens > 2);
-            ObjectLens--;
+            // The lens cannot be measured, but the EEPROM of the original MECHACON knows which one was fitted.
+            lens = ReplacedMecha ? -1 : MechaGetLens();
+            if (lens == MECHA_LENS_T487 || lens == MECHA_LENS_T609K)
+                PlatShowMessage("The EEPROM is set up for the %s lens.\n", lens == MECHA_LENS_T487 ? "T487" : "T609K");
+            PlatShowMessage("Please select the object lens:\n"
+                            "\t1. T487\n"
+                            "\t2. T609K\n");
+            ObjectLens = UpdatePromptChoice("Object lens", 2, (lens == MECHA_LENS_T487 || lens == MECHA_LENS_T609K) ? lens + 1 : 0) - 1;
         }
         else
             ObjectLens = MECHA_LENS_T487;
@@ -176,10 +249,12 @@ static int UpdateEEPROM(int chassis)
             do
             {
                 PlatShowMessage("The OSD2 init bit is set. Clear it? (y/n)");
+                SessionWaitBegin("Clear OSD2 init bit?");
                 choice = getchar();
                 while (getchar() != '\n')
                 {
                 };
+                SessionWaitEnd();
             } while (choice != 'y' && choice != 'n');
             ClearOSD2InitBit = choice == 'y';
         }
@@ -188,6 +263,8 @@ static int UpdateEEPROM(int chassis)
 
         if ((result = selected->update(ClearOSD2InitBit, ReplacedMecha, ObjectLens, OpticalBlock)) > 0)
         {
+            int removed;
+
             PlatShowMessage("Actions available:\n");
             if (result & UPDATE_REGION_EEP_ECR)
                 PlatShowMessage("\tEEPROM ECR\n");
@@ -201,6 +278,8 @@ static int UpdateEEPROM(int chassis)
                 PlatShowMessage("\tTray\n");
             if (result & UPDATE_REGION_EEGS)
                 PlatShowMessage("\tEE & GS\n");
+            if (result & UPDATE_REGION_OSD2)
+                PlatShowMessage("\tOSD2 init bit\n");
             if (result & UPDATE_REGION_ECR)
                 PlatShowMessage("\tRTC ECR\n");
             if (result & UPDATE_REGION_RTC)
@@ -213,14 +292,20 @@ static int UpdateEEPROM(int chassis)
             }
             if (result & UPDATE_REGION_DEFAULTS)
                 PlatShowMessage("\tMechacon defaults\n");
+            if (result & UPDATE_REGION_CONFIG)
+                PlatShowMessage("\tMechacon configuration\n");
+            if ((removed = MechaCommandListOptimize()) > 0)
+                PlatShowMessage("%d redundant EEPROM write(s) will be skipped.\n", removed);
 
             do
             {
                 PlatShowMessage("Proceed with updates? (y/n) ");
+                SessionWaitBegin("Proceed with updates?");
                 choice = getchar();
                 while (getchar() != '\n')
                 {
                 };
+                SessionWaitEnd();
             } while (choice != 'y' && choice != 'n');
             if (choice == 'y')
             {
@@ -246,6 +331,103 @@ static int UpdateEEPROM(int chassis)
     }
 }
 
+/*  Plans the update for every combination of MECHACON replacement, optical block and lens that the selected chassis supports.
+    Each plan is applied to a copy-on-write snapshot of the EEPROM shadow, so nothing is sent to the console.
+    Words written counts the words that the EEPROM writes of the plan change. The regions that are reset to their defaults
+    (CLEAR_CONF or SETUP_SANYO) are not known word by word, so they are only shown in the Defaults column. */
+static int PlanUpdateEEPROM(int chassis)
+{
+    struct UpdateVariant
+    {
+        int ReplacedMecha, lens, opt;
+        int writes, commands, written, defaults;
+    };
+    struct UpdateVariant variants[8], *variant;
+    const struct UpdateData *selected;
+    const MechaTask_t *task;
+    EEPSnapshot_t snapshot;
+    char RTCDataOriginal[sizeof(RTCData)];
+    unsigned short int count, i;
+    int VariantCount, ReplacedMecha, opt, lens, closest;
+
+    PlatShowMessage("Plan EEPROM update\n\n");
+    if (chassis < 0)
+    {
+        PlatShowMessage("Unsupported chassis selected.\n");
+        return -EINVAL;
+    }
+
+    selected = &UpdateFunctions[chassis];
+    memcpy(RTCDataOriginal, RTCData, sizeof(RTCData)); // The update functions update RTCData when they plan a RTC write.
+
+    for (ReplacedMecha = 0, VariantCount = 0; ReplacedMecha <= 1; ReplacedMecha++)
+    {
+        for (opt = MECHA_OP_SONY; opt <= ((selected->flags & EEPROM_UPDATE_FLAG_SANYO) ? MECHA_OP_SANYO : MECHA_OP_SONY); opt++)
+        {
+            for (lens = MECHA_LENS_T487; lens <= ((!(selected->flags & EEPROM_UPDATE_FLAG_NEW_SONY) && (opt != MECHA_OP_SANYO)) ? MECHA_LENS_T609K : MECHA_LENS_T487); lens++)
+            {
+                variant                = &variants[VariantCount++];
+                variant->ReplacedMecha = ReplacedMecha;
+                variant->opt           = opt;
+                variant->lens          = lens;
+                variant->writes        = 0;
+                variant->commands      = 0;
+                variant->defaults      = 0;
+
+                EEPSnapshotInit(&snapshot);
+                if (selected->update(0, ReplacedMecha, lens, opt) > 0)
+                {
+                    MechaCommandListOptimize();
+                    for (task = MechaCommandListGet(&count), i = 0; i < count; i++, task++)
+                    {
+                        if (task->id == MECHA_TASK_ID_UI)
+                            continue;
+
+                        variant->commands++;
+                        variant->writes += EEPSnapshotApplyTask(&snapshot, task);
+                        if (task->command == MECHA_CMD_CLEAR_CONF || task->command == MECHA_CMD_SETUP_SANYO)
+                            variant->defaults = 1;
+                    }
+                    variant->written = EEPSnapshotDiff(&snapshot);
+                }
+                else
+                    variant->commands = -1;
+
+                MechaCommandListClear();
+                memcpy(RTCData, RTCDataOriginal, sizeof(RTCData));
+            }
+        }
+    }
+
+    PlatShowMessage("    MECHACON  OP     Lens   Commands  EEPROM writes  Words written  Defaults\n");
+    for (i = 0, closest = -1; i < VariantCount; i++)
+    {
+        variant = &variants[i];
+        if (variant->commands < 0)
+        {
+            PlatShowMessage("%2d. %-8s  %-5s  %-5s  error\n", i + 1, variant->ReplacedMecha ? "replaced" : "original", MechaGetOPTypeName(variant->opt), MechaGetLensTypeName(variant->lens));
+            continue;
+        }
+
+        PlatShowMessage("%2d. %-8s  %-5s  %-5s  %8d  %13d  %13d  %s\n", i + 1, variant->ReplacedMecha ? "replaced" : "original", MechaGetOPTypeName(variant->opt), MechaGetLensTypeName(variant->lens), variant->commands, variant->writes, variant->written, variant->defaults ? "yes" : "no");
+
+        // Loading defaults overwrites whole regions, so any variant that avoids it is closer to the current state.
+        if (closest < 0 || variant->defaults < variants[closest].defaults || (variant->defaults == variants[closest].defaults && (variant->written < variants[closest].written || (variant->written == variants[closest].written && variant->commands < variants[closest].commands))))
+            closest = i;
+    }
+
+    if (closest < 0)
+    {
+        PlatShowMessage("An error occurred. Wrong chassis selected?\n");
+        return -EINVAL;
+    }
+
+    variant = &variants[closest];
+    PlatShowMessage("\nClosest to the console: %d (%s OP, %s lens, %d word(s) written)\n", closest + 1, MechaGetOPTypeName(variant->opt), MechaGetLensTypeName(variant->lens), variant->written);
+
+    return 0;
+}
+
 static int SelectChassis(void)
 {
     typedef int (*ChassisProbe_t)(void);
@@ -291,10 +473,12 @@ static int SelectChassis(void)
         {
             PlatShowMessage("Choice: ");
             choice = 0;
+            SessionWaitBegin("Chassis selection");
             if (scanf("%d", &choice) > 0)
                 while (getchar() != '\n')
                 {
                 };
+            SessionWaitEnd();
         } while (choice < 1 || choice > i + 1);
 
         --choice;
@@ -343,6 +527,7 @@ void MenuEEPROM(void)
             PlatShowMessage("B/C-chassis: EEPROM update required.\n");
         if (chassis < 0)
             chassis = SelectChassis();
+        // pmap-bench scripts choices of this menu (BENCH_EEPROM_* in PMAP-unix/bench.c): keep them in step when renumbering.
         do
         {
             PlatShowMessage("\nSelected chassis: %s\n"
@@ -364,24 +549,29 @@ void MenuEEPROM(void)
                             "\t15. Load defaults (Model Name)\n"
                             "\t16. Load defaults (SANYO OP)\n"
                             "\t17. Update EEPROM\n"
-                            "\t18. Quit\n"
+                            "\t18. Plan EEPROM update (all variants)\n"
+                            "\t19. Quit\n"
                             "\nYour choice: ",
                             chassis < 0 ? "Unknown" : ChassisNames[chassis]);
             choice = 0;
+            SessionWaitBegin("EEPROM menu");
             if (scanf("%hd", &choice) > 0)
                 while (getchar() != '\n')
                 {
                 };
-        } while (choice < 1 || choice > 18);
+            SessionWaitEnd();
+        } while (choice < 1 || choice > 19);
 
         switch (choice)
         {
             case 1:
                 DisplayCommonConsoleInfo();
                 PlatShowMessage("Press ENTER to continue\n");
+                SessionWaitBegin("Console information");
                 while (getchar() != '\n')
                 {
                 };
+                SessionWaitEnd();
                 break;
             case 2:
             {
@@ -404,18 +594,22 @@ void MenuEEPROM(void)
                 PlatShowMessage("Default filename: %s\n", default_filename);
                 PlatShowMessage("Do you want to use the default filename? (Y/N): ");
 
+                SessionWaitBegin("Dump filename");
                 if (scanf(" %c", &useDefault) > 0)
                     while (getchar() != '\n')
                     {
                     };
+                SessionWaitEnd();
 
                 if (useDefault == 'Y' || useDefault == 'y')
                     strcpy(filename, default_filename);
                 else
                 {
                     PlatShowMessage("Enter dump filename: ");
+                    SessionWaitBegin("Dump filename");
                     if (fgets(filename, sizeof(filename), stdin))
                         filename[strlen(filename) - 1] = '\0';
+                    SessionWaitEnd();
                 }
 
                 PlatShowMessage("Dump %s.\n", DumpEEPROM(filename) == 0 ? "completed" : "failed");
@@ -423,8 +617,10 @@ void MenuEEPROM(void)
             break;
             case 3:
                 PlatShowMessage("Enter dump filename: ");
+                SessionWaitBegin("Restore filename");
                 if (fgets(filename, sizeof(filename), stdin))
                 {
+                    SessionWaitEnd();
                     filename[strlen(filename) - 1] = '\0';
                     // gets(filename);
                     PlatShowMessage("Restore %s.\n", RestoreEEPROM(filename) == 0 ? "completed" : "failed");
@@ -489,6 +685,9 @@ void MenuEEPROM(void)
                 PlatShowMessage("EEPROM update: %s.\n", UpdateEEPROM(chassis) == 0 ? "completed" : "failed");
                 break;
             case 18:
+                PlanUpdateEEPROM(chassis);
+                break;
+            case 19:
                 done = 1;
                 break;
         }
@@ -39,6 +39,60 @@ void EEPMapClear(void)
     memset(EEP, 0xFF, sizeof(EEP));
 }
 
+int EEPMapIsValid(u16 word)
+{
+    return ((EEPMap[word / 32] & (1 << (word % 32))) != 0);
+}
+
+/*  Snapshots are copy-on-write views of the EEPROM shadow:
+    only the words that were written to the snapshot are kept, the others are those of the shadow. */
+void EEPSnapshotInit(EEPSnapshot_t *snapshot)
+{
+    memset(snapshot->dirty, 0, sizeof(snapshot->dirty));
+}
+
+void EEPSnapshotWrite(EEPSnapshot_t *snapshot, u16 word, u16 data)
+{
+    snapshot->data[word] = data;
+    snapshot->dirty[word / 32] |= (1 << (word % 32));
+}
+
+// Applies the effect of a queued task upon the snapshot. Returns 1 if the task is an EEPROM write.
+int EEPSnapshotApplyTask(EEPSnapshot_t *snapshot, const MechaTask_t *task)
+{
+    char value[5];
+    u16 word;
+
+    if (task->id == MECHA_TASK_ID_UI || task->command != MECHA_CMD_EEPROM_WRITE || strlen(task->args) != 8)
+        return 0;
+
+    strncpy(value, task->args, 4);
+    value[4] = '\0';
+    word     = (u16)strtoul(value, NULL, 16);
+    if (word >= 0x200)
+        return 0;
+
+    EEPSnapshotWrite(snapshot, word, (u16)strtoul(&task->args[4], NULL, 16));
+    return 1;
+}
+
+// Returns the number of words within the snapshot that differ from the shadow (words not in the shadow are counted as different).
+int EEPSnapshotDiff(const EEPSnapshot_t *snapshot)
+{
+    int word, count;
+
+    for (word = 0, count = 0; word < 0x200; word++)
+    {
+        if (snapshot->dirty[word / 32] & (1 << (word % 32)))
+        {
+            if (!EEPMapIsValid(word) || EEP[word] != snapshot->data[word])
+                count++;
+        }
+    }
+
+    return count;
+}
+
 static int EEPROMSaveSerial0(const char *data, int len)
 {
     u16 word;
@@ -138,11 +192,46 @@ int EEPROMReadWord(unsigned short int word, u16 *data)
     return result;
 }
 
+static u16 *ReadWordsData;
+static unsigned short int ReadWordsFirst;
+
+static int EEPROMReadWordsRxHandler(MechaTask_t *task, const char *result, short int len)
+{
+    if (len != 9 || result[0] != '0')
+        return -EIO;
+
+    ReadWordsData[strtoul(task->args, NULL, 16) - ReadWordsFirst] = (u16)strtoul(result + 5, NULL, 16);
+    return 0;
+}
+
+// Reads a block of words with one command list, so that the reads can be pipelined by the transport.
+int EEPROMReadWords(unsigned short int first, unsigned short int count, u16 *data)
+{
+    char address[5];
+    unsigned short int i;
+
+    if (count > MAX_MECHA_TASKS)
+        return -EINVAL;
+
+    ReadWordsData  = data;
+    ReadWordsFirst = first;
+    for (i = 0; i < count; i++)
+    {
+        snprintf(address, sizeof(address), "%04x", (u16)(first + i));
+        MechaCommandAdd(MECHA_CMD_EEPROM_READ, address, (unsigned char)(i + 1), 0, MECHA_TASK_NORMAL_TO, "EEPROM READ");
+    }
+
+    return MechaCommandExecuteList(NULL, &EEPROMReadWordsRxHandler);
+}
+
 int EEPROMWriteWord(unsigned short int word, u16 data)
 {
     char args[9], buffer[16];
     int result;
 
+    if (word < 0x200 && EEPMapIsValid(word) && EEP[word] == data)
+        return 0; // Already contains this value.
+
     snprintf(args, 9, "%04x%04x", word, data);
     if ((result = MechaCommandExecute(MECHA_CMD_EEPROM_WRITE, MECHA_TASK_NORMAL_TO, args, buffer, sizeof(buffer))) == 9)
     {
@@ -157,6 +246,9 @@ int EEPROMWriteWord(unsigned short int word, u16 data)
     if (ConMD == 40)
         result = 0;
 
+    if (result == 0 && word < 0x200 && EEPMapIsValid(word))
+        EEP[word] = data;
+
     return result;
 }
 
@@ -1,8 +1,21 @@
 u16 EEPMapRead(u16 word);
 void EEPMapWrite(u16 word, u16 data);
 void EEPMapClear(void);
+int EEPMapIsValid(u16 word);
+
+typedef struct EEPSnapshot
+{
+    u32 dirty[0x200 / 32];
+    u16 data[0x200];
+} EEPSnapshot_t;
+
+void EEPSnapshotInit(EEPSnapshot_t *snapshot);
+void EEPSnapshotWrite(EEPSnapshot_t *snapshot, u16 word, u16 data);
+int EEPSnapshotApplyTask(EEPSnapshot_t *snapshot, const MechaTask_t *task);
+int EEPSnapshotDiff(const EEPSnapshot_t *snapshot);
 
 int EEPROMReadWord(unsigned short int word, u16 *data);
+int EEPROMReadWords(unsigned short int first, unsigned short int count, u16 *data);
 int EEPROMWriteWord(unsigned short int word, u16 data);
 
 int EEPROMClear(void);
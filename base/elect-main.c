@@ -8,6 +8,7 @@
 #include "eeprom.h"
 #include "elect.h"
 #include "main.h"
+#include "session.h"
 
 extern unsigned char ElectConIsT10K;
 
@@ -17,10 +18,12 @@ static int ElectPromptT10K(void)
     do
     {
         PlatShowMessage("DTL-T10000 (YEDS-18)? [y,n] ");
+        SessionWaitBegin("DTL-T10000?");
         input = getchar();
         while (getchar() != '\n')
         {
         };
+        SessionWaitEnd();
     } while (input != 'y' && input != 'n');
 
     return (input == 'y');
@@ -48,10 +51,12 @@ void MenuELECT(void)
                "Warning! This process MAY damage the laser if the wrong type of disc is used!\n"
                "\nContinue with automatic ELECT adjustment? [y/n]");
 
+        SessionWaitBegin("Start ELECT adjustment?");
         choice = getchar();
         while (getchar() != '\n')
         {
         };
+        SessionWaitEnd();
     } while (choice != 'y' && choice != 'n');
 
     if (choice == 'y')
@@ -4,9 +4,11 @@
 #include <errno.h>
 
 #include "platform.h"
+#include "log.h"
 #include "mecha.h"
 #include "eeprom.h"
 #include "elect.h"
+#include "updates.h"
 #include "main.h"
 
 extern unsigned char ConMD, ConType, ConTM, ConCEXDEX, ConOP, ConLens, ConChecksumStat, ConSlim;
@@ -585,83 +587,79 @@ static const ElectMechaTaskPrep_t AutoAdjSlimCommands[] = {
     {-1, -1, -1, -1, NULL, NULL},
 };
 
-static int ElectJudgeOPTypeError(const char *result, int len)
+/*  The EEPROM word where CD DETECT ADJUSTMENT leaves the value that shows the type of OP installed:
+    CD-MIN on the F-chassis, CD-MAX on the G/H-chassis. NULL if the chassis has no SANYO OP. */
+static const char *ElectGetOPStudyWord(void)
 {
-    int study, OPMismatched;
-    unsigned short int minthreshold, maxthreshold;
-    const char *key;
-
     switch (ConType)
     {
         case MECHA_TYPE_F:
-            if (!pstrincmp(&result[1], "0002", 4))
-            {
-                study = (unsigned int)strtoul(&result[5], NULL, 16);
-
-                if (ConOP == MECHA_OP_SONY)
-                {
-                    minthreshold = 600;
-                    maxthreshold = 1600;
-                }
-                else if (ConOP == MECHA_OP_SANYO)
-                {
-                    minthreshold = 750;
-                    maxthreshold = 1800;
-                }
-                else
-                {
-                    PlatShowEMessage("Optical Block Type (F): unsupported OP.\n");
-                    return 1;
-                }
-
-                CDstudy = study * (5.0f / 3.0f);
-                PlatDPrintf("CDmin(d)=%d CDstudy(d)=%d CDmax(d)=%d CDdet(f)=%.0f", minthreshold, study, maxthreshold, CDstudy);
-                OPMismatched = (minthreshold >= CDstudy || maxthreshold <= CDstudy);
-            }
-            else
-            {
-                PlatShowEMessage("Optical Block Type (F): unrecognized data.\n");
-                return 1;
-            }
-            break;
+            return "0002";
         case MECHA_TYPE_G:
         case MECHA_TYPE_G2:
+            return "0003";
         case MECHA_TYPE_40:
-            key = (ConType == MECHA_TYPE_40) ? "0034" : "0003";
-            if (!pstrincmp(&result[1], key, 4))
-            {
-                study = (unsigned int)strtoul(&result[5], NULL, 16);
+            return "0034";
+        default:
+            return NULL;
+    }
+}
 
-                if (ConOP == MECHA_OP_SONY)
-                {
-                    minthreshold = 660;
-                    maxthreshold = 1760;
-                }
-                else if (ConOP == MECHA_OP_SANYO)
-                {
-                    minthreshold = 825;
-                    maxthreshold = 1980;
-                }
-                else
-                {
-                    PlatShowEMessage("Optical Block Type (G/H): unsupported OP.\n");
-                    return 1;
-                }
+// The range of the CD DET value for an OP type.
+static int ElectGetOPRange(int op, unsigned short int *min, unsigned short int *max)
+{
+    if (op == MECHA_OP_SONY)
+    {
+        *min = ConType == MECHA_TYPE_F ? 600 : 660;
+        *max = ConType == MECHA_TYPE_F ? 1600 : 1760;
+    }
+    else if (op == MECHA_OP_SANYO)
+    {
+        *min = ConType == MECHA_TYPE_F ? 750 : 825;
+        *max = ConType == MECHA_TYPE_F ? 1800 : 1980;
+    }
+    else
+        return 1;
 
-                CDstudy = study * (2.0f / 3.0f);
-                PlatDPrintf("CDmin(d)=%d CDstudy(d)=%d CDmax(d)=%d CDdet(f)=%.0f", minthreshold, study, maxthreshold, CDstudy);
-                OPMismatched = (minthreshold >= CDstudy || maxthreshold <= CDstudy);
-            }
-            else
+    return 0;
+}
+
+static float ElectGetCDdet(unsigned int study)
+{
+    return study * (ConType == MECHA_TYPE_F ? (5.0f / 3.0f) : (2.0f / 3.0f));
+}
+
+static int ElectJudgeOPTypeError(const char *result, int len)
+{
+    int study, OPMismatched;
+    unsigned short int minthreshold, maxthreshold;
+    const char *key, *chassis;
+
+    if ((key = ElectGetOPStudyWord()) != NULL)
+    {
+        chassis = ConType == MECHA_TYPE_F ? "F" : "G/H";
+        if (!pstrincmp(&result[1], key, 4))
+        {
+            study = (unsigned int)strtoul(&result[5], NULL, 16);
+
+            if (ElectGetOPRange(ConOP, &minthreshold, &maxthreshold) != 0)
             {
-                PlatShowEMessage("Optical Block Type (G/H): unrecognized data.\n");
+                PlatShowEMessage("Optical Block Type (%s): unsupported OP.\n", chassis);
                 return 1;
             }
-            break;
-        default:
-            OPMismatched = 0;
-            break;
+
+            CDstudy = ElectGetCDdet(study);
+            LogPrintf(LOG_JUDGE, LOG_INFO, "CDmin(d)=%d CDstudy(d)=%d CDmax(d)=%d CDdet(f)=%.0f", minthreshold, study, maxthreshold, CDstudy);
+            OPMismatched = (minthreshold >= CDstudy || maxthreshold <= CDstudy);
+        }
+        else
+        {
+            PlatShowEMessage("Optical Block Type (%s): unrecognized data.\n", chassis);
+            return 1;
+        }
     }
+    else
+        OPMismatched = 0;
 
     if (OPMismatched)
     {
@@ -669,7 +667,7 @@ static int ElectJudgeOPTypeError(const char *result, int len)
     }
     else
     {
-        PlatDPrintf("Optical Block Type (%s) OK.\n", ConOP == MECHA_OP_SONY ? "SONY" : "SANYO");
+        LogPrintf(LOG_JUDGE, LOG_INFO, "Optical Block Type (%s) OK.\n", ConOP == MECHA_OP_SONY ? "SONY" : "SANYO");
     }
 
     return OPMismatched;
@@ -682,7 +680,7 @@ static int ElectJudgeCDFELoopGain(const char *result, int len)
     value = (unsigned int)strtoul(&result[1], NULL, 16);
     if (value >= 0x08 && value <= 0x60)
     {
-        PlatDPrintf("CD FE LOOP GAIN OK: %d\n", value);
+        LogPrintf(LOG_JUDGE, LOG_INFO, "CD FE LOOP GAIN OK: %d\n", value);
         return 0;
     }
     else
@@ -699,7 +697,7 @@ static int ElectJudgeCDTELoopGain(const char *result, int len)
     value = (unsigned int)strtoul(&result[1], NULL, 16);
     if (value >= 0x10 && value <= 0x60)
     {
-        PlatDPrintf("CD TE LOOP GAIN OK: %d\n", value);
+        LogPrintf(LOG_JUDGE, LOG_INFO, "CD TE LOOP GAIN OK: %d\n", value);
         return 0;
     }
     else
@@ -725,12 +723,12 @@ static int ElectJudgeDiscDetectRatio(const char *result, int len)
                 DVDRatio = ratio = (float)(max * 3) / (DVDmin * 7);
                 if (ratio >= 1.8f)
                 {
-                    PlatDPrintf("CD/DVD DiscDetect Ratio OK: %f\n", ratio);
+                    LogPrintf(LOG_JUDGE, LOG_INFO, "CD/DVD DiscDetect Ratio OK: %f\n", ratio);
                     return 0;
                 }
                 else
                 {
-                    PlatDPrintf("CD/DVD DiscDetect Ratio NG: %f\n", ratio);
+                    LogPrintf(LOG_JUDGE, LOG_INFO, "CD/DVD DiscDetect Ratio NG: %f\n", ratio);
                     PlatShowEMessage("CD/DVD DiscDetect Ratio NG: %f\n", ratio);
                     return 0;
                 }
@@ -740,12 +738,12 @@ static int ElectJudgeDiscDetectRatio(const char *result, int len)
                 DVDRatio = ratio = (float)max / (DVDmin * 3);
                 if (ratio >= 1.73f)
                 {
-                    PlatDPrintf("CD/DVD DiscDetect Ratio OK: %f\n", ratio);
+                    LogPrintf(LOG_JUDGE, LOG_INFO, "CD/DVD DiscDetect Ratio OK: %f\n", ratio);
                     return 0;
                 }
                 else
                 {
-                    PlatDPrintf("CD/DVD DiscDetect Ratio NG: %f\n", ratio);
+                    LogPrintf(LOG_JUDGE, LOG_INFO, "CD/DVD DiscDetect Ratio NG: %f\n", ratio);
                     PlatShowEMessage("CD/DVD DiscDetect Ratio NG: %f\n", ratio);
                     return 0;
                 }
@@ -801,7 +799,7 @@ static int ElectJudgeDVDSLFELoopGain(const char *result, int len)
     value = (unsigned int)strtoul(&result[1], NULL, 16);
     if (value >= 0x08 && value <= 0x60)
     {
-        PlatDPrintf("DVD-SL FE LOOP GAIN OK: %d\n", value);
+        LogPrintf(LOG_JUDGE, LOG_INFO, "DVD-SL FE LOOP GAIN OK: %d\n", value);
         return 0;
     }
     else
@@ -818,7 +816,7 @@ static int ElectJudgeDVDSLTELoopGain(const char *result, int len)
     value = (unsigned int)strtoul(&result[1], NULL, 16);
     if (value >= 0x10 && value <= 0x60)
     {
-        PlatDPrintf("DVD-SL TE LOOP GAIN OK: %d\n", value);
+        LogPrintf(LOG_JUDGE, LOG_INFO, "DVD-SL TE LOOP GAIN OK: %d\n", value);
         return 0;
     }
     else
@@ -848,7 +846,7 @@ static int ElectJudgeDVDSLJitter256(const char *result, int len)
     value = (unsigned int)strtoul(&result[1], NULL, 16);
     if (value <= threshold)
     {
-        PlatDPrintf("DVD-SL jitter(256) OK: %d\n", value);
+        LogPrintf(LOG_JUDGE, LOG_INFO, "DVD-SL jitter(256) OK: %d\n", value);
         return 0;
     }
     else
@@ -865,7 +863,7 @@ static int ElectJudgeDVDSLPIPOCC(const char *result, int len)
     value = (unsigned int)strtoul(&result[1], NULL, 16);
     if (value <= 100)
     {
-        PlatDPrintf("DVD-SL PI+PO-CC OK: %d\n", value);
+        LogPrintf(LOG_JUDGE, LOG_INFO, "DVD-SL PI+PO-CC OK: %d\n", value);
         return 0;
     }
     else
@@ -882,7 +880,7 @@ static int ElectJudgeDVDSLPONCC(const char *result, int len)
     value = (unsigned int)strtoul(&result[1], NULL, 16);
     if (value == 0)
     {
-        PlatDPrintf("DVD-SL PO-NCC OK: %d\n", value);
+        LogPrintf(LOG_JUDGE, LOG_INFO, "DVD-SL PO-NCC OK: %d\n", value);
         return 0;
     }
     else
@@ -899,7 +897,7 @@ static int ElectJudgeDVDDLDiscDetect(const char *result, int len)
     value = (unsigned int)strtoul(&result[1], NULL, 16);
     if (value == DISC_TYPE_DVDD12)
     {
-        PlatDPrintf("DVD-DL DISC DETECT OK: %d\n", value);
+        LogPrintf(LOG_JUDGE, LOG_INFO, "DVD-DL DISC DETECT OK: %d\n", value);
         return 0;
     }
     else
@@ -916,7 +914,7 @@ static int ElectJudgeDVDDLL0FELoopGain(const char *result, int len)
     value = (unsigned int)strtoul(&result[1], NULL, 16);
     if (value >= 0x08 && value <= 0x60)
     {
-        PlatDPrintf("DVD-DL-L0 FE LOOP GAIN OK: %d\n", value);
+        LogPrintf(LOG_JUDGE, LOG_INFO, "DVD-DL-L0 FE LOOP GAIN OK: %d\n", value);
         return 0;
     }
     else
@@ -933,7 +931,7 @@ static int ElectJudgeDVDDLL0TELoopGain(const char *result, int len)
     value = (unsigned int)strtoul(&result[1], NULL, 16);
     if (value >= 0x10 && value <= 0x60)
     {
-        PlatDPrintf("DVD-DL-L0 TE LOOP GAIN OK: %d\n", value);
+        LogPrintf(LOG_JUDGE, LOG_INFO, "DVD-DL-L0 TE LOOP GAIN OK: %d\n", value);
         return 0;
     }
     else
@@ -963,7 +961,7 @@ static int ElectJudgeDVDDLL0Jitter256(const char *result, int len)
     value = (unsigned int)strtoul(&result[1], NULL, 16);
     if (value <= threshold)
     {
-        PlatDPrintf("DVD-DL-L0 jitter(256) OK: %d\n", value);
+        LogPrintf(LOG_JUDGE, LOG_INFO, "DVD-DL-L0 jitter(256) OK: %d\n", value);
         return 0;
     }
     else
@@ -980,7 +978,7 @@ static int ElectJudgeDVDDLL1FELoopGain(const char *result, int len)
     value = (unsigned int)strtoul(&result[1], NULL, 16);
     if (value >= 0x08 && value <= 0x60)
     {
-        PlatDPrintf("DVD-DL-L1 FE LOOP GAIN OK: %d\n", value);
+        LogPrintf(LOG_JUDGE, LOG_INFO, "DVD-DL-L1 FE LOOP GAIN OK: %d\n", value);
         return 0;
     }
     else
@@ -997,7 +995,7 @@ static int ElectJudgeDVDDLL1TELoopGain(const char *result, int len)
     value = (unsigned int)strtoul(&result[1], NULL, 16);
     if (value >= 0x10 && value <= 0x60)
     {
-        PlatDPrintf("DVD-DL-L1 TE LOOP GAIN OK: %d\n", value);
+        LogPrintf(LOG_JUDGE, LOG_INFO, "DVD-DL-L1 TE LOOP GAIN OK: %d\n", value);
         return 0;
     }
     else
@@ -1027,7 +1025,7 @@ static int ElectJudgeDVDDLL1Jitter256(const char *result, int len)
     value = (unsigned int)strtoul(&result[1], NULL, 16);
     if (value <= threshold)
     {
-        PlatDPrintf("DVD-DL-L1 jitter(256) OK: %d\n", value);
+        LogPrintf(LOG_JUDGE, LOG_INFO, "DVD-DL-L1 jitter(256) OK: %d\n", value);
         return 0;
     }
     else
@@ -1044,7 +1042,7 @@ static int ElectJudgeChecksum(const char *result, int len)
     value = (unsigned int)strtoul(&result[1], NULL, 16);
     if (value == 0)
     {
-        PlatDPrintf("EEPROM checksum OK: %d\n", value);
+        LogPrintf(LOG_JUDGE, LOG_INFO, "EEPROM checksum OK: %d\n", value);
         return 0;
     }
     else
@@ -1070,7 +1068,7 @@ static int ElectJudgeFCSSearchData(const char *data, int len)
 
         if ((result >= -10) && (result <= 10))
         {
-            PlatDPrintf("FCS Search Data OK: %d\n", result);
+            LogPrintf(LOG_JUDGE, LOG_INFO, "FCS Search Data OK: %d\n", result);
             return 0;
         }
         else
@@ -1114,7 +1112,7 @@ static int ElectJudgeDVDSLJitter256WithRetry(const char *result, int len)
     if (value <= (ConCEXDEX ? 0x3E00 : 0x2970))
     {
         Enable2ndJitter256Check = 0;
-        PlatDPrintf("DVD-SL jitter(256)_WITH_RETRY OK: %d\n", value);
+        LogPrintf(LOG_JUDGE, LOG_INFO, "DVD-SL jitter(256)_WITH_RETRY OK: %d\n", value);
     }
     else
     {
@@ -1136,7 +1134,7 @@ static int ElectJudgeDVDDLL0Jitter256WithRetry(const char *result, int len)
     if (value <= (ConCEXDEX ? 0x4C00 : 0x2D00))
     {
         Enable2ndJitter256Check = 0;
-        PlatDPrintf("DVD-DL-L0 jitter(256)_WITH_RETRY OK: %d\n", value);
+        LogPrintf(LOG_JUDGE, LOG_INFO, "DVD-DL-L0 jitter(256)_WITH_RETRY OK: %d\n", value);
     }
     else
     {
@@ -1158,7 +1156,7 @@ static int ElectJudgeDVDDLL1Jitter256WithRetry(const char *result, int len)
     if (value <= (ConCEXDEX ? 0x4C00 : 0x2D00))
     {
         Enable2ndJitter256Check = 0;
-        PlatDPrintf("DVD-DL-L0 jitter(256)_WITH_RETRY OK: %d\n", value);
+        LogPrintf(LOG_JUDGE, LOG_INFO, "DVD-DL-L0 jitter(256)_WITH_RETRY OK: %d\n", value);
     }
     else
     {
@@ -1195,7 +1193,7 @@ static int ElectJudgeCDRFDCLevel(const char *data, int len)
 
     if (result >= 0x49 && result <= 0x89)
     {
-        PlatDPrintf("CD RFDC level OK: %d\n", result);
+        LogPrintf(LOG_JUDGE, LOG_INFO, "CD RFDC level OK: %d\n", result);
         return 0;
     }
     else
@@ -1219,7 +1217,7 @@ static int ElectJudgeDVDSLRFDCLevel(const char *data, int len)
 
     if (result >= 0x35)
     {
-        PlatDPrintf("DVD-SL RFDC level OK: %d\n", result);
+        LogPrintf(LOG_JUDGE, LOG_INFO, "DVD-SL RFDC level OK: %d\n", result);
         return 0;
     }
     else
@@ -1243,7 +1241,7 @@ static int ElectJudgeDVDDLL0RFDCLevel(const char *data, int len)
 
     if (result >= 0x35)
     {
-        PlatDPrintf("DVD-DL-L0 RFDC level OK: %d\n", result);
+        LogPrintf(LOG_JUDGE, LOG_INFO, "DVD-DL-L0 RFDC level OK: %d\n", result);
         return 0;
     }
     else
@@ -1267,12 +1265,12 @@ static int ElectJudgeDVDDLL1RFDCLevel(const char *data, int len)
 
     if (result >= 0x35)
     {
-        PlatDPrintf("DVD-DL-L1 RFDC level OK: %d\n, result");
+        LogPrintf(LOG_JUDGE, LOG_INFO, "DVD-DL-L1 RFDC level OK: %d\n", result);
         return 0;
     }
     else
     {
-        PlatShowEMessage("DVD-DL-L1 RFDC level NG: %d\n, result");
+        PlatShowEMessage("DVD-DL-L1 RFDC level NG: %d\n", result);
         return (ConSlim == 1) ? 0 : 1;
     }
 }
@@ -1302,14 +1300,14 @@ static int ElectJudgeCDTPP(const char *data, int len)
 
     if (value1 >= 0x35 && value1 <= 0x7E) // TPP check
     {
-        PlatDPrintf("CD TPP OK: %d\n", value1);
+        LogPrintf(LOG_JUDGE, LOG_INFO, "CD TPP OK: %d\n", value1);
         // Tbal check
         sub32 = value3 - value2;
         Tbal  = (int)((value1 * 0.5f - sub32) / value1 * 100);
 
         if (Tbal >= -30 && Tbal <= 30)
         {
-            PlatDPrintf("CD TPP Tbal  OK: %ld\n", Tbal);
+            LogPrintf(LOG_JUDGE, LOG_INFO, "CD TPP Tbal  OK: %ld\n", Tbal);
             return 0;
         }
         else
@@ -1359,7 +1357,7 @@ static int JudgeDVDSLFocusOffset(const char *data, int len)
 
     if (min <= offset && offset <= max)
     {
-        PlatDPrintf("DVD-SL FOCUS OFFSET Check OK: %f\n", offset);
+        LogPrintf(LOG_JUDGE, LOG_INFO, "DVD-SL FOCUS OFFSET Check OK: %f\n", offset);
         return 0;
     }
     else
@@ -1384,7 +1382,7 @@ static int JudgeDVDSLDeFocusOffset(const char *data, int len)
 
     if (result >= -16.0f && result <= 16.0f)
     {
-        PlatDPrintf("DVD-SL DE-FOCUS OFFSET Check OK: %f\n", result);
+        LogPrintf(LOG_JUDGE, LOG_INFO, "DVD-SL DE-FOCUS OFFSET Check OK: %f\n", result);
         return 0;
     }
     else
@@ -1406,11 +1404,11 @@ static int JudgeDVDSLFBOffset(const char *data, int len)
 
     if ((FbOffsetHi <= 0x4C) || (FbOffsetHi >= 0xB4 && FbOffsetHi <= 0xFF))
     {
-        PlatDPrintf("DVD-SL FB OFFSET (HI) OK: %d\n", FbOffsetHi);
+        LogPrintf(LOG_JUDGE, LOG_INFO, "DVD-SL FB OFFSET (HI) OK: %d\n", FbOffsetHi);
 
         if ((FbOffsetLo <= 0x4C) || (FbOffsetLo >= 0xB4 && FbOffsetLo <= 0xFF))
         {
-            PlatDPrintf("DVD-SL FB OFFSET (LO) Check OK: %d\n", FbOffsetLo);
+            LogPrintf(LOG_JUDGE, LOG_INFO, "DVD-SL FB OFFSET (LO) Check OK: %d\n", FbOffsetLo);
             return 0;
         }
         else
@@ -1594,6 +1592,83 @@ static int ElectRxHandler(MechaTask_t *task, const char *result, short int len)
     }
 }
 
+/*  OP pre-check, before the EEPROM update: CD DETECT ADJUSTMENT is done on the test CD and the value that
+    ElectJudgeOPTypeError() checks is read, to tell which types of OP it fits. As the ranges of the SONY and SANYO OPs
+    overlap, it may fit both. The detection writes to the disc-detect region, which is restored afterwards.
+    types: (1 << MECHA_OP_SONY) and/or (1 << MECHA_OP_SANYO). Returns -ENOTSUP if the chassis has no SANYO OP. */
+int ElectDetectOP(unsigned char *types)
+{
+    u16 before[ELECT_DISCDET_WORDS + 1], after[ELECT_DISCDET_WORDS + 1], study;
+    unsigned short int SonyMin, SonyMax, SanyoMin, SanyoMax, word, count, i;
+    const char *key;
+    char args[9];
+    unsigned char id;
+    int result, restore;
+    float CDdet;
+
+    if ((key = ElectGetOPStudyWord()) == NULL)
+        return -ENOTSUP;
+
+    // The Dragon keeps its study word after the disc-detect region.
+    word  = (unsigned short int)strtoul(key, NULL, 16);
+    count = word < ELECT_DISCDET_WORDS ? ELECT_DISCDET_WORDS : ELECT_DISCDET_WORDS + 1;
+    if ((result = EEPROMReadWords(0, ELECT_DISCDET_WORDS, before)) != 0 || (count > ELECT_DISCDET_WORDS && (result = EEPROMReadWord(word, &before[ELECT_DISCDET_WORDS])) != 0))
+        return result;
+
+    id = 1;
+    MechaCommandAdd(MECHA_CMD_DISC_MODE_CD_12, NULL, id++, 0, 1000, "DISC MODE CD 12cm");
+    MechaCommandAdd(MECHA_CMD_FOCUS_UPDOWN, "00", id++, 0, 3000, "FOCUS UP/DOWN END");
+    MechaCommandAdd(MECHA_CMD_SLED_POS_HOME, NULL, id++, 0, 3000, "CD SLED HOME POSITION");
+    MechaCommandAdd(MECHA_CMD_TRAY, "00", id++, 0, 6000, "CD TRAY CLOSE");
+    MechaCommandAdd(MECHA_CMD_TRAY, "01", id++, 0, 6000, "CD START (TRAY OPEN)");
+    MechaCommandAdd(MECHA_TASK_UI_CMD_MSG, NULL, MECHA_TASK_ID_UI, 0, 0, "Insert test CD and press ENTER");
+    MechaCommandAdd(MECHA_CMD_TRAY, "00", id++, 0, 6000, "CD TRAY CLOSE");
+    MechaCommandAdd(MECHA_CMD_SLED_POS_HOME, NULL, id++, 0, 3000, "CD SLED HOME POSITION");
+    MechaCommandAdd(MECHA_CMD_DETECT_ADJ, "00", id++, 0, ConType == MECHA_TYPE_40 ? 15000 : 6000, "CD DETECT ADJUSTMENT");
+    if ((result = MechaCommandExecuteList(NULL, &ElectRxHandler)) == 0)
+        result = EEPROMReadWord(word, &study);
+
+    // Restore whatever the detection changed, even if it failed.
+    id      = 1;
+    restore = 0;
+    if (EEPROMReadWords(0, ELECT_DISCDET_WORDS, after) == 0 && (count == ELECT_DISCDET_WORDS || EEPROMReadWord(word, &after[ELECT_DISCDET_WORDS]) == 0))
+    {
+        for (i = 0; i < count; i++)
+        {
+            if (after[i] != before[i])
+            {
+                snprintf(args, sizeof(args), "%04x%04x", i < ELECT_DISCDET_WORDS ? i : word, before[i]);
+                MechaCommandAdd(MECHA_CMD_EEPROM_WRITE, args, id++, 0, MECHA_TASK_NORMAL_TO, "EEPROM WR (DISC DETECT RESTORE)");
+                restore = 1;
+            }
+        }
+    }
+    else
+        PlatShowEMessage("OP pre-check: the disc-detect region could not be read back.\n");
+    if (restore)
+        MechaAddPostUpdateCmds(UPDATE_REGION_DISCDET, id);
+    MechaCommandAdd(MECHA_CMD_FOCUS_UPDOWN, "00", id++, 0, 3000, "CD STOP");
+    MechaCommandAdd(MECHA_CMD_SLED_POS_HOME, NULL, id++, 0, 3000, "FIN (SLED HOME)");
+    if (MechaCommandExecuteList(NULL, NULL) != 0)
+        PlatShowEMessage(restore ? "OP pre-check: the disc-detect region could not be restored.\n" : "OP pre-check: the drive could not be stopped.\n");
+
+    if (result != 0)
+        return result < 0 ? result : -EIO;
+
+    CDdet = ElectGetCDdet(study);
+    ElectGetOPRange(MECHA_OP_SONY, &SonyMin, &SonyMax);
+    ElectGetOPRange(MECHA_OP_SANYO, &SanyoMin, &SanyoMax);
+    *types = 0;
+    if (SonyMin < CDdet && CDdet < SonyMax)
+        *types |= 1 << MECHA_OP_SONY;
+    if (SanyoMin < CDdet && CDdet < SanyoMax)
+        *types |= 1 << MECHA_OP_SANYO;
+    LogPrintf(LOG_JUDGE, LOG_INFO, "OP pre-check: CDstudy(d)=%d CDdet(f)=%.0f SONY %d-%d SANYO %d-%d\n", study, CDdet, SonyMin, SonyMax, SanyoMin, SanyoMax);
+    PlatShowMessage("CD DET: %.0f (SONY OP: %d-%d, SANYO OP: %d-%d)\n", CDdet, SonyMin, SonyMax, SanyoMin, SanyoMax);
+
+    return 0;
+}
+
 int ElectAutoAdjust(void)
 {
     int result;
@@ -1628,9 +1703,9 @@ int ElectAutoAdjust(void)
             return EINVAL;
     }
 
-    PlatDPrintf("\n--- AUTO ELECT ADJUSTMENT START ---\n"
-                "MECHA type: %d\n\n",
-                ConType);
+    LogPrintf(LOG_JUDGE, LOG_INFO, "\n--- AUTO ELECT ADJUSTMENT START ---\n"
+                                   "MECHA type: %d\n\n",
+                                   ConType);
 
     for (result = 0; cmd->id != 0xFF; cmd++)
     {
@@ -1645,9 +1720,9 @@ int ElectAutoAdjust(void)
     else
         MechaCommandListClear();
 
-    PlatDPrintf("\nAdjustment result: %d\n"
-                "--- AUTO ELECT ADJUSTMENT FIN ---\n",
-                result);
+    LogPrintf(LOG_JUDGE, LOG_INFO, "\nAdjustment result: %d\n"
+                                   "--- AUTO ELECT ADJUSTMENT FIN ---\n",
+                                   result);
 
     return result;
 }
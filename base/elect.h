@@ -62,4 +62,7 @@
         Disc Detect CD/DVD Ratio:  >= 1.80 / G/H/I-chassis: >=1.73
         EEPROM Checksum:                         0 */
 
+#define ELECT_DISCDET_WORDS 0x0e // The disc-detect region of the EEPROM (0x000-0x00d).
+
 int ElectAutoAdjust(void);
+int ElectDetectOP(unsigned char *types); // OP pre-check: the types of OP (1 << MECHA_OP_*) that the CD DET value fits.
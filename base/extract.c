@@ -0,0 +1,379 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "platform.h"
+#include "mecha.h"
+#include "eeprom.h"
+#include "extract.h"
+
+#define EXTRACT_TAR_BLOCK 512
+
+struct ExtractImage
+{
+    char file[EXTRACT_NAME_MAX];
+    char member[EXTRACT_NAME_MAX]; // Name within a tar archive, or empty.
+    long offset;
+    int status; // 0 = decoded, otherwise not an EEPROM dump.
+    char row[EXTRACT_ROW_MAX];
+};
+
+static struct ExtractImage *images;
+static unsigned int ImageCount, ImageMax;
+
+// One output format: the CSV columns, and the function that formats the row of a dump.
+struct ExtractFormat
+{
+    const char *columns;
+    void (*format)(struct ExtractImage *image, const u16 *words, int IsNew);
+    const char *done; // Of the summary message.
+};
+
+static const struct ExtractChassis
+{
+    int (*probe)(const MechaImage_t *image);
+    const char *name;
+} ExtractChassisList[] = {
+    {&MechaImageIsChassisCex10000, "A-10000"},
+    {&MechaImageIsChassisA, "A"},
+    {&MechaImageIsChassisB, "B"},
+    {&MechaImageIsChassisC, "C"},
+    {&MechaImageIsChassisD, "D"},
+    {&MechaImageIsChassisF, "F"},
+    {&MechaImageIsChassisG, "G"},
+    {&MechaImageIsChassisDragon, "Dragon"},
+    {&MechaImageIsChassisDexA, "DEX-A"},
+    {&MechaImageIsChassisDexB, "DEX-B"},
+    {&MechaImageIsChassisDexD, "DEX-D"}};
+
+static struct ExtractImage *ExtractAddImage(const char *file, const char *member, long offset)
+{
+    struct ExtractImage *image;
+
+    if (ImageCount == ImageMax)
+    {
+        ImageMax = ImageMax == 0 ? 256 : ImageMax * 2;
+        if ((image = realloc(images, ImageMax * sizeof(struct ExtractImage))) == NULL)
+            return NULL;
+        images = image;
+    }
+
+    image = &images[ImageCount++];
+    snprintf(image->file, sizeof(image->file), "%s", file);
+    snprintf(image->member, sizeof(image->member), "%s", member);
+    image->offset = offset;
+    image->status = -1;
+    image->row[0] = '\0';
+
+    return image;
+}
+
+/*  Only regular files of EXTRACT_IMAGE_SIZE bytes are added.
+    GNU and PAX extensions (i.e. long names) are not supported: such members are added under their short names. */
+static int ExtractScanTar(const char *file)
+{
+    FILE *archive;
+    unsigned char header[EXTRACT_TAR_BLOCK];
+    char size[13], name[EXTRACT_NAME_MAX];
+    long position, length;
+    int i;
+
+    if ((archive = fopen(file, "rb")) == NULL)
+    {
+        PlatShowMessage("Cannot open %s.\n", file);
+        return 0;
+    }
+
+    position = 0;
+    while (fread(header, 1, sizeof(header), archive) == sizeof(header))
+    {
+        for (i = 0; i < EXTRACT_TAR_BLOCK && header[i] == 0; i++)
+            ;
+        if (i == EXTRACT_TAR_BLOCK) // End of archive
+            break;
+
+        memcpy(size, &header[124], 12);
+        size[12] = '\0';
+        length   = strtol(size, NULL, 8);
+
+        if ((header[156] == '0' || header[156] == '\0') && length == EXTRACT_IMAGE_SIZE)
+        {
+            if (!memcmp(&header[257], "ustar", 5) && header[345] != '\0')
+                snprintf(name, sizeof(name), "%.155s/%.100s", (const char *)&header[345], (const char *)header);
+            else
+                snprintf(name, sizeof(name), "%.100s", (const char *)header);
+            if (ExtractAddImage(file, name, position + EXTRACT_TAR_BLOCK) == NULL)
+            {
+                fclose(archive);
+                return -ENOMEM;
+            }
+        }
+
+        position += EXTRACT_TAR_BLOCK + (length + EXTRACT_TAR_BLOCK - 1) / EXTRACT_TAR_BLOCK * EXTRACT_TAR_BLOCK;
+        if (fseek(archive, position, SEEK_SET) != 0)
+            break;
+    }
+    fclose(archive);
+
+    return 0;
+}
+
+static int ExtractAddFile(const char *file, void *arg)
+{
+    int len;
+
+    len = (int)strlen(file);
+    if (len > 4 && !pstricmp(&file[len - 4], ".tar"))
+        return ExtractScanTar(file);
+
+    return (ExtractAddImage(file, "", 0) == NULL ? -ENOMEM : 0);
+}
+
+static int ExtractCompareImages(const void *a, const void *b)
+{
+    const struct ExtractImage *ImageA = (const struct ExtractImage *)a, *ImageB = (const struct ExtractImage *)b;
+    int result;
+
+    if ((result = strcmp(ImageA->file, ImageB->file)) == 0)
+        result = strcmp(ImageA->member, ImageB->member);
+    return result;
+}
+
+// The model name is expected to start with at least 4 printable characters (i.e. "SCPH" or "DTL-").
+static int ExtractIsModelName(const u16 *words, unsigned short int address)
+{
+    int i;
+    unsigned char c;
+
+    for (i = 0; i < 4; i++)
+    {
+        c = (i & 1) ? words[address + i / 2] >> 8 : words[address + i / 2] & 0xFF;
+        if (!isprint(c))
+            return 0;
+    }
+
+    return 1;
+}
+
+// For dumps without a model name: the Dragon chassis IDs are not used by the old layout.
+static int ExtractIsDragon(const u16 *words)
+{
+    switch (words[EEPROM_MAP_CON_NEW])
+    {
+        case MECHA_CHASSIS_H_SONY:
+        case MECHA_CHASSIS_H_SANYO:
+        case MECHA_CHASSIS_SLIM:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// Bytes are stored low byte first, like the EEPROM functions read them.
+static void ExtractFormatBytes(char *out, int size, const u16 *words, unsigned short int address, int count, int text)
+{
+    int i, len;
+    unsigned char c;
+
+    for (i = 0, len = 0; i < count * 2 && len + (text ? 1 : 2) < size; i++)
+    {
+        c = (i & 1) ? words[address + i / 2] >> 8 : words[address + i / 2] & 0xFF;
+        if (text)
+        {
+            if (c == '\0')
+                break;
+            out[len++] = (isprint(c) && c != ',' && c != '"') ? c : '?';
+        }
+        else
+            len += snprintf(&out[len], size - len, "%02x", c);
+    }
+    out[len] = '\0';
+}
+
+static void ExtractFormatWords(char *out, int size, const u16 *words, unsigned short int address, int count)
+{
+    int i, len;
+
+    for (i = 0, len = 0; i < count && len + 4 < size; i++)
+        len += snprintf(&out[len], size - len, "%04x", words[address + i]);
+    out[len] = '\0';
+}
+
+static void ExtractFormatFields(struct ExtractImage *image, const u16 *words, int IsNew)
+{
+    char ModelName[17], iLinkID[17], ConsoleID[17], eegs[33], osd2[33];
+    u16 con;
+
+    con = words[IsNew ? EEPROM_MAP_CON_NEW : EEPROM_MAP_CON];
+
+    ExtractFormatBytes(ModelName, sizeof(ModelName), words, IsNew ? EEPROM_MAP_MODEL_NAME_NEW_0 : EEPROM_MAP_MODEL_NAME_0, 8, 1);
+    ExtractFormatBytes(iLinkID, sizeof(iLinkID), words, IsNew ? EEPROM_MAP_ILINK_ID_NEW_0 : EEPROM_MAP_ILINK_ID_0, 4, 0);
+    ExtractFormatBytes(ConsoleID, sizeof(ConsoleID), words, IsNew ? EEPROM_MAP_CON_ID_NEW_0 : EEPROM_MAP_CON_ID_0, 4, 0);
+    ExtractFormatWords(eegs, sizeof(eegs), words, IsNew ? EEPROM_MAP_EEGS_NEW_0 : EEPROM_MAP_EEGS_0, 8);
+    ExtractFormatWords(osd2, sizeof(osd2), words, IsNew ? EEPROM_MAP_OSD2_NEW_0 : EEPROM_MAP_OSD2_0, 8);
+
+    // The CEX/DEX and OP bits are only defined for the old layout.
+    snprintf(image->row, sizeof(image->row), "%s,%04x,%s,%s,%04x,%04x,%04x,%04x,%s,%04x,%s,%s,%07u,%02x,%s,%s,%d\n",
+             IsNew ? "new" : "old", con,
+             IsNew ? "" : ((con & 1) ? "CEX" : "DEX"),
+             IsNew ? "" : ((con & 0x20) ? "SANYO" : "SONY"),
+             words[EEPROM_MAP_OPT_12], words[EEPROM_MAP_OPT_13], words[EEPROM_MAP_ECR], words[EEPROM_MAP_FOK],
+             ModelName, words[IsNew ? EEPROM_MAP_MODEL_ID_NEW : EEPROM_MAP_MODEL_ID], iLinkID, ConsoleID,
+             words[IsNew ? EEPROM_MAP_SERIAL_NEW_0 : EEPROM_MAP_SERIAL_0] | ((words[IsNew ? EEPROM_MAP_SERIAL_NEW_1 : EEPROM_MAP_SERIAL_1] & 0xFF) << 16),
+             words[IsNew ? EEPROM_MAP_SERIAL_NEW_1 : EEPROM_MAP_SERIAL_1] >> 8,
+             eegs, osd2, (words[IsNew ? EEPROM_MAP_OSD2_17_NEW : EEPROM_MAP_OSD2_17] & 0x80) ? 1 : 0);
+}
+
+// Classified with the identification functions of the MECHACON module. Every chassis that matches is listed.
+static void ExtractFormatClass(struct ExtractImage *image, const u16 *words, int IsNew)
+{
+    MechaImage_t MechaImage;
+    char chassis[64], ModelName[17];
+    int i, len, lens, op, cexdex;
+
+    MechaImageFromDump(&MechaImage, words, IsNew);
+    for (i = 0, len = 0, chassis[0] = '\0'; i < (int)(sizeof(ExtractChassisList) / sizeof(ExtractChassisList[0])); i++)
+    {
+        if (ExtractChassisList[i].probe(&MechaImage))
+            len += snprintf(&chassis[len], sizeof(chassis) - len, "%s%s", len > 0 ? "/" : "", ExtractChassisList[i].name);
+    }
+    lens   = MechaImageGetLens(&MechaImage);
+    op     = MechaImageGetOP(&MechaImage);
+    cexdex = MechaImageGetCEXDEX(&MechaImage);
+    ExtractFormatBytes(ModelName, sizeof(ModelName), words, IsNew ? EEPROM_MAP_MODEL_NAME_NEW_0 : EEPROM_MAP_MODEL_NAME_0, 8, 1);
+
+    snprintf(image->row, sizeof(image->row), "%s,%s,%s,%s,%s,%s,%04x\n",
+             IsNew ? "new" : "old", chassis,
+             lens == MECHA_LENS_T609K ? "T609K" : (lens == MECHA_LENS_T487 ? "T487" : ""),
+             op == MECHA_OP_SANYO ? "SANYO" : (op == MECHA_OP_SONY ? "SONY" : ""),
+             cexdex == 1 ? "CEX" : (cexdex == 0 ? "DEX" : ""),
+             ModelName, words[IsNew ? EEPROM_MAP_MODEL_ID_NEW : EEPROM_MAP_MODEL_ID]);
+}
+
+static const struct ExtractFormat ExtractFields = {
+    "file,layout,con,cex,op,opt_12,opt_13,ecr,fok,model_name,model_id,"
+    "ilink_id,console_id,serial,emcs,eegs,osd2,osd2_init\n",
+    &ExtractFormatFields, "extracted"};
+static const struct ExtractFormat ExtractClass = {
+    "file,layout,chassis,lens,op,cex,model_name,model_id\n",
+    &ExtractFormatClass, "classified"};
+
+static void ExtractDecode(struct ExtractImage *image, const struct ExtractFormat *format)
+{
+    FILE *file;
+    unsigned char data[EXTRACT_IMAGE_SIZE + 1];
+    u16 words[EXTRACT_IMAGE_SIZE / 2];
+    int i, IsNew;
+    size_t len;
+
+    if ((file = fopen(image->file, "rb")) == NULL)
+        return;
+    if (image->offset != 0 && fseek(file, image->offset, SEEK_SET) != 0)
+    {
+        fclose(file);
+        return;
+    }
+    // Files must be exactly EXTRACT_IMAGE_SIZE bytes. Tar members were already checked.
+    len = fread(data, 1, image->member[0] != '\0' ? EXTRACT_IMAGE_SIZE : sizeof(data), file);
+    fclose(file);
+    if (len != EXTRACT_IMAGE_SIZE)
+        return;
+
+    for (i = 0; i < EXTRACT_IMAGE_SIZE / 2; i++)
+        words[i] = data[i * 2] | (data[i * 2 + 1] << 8);
+
+    IsNew = !ExtractIsModelName(words, EEPROM_MAP_MODEL_NAME_0) && (ExtractIsModelName(words, EEPROM_MAP_MODEL_NAME_NEW_0) || ExtractIsDragon(words));
+    format->format(image, words, IsNew);
+    image->status = 0;
+}
+
+static void ExtractThread(int thread, int count, void *arg)
+{
+    unsigned int i;
+
+    for (i = thread; i < ImageCount; i += count)
+        ExtractDecode(&images[i], (const struct ExtractFormat *)arg);
+}
+
+static void ExtractWriteName(FILE *file, const struct ExtractImage *image)
+{
+    const char *p;
+
+    fputc('"', file);
+    for (p = image->file; *p != '\0'; p++)
+    {
+        if (*p == '"')
+            fputc('"', file);
+        fputc(*p, file);
+    }
+    if (image->member[0] != '\0')
+    {
+        fputc(':', file);
+        for (p = image->member; *p != '\0'; p++)
+        {
+            if (*p == '"')
+                fputc('"', file);
+            fputc(*p, file);
+        }
+    }
+    fputs("\",", file);
+}
+
+static int ExtractRun(const char *source, const char *output, const struct ExtractFormat *format)
+{
+    FILE *file;
+    unsigned int i, extracted;
+    int result, threads;
+    u64 start;
+
+    start      = PlatGetTime();
+    images     = NULL;
+    ImageCount = ImageMax = 0;
+    if ((result = PlatListFiles(source, &ExtractAddFile, NULL)) != 0)
+    {
+        PlatShowMessage("Cannot read %s.\n", source);
+        free(images);
+        return result;
+    }
+
+    if ((file = fopen(output, "w")) == NULL)
+    {
+        PlatShowMessage("Cannot create %s.\n", output);
+        free(images);
+        return -EIO;
+    }
+
+    qsort(images, ImageCount, sizeof(struct ExtractImage), &ExtractCompareImages);
+    threads = PlatRunThreads(0, &ExtractThread, (void *)format);
+
+    fputs(format->columns, file);
+    for (i = 0, extracted = 0; i < ImageCount; i++)
+    {
+        if (images[i].status != 0)
+            continue;
+        ExtractWriteName(file, &images[i]);
+        fputs(images[i].row, file);
+        extracted++;
+    }
+    result = ferror(file) ? -EIO : 0;
+    fclose(file);
+
+    PlatShowMessage("%u dumps %s to %s (%u other files skipped), with %d threads in %.2fs.\n",
+                    extracted, format->done, output, ImageCount - extracted, threads, (PlatGetTime() - start) / 1e9);
+    free(images);
+    images = NULL;
+
+    return result;
+}
+
+int ExtractDumps(const char *source, const char *output)
+{
+    return ExtractRun(source, output, &ExtractFields);
+}
+
+int ExtractClassify(const char *source, const char *output)
+{
+    return ExtractRun(source, output, &ExtractClass);
+}
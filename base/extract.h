@@ -0,0 +1,12 @@
+/*  Field extraction from EEPROM dumps: decodes the known fields of every dump in a directory (recursively)
+    or tar archive into a CSV file, with one row per dump and one column per field.
+    The layout of each dump (before or after the Dragon models) is detected from the location of the model name,
+    or from the chassis ID when there is no model name.
+    ExtractClassify() writes an index of the chassis, lens, OP and CEX/DEX type of every dump instead, as identified
+    by the MECHACON module from the EEPROM of a connected console. */
+#define EXTRACT_IMAGE_SIZE 1024 // 512 words, as written by the EEPROM dump function.
+#define EXTRACT_NAME_MAX   512
+#define EXTRACT_ROW_MAX    384
+
+int ExtractDumps(const char *source, const char *output);
+int ExtractClassify(const char *source, const char *output);
@@ -0,0 +1,499 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "platform.h"
+#include "log.h"
+#include "mecha.h"
+#include "fault.h"
+
+#define FAULT_MAX_SCRIPT 256
+#define FAULT_QUEUE_SIZE 256
+#define FAULT_NONE       -1
+
+struct FaultScriptEntry
+{
+    unsigned int command;
+    unsigned char class;
+    unsigned short int duration;
+};
+
+struct FaultStats
+{
+    unsigned int injected, unrecovered, commands;
+    u64 time;
+};
+
+static const char *FaultClassNames[FAULT_CLASS_COUNT] = {"drop", "dup", "flip", "partial", "stall", "reset"};
+
+static const MechaTransport_t *inner = NULL;
+static MechaTransport_t FaultTransport;
+static struct FaultStats stats[FAULT_CLASS_COUNT];
+
+// Schedule
+static struct FaultScriptEntry script[FAULT_MAX_SCRIPT];
+static unsigned short int ScriptCount, ScriptPos;
+static unsigned int FaultChance; // Per command, in millionths. 0 = scripted.
+static unsigned char FaultClassMask;
+static u32 FaultSeed;
+
+// Receive stream
+static char LineBuffer[FAULT_QUEUE_SIZE], queue[FAULT_QUEUE_SIZE];
+static unsigned short int LineLen, QueueLen, QueuePos;
+static u64 HoldUntil, SilentUntil;
+static int armed; // Fault to apply to the next response.
+static unsigned short int ArmedDuration;
+static unsigned int pending; // Commands sent to the console, which have not been answered yet.
+
+// Current command
+static unsigned int CommandCount, CleanCommand;
+static unsigned char forwarded;
+static char clean[MECHA_RX_BUFFER_SIZE + 2], delivered[MECHA_RX_BUFFER_SIZE + 2];
+static unsigned char CleanLen, DeliveredLen;
+static u64 CommandEnd, PreviousEnd;
+
+// Fault that the engine has not recovered from yet.
+static int OpenClass;
+static unsigned int OpenCommand;
+static u64 OpenStart;
+
+static u32 FaultRandom(void)
+{
+    FaultSeed ^= FaultSeed << 13;
+    FaultSeed ^= FaultSeed >> 17;
+    FaultSeed ^= FaultSeed << 5;
+    return FaultSeed;
+}
+
+static int FaultParseClass(const char *name, int len)
+{
+    int i;
+
+    for (i = 0; i < FAULT_CLASS_COUNT; i++)
+    {
+        if ((int)strlen(FaultClassNames[i]) == len && !strncmp(FaultClassNames[i], name, len))
+            return i;
+    }
+
+    return FAULT_NONE;
+}
+
+static void FaultSleep(u64 ns)
+{
+    unsigned int ms;
+
+    for (ms = (unsigned int)(ns / 1000000); ms > 0; ms -= (ms > 60000 ? 60000 : ms))
+        PlatSleep((unsigned short int)(ms > 60000 ? 60000 : ms));
+}
+
+static void FaultPush(const char *data, unsigned short int len)
+{
+    if (QueuePos > 0)
+    { // Discard what has been received already.
+        memmove(queue, &queue[QueuePos], QueueLen - QueuePos);
+        QueueLen -= QueuePos;
+        QueuePos = 0;
+    }
+
+    if (len > sizeof(queue) - QueueLen)
+        len = sizeof(queue) - QueueLen;
+    memcpy(&queue[QueueLen], data, len);
+    QueueLen += len;
+}
+
+// Called with every complete line that the console sent.
+static void FaultLine(void)
+{
+    unsigned short int i;
+
+    CleanLen = LineLen < sizeof(clean) ? LineLen : sizeof(clean) - 1;
+    memcpy(clean, LineBuffer, CleanLen);
+    CleanCommand = CommandCount;
+    if (pending > 0)
+        pending--;
+
+    switch (armed)
+    {
+        case FAULT_CLASS_DROP:
+            i = FaultRandom() % LineLen;
+            memmove(&LineBuffer[i], &LineBuffer[i + 1], LineLen - i - 1);
+            LineLen--;
+            break;
+        case FAULT_CLASS_DUP:
+            FaultPush(LineBuffer, LineLen);
+            break;
+        case FAULT_CLASS_FLIP:
+            LineBuffer[FaultRandom() % LineLen] ^= 1 << (FaultRandom() % 8);
+            break;
+        case FAULT_CLASS_PARTIAL:
+            LineLen = 1 + FaultRandom() % (LineLen - 1);
+            break;
+        case FAULT_CLASS_STALL:
+            HoldUntil = PlatGetTime() + ArmedDuration * 1000000ULL;
+            break;
+    }
+    if (armed != FAULT_NONE)
+        LogPrintf(LOG_ENGINE, LOG_INFO, "FAULT: %s at command %u\n", FaultClassNames[armed], CommandCount);
+    armed = FAULT_NONE;
+
+    FaultPush(LineBuffer, LineLen);
+    LineLen = 0;
+}
+
+// Decides whether the engine is back in sync with the console, at the end of every command.
+static void FaultEndCommand(void)
+{
+    unsigned char synced;
+    struct FaultStats *stat;
+
+    if (CommandCount == 0 || OpenClass == FAULT_NONE)
+    {
+        PreviousEnd = CommandEnd;
+        return;
+    }
+
+    synced = forwarded && armed == FAULT_NONE && pending == 0 && LineLen == 0 && QueuePos >= QueueLen && CleanCommand == CommandCount && CleanLen == DeliveredLen && !memcmp(clean, delivered, CleanLen);
+
+    if (synced)
+    {
+        stat = &stats[OpenClass];
+        if (CommandCount == OpenCommand)
+        { // The faulted command itself completed normally (i.e. a short stall).
+            stat->commands++;
+            stat->time += CommandEnd - OpenStart;
+        }
+        else
+        {
+            stat->commands += CommandCount - OpenCommand;
+            stat->time += PreviousEnd - OpenStart;
+        }
+        OpenClass = FAULT_NONE;
+    }
+
+    PreviousEnd = CommandEnd;
+}
+
+static int FaultSchedule(unsigned short int *duration)
+{
+    unsigned char classes[FAULT_CLASS_COUNT];
+    int i, count;
+
+    *duration = 0;
+
+    if (FaultChance > 0)
+    {
+        if (FaultRandom() % 1000000 >= FaultChance)
+            return FAULT_NONE;
+
+        for (i = 0, count = 0; i < FAULT_CLASS_COUNT; i++)
+        {
+            if (FaultClassMask & (1 << i))
+                classes[count++] = i;
+        }
+
+        return classes[FaultRandom() % count];
+    }
+
+    if (ScriptPos < ScriptCount && script[ScriptPos].command <= CommandCount)
+    {
+        *duration = script[ScriptPos].duration;
+        return script[ScriptPos++].class;
+    }
+
+    return FAULT_NONE;
+}
+
+static int FaultWrite(const char *data)
+{
+    unsigned short int duration;
+    int class, result;
+    u64 now;
+
+    FaultEndCommand();
+
+    now          = PlatGetTime();
+    CommandEnd   = now;
+    DeliveredLen = 0;
+    forwarded    = 0;
+    CommandCount++;
+
+    class = (OpenClass == FAULT_NONE) ? FaultSchedule(&duration) : FAULT_NONE;
+    if (class != FAULT_NONE)
+    {
+        stats[class].injected++;
+        OpenClass   = class;
+        OpenCommand = CommandCount;
+        OpenStart   = now;
+
+        if (duration == 0)
+            duration = (class == FAULT_CLASS_RESET) ? FAULT_RESET_MS : FAULT_STALL_MS;
+
+        if (class == FAULT_CLASS_RESET)
+        { // Whatever the console had to send is lost too.
+            LogPrintf(LOG_ENGINE, LOG_INFO, "FAULT: reset at command %u\n", CommandCount);
+            SilentUntil = now + duration * 1000000ULL;
+            LineLen = QueueLen = QueuePos = 0;
+            pending = 0;
+            armed   = FAULT_NONE;
+            return (int)strlen(data);
+        }
+
+        armed         = class;
+        ArmedDuration = duration;
+    }
+
+    if (SilentUntil > now) // The console is still restarting.
+        return (int)strlen(data);
+
+    if ((result = inner->write(data)) == (int)strlen(data))
+    {
+        forwarded = 1;
+        pending++;
+    }
+
+    return result;
+}
+
+static int FaultRead(char *data, int n, unsigned short timeout)
+{
+    int result, len;
+    char c;
+    u64 now;
+
+    now = PlatGetTime();
+    if (SilentUntil > now)
+    {
+        if (SilentUntil - now >= timeout * 1000000ULL)
+        {
+            FaultSleep(timeout * 1000000ULL);
+            CommandEnd = PlatGetTime();
+            return 0;
+        }
+        FaultSleep(SilentUntil - now);
+    }
+
+    while (QueuePos >= QueueLen)
+    {
+        if ((result = inner->read(&c, 1, timeout)) <= 0)
+        {
+            CommandEnd = PlatGetTime();
+            return result;
+        }
+
+        if (LineLen < sizeof(LineBuffer))
+            LineBuffer[LineLen++] = c;
+        if ((LineLen >= 2 && LineBuffer[LineLen - 2] == '\r' && LineBuffer[LineLen - 1] == '\n') || LineLen >= sizeof(LineBuffer))
+            FaultLine();
+    }
+
+    now = PlatGetTime();
+    if (HoldUntil > now)
+    {
+        if (HoldUntil - now > timeout * 1000000ULL)
+        { // The response will arrive after the timeout.
+            FaultSleep(timeout * 1000000ULL);
+            CommandEnd = PlatGetTime();
+            return 0;
+        }
+        FaultSleep(HoldUntil - now);
+    }
+
+    len = QueueLen - QueuePos < n ? QueueLen - QueuePos : n;
+    memcpy(data, &queue[QueuePos], len);
+    QueuePos += len;
+
+    if (DeliveredLen + len < (int)sizeof(delivered))
+    {
+        memcpy(&delivered[DeliveredLen], data, len);
+        DeliveredLen += len;
+    }
+    CommandEnd = PlatGetTime();
+
+    return len;
+}
+
+static void FaultPrompt(const char *label)
+{
+    if (inner->prompt != NULL)
+        inner->prompt(label);
+}
+
+static int FaultLoadScript(const char *filename)
+{
+    char line[128], name[16];
+    unsigned int command, duration;
+    int class, i;
+    FILE *file;
+
+    if ((file = fopen(filename, "r")) == NULL)
+    {
+        PlatShowMessage("Cannot open %s.\n", filename);
+        return -ENOENT;
+    }
+
+    ScriptCount = 0;
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        if (line[0] == '#')
+            continue;
+
+        duration = 0;
+        if (sscanf(line, "%u %15s %u", &command, name, &duration) < 2)
+            continue;
+
+        if ((class = FaultParseClass(name, (int)strlen(name))) == FAULT_NONE)
+        {
+            PlatShowMessage("%s: unknown fault class: %s\n", filename, name);
+            fclose(file);
+            return -EINVAL;
+        }
+
+        if (ScriptCount >= FAULT_MAX_SCRIPT)
+        {
+            PlatShowMessage("%s: too many faults (maximum %u).\n", filename, FAULT_MAX_SCRIPT);
+            fclose(file);
+            return -EINVAL;
+        }
+
+        // Keep the script sorted by command number.
+        for (i = ScriptCount; i > 0 && script[i - 1].command > command; i--)
+            script[i] = script[i - 1];
+        script[i].command  = command;
+        script[i].class    = (unsigned char)class;
+        script[i].duration = (unsigned short int)(duration > 60000 ? 60000 : duration);
+        ScriptCount++;
+    }
+
+    fclose(file);
+
+    return 0;
+}
+
+static int FaultParseRandom(const char *spec)
+{
+    const char *p, *end;
+    int class;
+
+    FaultChance    = (unsigned int)(atof(spec) * 10000.0);
+    FaultSeed      = 1;
+    FaultClassMask = (1 << FAULT_CLASS_COUNT) - 1;
+
+    if ((p = strchr(spec, ':')) != NULL)
+    {
+        FaultSeed = (u32)strtoul(p + 1, NULL, 0);
+        if ((p = strchr(p + 1, ':')) != NULL)
+        {
+            FaultClassMask = 0;
+            for (p++; *p != '\0'; p = (*end == ',') ? end + 1 : end)
+            {
+                if ((end = strchr(p, ',')) == NULL)
+                    end = p + strlen(p);
+
+                if ((class = FaultParseClass(p, (int)(end - p))) == FAULT_NONE)
+                {
+                    PlatShowMessage("Unknown fault class: %.*s\n", (int)(end - p), p);
+                    return -EINVAL;
+                }
+                FaultClassMask |= 1 << class;
+            }
+        }
+    }
+
+    if (FaultChance == 0 || FaultChance > 1000000 || FaultClassMask == 0)
+    {
+        PlatShowMessage("Invalid fault schedule: random:%s\n", spec);
+        return -EINVAL;
+    }
+    if (FaultSeed == 0)
+        FaultSeed = 1;
+
+    return 0;
+}
+
+int FaultOpen(const char *schedule)
+{
+    int result, i;
+
+    FaultChance = 0;
+    ScriptCount = 0;
+    ScriptPos   = 0;
+
+    if (!strncmp(schedule, "random:", 7))
+        result = FaultParseRandom(&schedule[7]);
+    else
+        result = FaultLoadScript(schedule);
+    if (result != 0)
+        return result;
+
+    memset(stats, 0, sizeof(stats));
+    LineLen = QueueLen = QueuePos = 0;
+    HoldUntil = SilentUntil = 0;
+    armed        = FAULT_NONE;
+    pending      = 0;
+    CommandCount = 0;
+    CleanCommand = 0;
+    OpenClass    = FAULT_NONE;
+
+    inner                 = MechaGetTransport();
+    FaultTransport.read     = &FaultRead;
+    FaultTransport.write    = &FaultWrite;
+    FaultTransport.prompt   = &FaultPrompt;
+    FaultTransport.times    = NULL; // Injected delays are not seen by the port.
+    FaultTransport.pipeline = 0; // Faults are armed per command.
+    MechaSetTransport(&FaultTransport);
+
+    if (FaultChance > 0)
+    {
+        PlatShowMessage("Injecting faults into %.4g%% of commands:", FaultChance / 10000.0);
+        for (i = 0; i < FAULT_CLASS_COUNT; i++)
+        {
+            if (FaultClassMask & (1 << i))
+                PlatShowMessage(" %s", FaultClassNames[i]);
+        }
+        PlatShowMessage("\n");
+    }
+    else
+        PlatShowMessage("Injecting %u scripted faults.\n", ScriptCount);
+
+    return 0;
+}
+
+void FaultClose(void)
+{
+    if (inner != NULL)
+    {
+        MechaSetTransport(inner);
+        inner = NULL;
+    }
+}
+
+void FaultReport(void)
+{
+    struct FaultStats *stat;
+    int i;
+
+    if (inner == NULL)
+        return;
+
+    FaultEndCommand();
+    if (OpenClass != FAULT_NONE)
+    { // Never recovered: everything since the fault was lost.
+        stat = &stats[OpenClass];
+        stat->unrecovered++;
+        stat->commands += CommandCount - OpenCommand + 1;
+        stat->time += CommandEnd - OpenStart;
+        OpenClass = FAULT_NONE;
+    }
+
+    PlatShowMessage("\nFault injection (%u commands):\n"
+                    "    Class  Injected  Unrecovered  Commands     Total      Mean\n",
+                    CommandCount);
+    for (i = 0, stat = stats; i < FAULT_CLASS_COUNT; i++, stat++)
+    {
+        if (stat->injected == 0)
+            continue;
+
+        PlatShowMessage("%9s %9u %12u %9u %8.2fs %8.2fs\n", FaultClassNames[i], stat->injected, stat->unrecovered, stat->commands, stat->time / 1e9, stat->time / 1e9 / stat->injected);
+    }
+}
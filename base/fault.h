@@ -0,0 +1,22 @@
+/*  Fault injection: a stage between the command engine and the transport (COM port or simulator),
+    which corrupts the receive stream according to a fault schedule.
+        random:<percent>[:<seed>[:<class>,<class>...]]
+            Each command has the given chance of a fault, of a class chosen at random.
+        <file>
+            A script with one fault per line: "<command number> <class> [<duration in ms>]".
+    Faults are not injected until the engine has recovered from the previous fault:
+    a scripted fault is deferred until then. */
+#define FAULT_CLASS_DROP    0 // One byte of the response is lost.
+#define FAULT_CLASS_DUP     1 // The response is received twice.
+#define FAULT_CLASS_FLIP    2 // One bit of the response is inverted.
+#define FAULT_CLASS_PARTIAL 3 // Only the start of the response is received.
+#define FAULT_CLASS_STALL   4 // The response is delayed.
+#define FAULT_CLASS_RESET   5 // The console restarts: the command is lost and the console does not respond for a while.
+#define FAULT_CLASS_COUNT   6
+
+#define FAULT_STALL_MS      2000
+#define FAULT_RESET_MS      3000
+
+int FaultOpen(const char *schedule);
+void FaultClose(void);
+void FaultReport(void);
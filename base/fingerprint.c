@@ -0,0 +1,395 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "platform.h"
+#include "mecha.h"
+#include "eeprom.h"
+#include "fingerprint.h"
+
+#define FINGERPRINT_NO_WORD 0xFFFF
+
+struct FingerprintRange
+{
+    u16 first, last;
+};
+
+struct FingerprintRegion
+{
+    const char *name;
+    struct FingerprintRange ranges[2], RangesNew[2]; // For the old and new (Dragon) layouts.
+};
+
+/*  The regions that are not in the EEPROM map are the blocks of the words that the UpdateData tables in updates.c
+    write with the same UPDATE_REGION_* type: DISCDET 0x006, SERVO 0x00e-0x07e (without the ECR word), TILT 0x0c0-0x0c4
+    and TRAY 0x0f1-0x0fb. Keep them in step with the tables.
+    The DEX updates of the old layout also write words 0x140 and 0x147 as EEGS, so its EEGS includes the 8 words before EEPROM_MAP_EEGS_0. */
+#define FINGERPRINT_DISCDET_FIRST 0x000
+#define FINGERPRINT_DISCDET_LAST  0x00d
+#define FINGERPRINT_SERVO_FIRST   0x00e
+#define FINGERPRINT_SERVO_LAST    0x0bf
+#define FINGERPRINT_TILT_FIRST    0x0c0
+#define FINGERPRINT_TILT_LAST     0x0cf
+#define FINGERPRINT_TRAY_FIRST    0x0f1
+#define FINGERPRINT_TRAY_LAST     0x0fb
+
+static const struct FingerprintRegion FingerprintRegions[] = {
+    {"DISCDET", {{FINGERPRINT_DISCDET_FIRST, FINGERPRINT_DISCDET_LAST}, {FINGERPRINT_NO_WORD, 0}}, {{FINGERPRINT_DISCDET_FIRST, FINGERPRINT_DISCDET_LAST}, {FINGERPRINT_NO_WORD, 0}}},
+    {"SERVO", {{FINGERPRINT_SERVO_FIRST, EEPROM_MAP_ECR - 1}, {EEPROM_MAP_ECR + 1, FINGERPRINT_SERVO_LAST}}, {{FINGERPRINT_SERVO_FIRST, EEPROM_MAP_ECR - 1}, {EEPROM_MAP_ECR + 1, FINGERPRINT_SERVO_LAST}}},
+    {"ECR", {{EEPROM_MAP_ECR, EEPROM_MAP_ECR}, {FINGERPRINT_NO_WORD, 0}}, {{EEPROM_MAP_ECR, EEPROM_MAP_ECR}, {FINGERPRINT_NO_WORD, 0}}},
+    {"TILT", {{FINGERPRINT_TILT_FIRST, FINGERPRINT_TILT_LAST}, {FINGERPRINT_NO_WORD, 0}}, {{FINGERPRINT_TILT_FIRST, FINGERPRINT_TILT_LAST}, {FINGERPRINT_NO_WORD, 0}}},
+    {"MODEL", {{EEPROM_MAP_MODEL_NAME_0, EEPROM_MAP_MODEL_NAME_7}, {FINGERPRINT_NO_WORD, 0}}, {{EEPROM_MAP_MODEL_NAME_NEW_0, EEPROM_MAP_MODEL_NAME_NEW_7}, {FINGERPRINT_NO_WORD, 0}}},
+    {"ILINK", {{EEPROM_MAP_ILINK_ID_0, EEPROM_MAP_ILINK_ID_3}, {FINGERPRINT_NO_WORD, 0}}, {{EEPROM_MAP_ILINK_ID_NEW_0, EEPROM_MAP_ILINK_ID_NEW_3}, {FINGERPRINT_NO_WORD, 0}}},
+    {"CONID", {{EEPROM_MAP_CON_ID_0, EEPROM_MAP_CON_ID_3}, {FINGERPRINT_NO_WORD, 0}}, {{EEPROM_MAP_CON_ID_NEW_0, EEPROM_MAP_CON_ID_NEW_3}, {FINGERPRINT_NO_WORD, 0}}},
+    {"TRAY", {{FINGERPRINT_TRAY_FIRST, FINGERPRINT_TRAY_LAST}, {FINGERPRINT_NO_WORD, 0}}, {{FINGERPRINT_NO_WORD, 0}, {FINGERPRINT_NO_WORD, 0}}},
+    {"EEGS", {{EEPROM_MAP_EEGS_NEW_0, EEPROM_MAP_EEGS_NEW_7}, {EEPROM_MAP_EEGS_0, EEPROM_MAP_EEGS_7}}, {{EEPROM_MAP_EEGS_NEW_0, EEPROM_MAP_EEGS_NEW_7}, {FINGERPRINT_NO_WORD, 0}}},
+    {"OSD2", {{EEPROM_MAP_OSD2_0, EEPROM_MAP_OSD2_7}, {FINGERPRINT_NO_WORD, 0}}, {{EEPROM_MAP_OSD2_NEW_0, EEPROM_MAP_OSD2_NEW_7}, {FINGERPRINT_NO_WORD, 0}}},
+    {NULL, {{0, 0}, {0, 0}}, {{0, 0}, {0, 0}}}};
+
+#define FINGERPRINT_REGIONS (sizeof(FingerprintRegions) / sizeof(FingerprintRegions[0]) - 1)
+#define FINGERPRINT_ILINK   5 // Indexes within FingerprintRegions[].
+#define FINGERPRINT_CONID   6
+
+struct FingerprintRecord
+{
+    char iLinkID[17], ConsoleID[17];
+    long long int seen;
+    u32 hashes[FINGERPRINT_REGIONS];
+    u32 present; // Bit n set = region n has a hash.
+};
+
+static const char *StoreFile = NULL;
+static u16 words[0x200];
+static u32 WordMap[0x200 / 32];
+
+static const struct FingerprintRange *FingerprintGetRanges(const struct FingerprintRegion *region)
+{
+    u8 tm, md;
+
+    MechaGetMode(&tm, &md);
+    return (md == 40 ? region->RangesNew : region->ranges);
+}
+
+// FNV-1a, over the bytes of the words of the region.
+static u32 FingerprintHash(const struct FingerprintRange *ranges)
+{
+    u32 hash;
+    u16 word;
+    int i;
+
+    hash = 0x811C9DC5;
+    for (i = 0; i < 2 && ranges[i].first != FINGERPRINT_NO_WORD; i++)
+    {
+        for (word = ranges[i].first; word <= ranges[i].last; word++)
+        {
+            hash = (hash ^ (words[word] & 0xFF)) * 0x01000193;
+            hash = (hash ^ (words[word] >> 8)) * 0x01000193;
+        }
+    }
+
+    return hash;
+}
+
+static void FingerprintFormatID(char *id, const struct FingerprintRange *range)
+{
+    u16 word;
+
+    for (word = range->first; word <= range->last; word++, id += 4)
+        sprintf(id, "%04x", words[word]);
+}
+
+/*  Words that are already known from the identification of the console are not read again.
+    The others are read in blocks, which the transport may pipeline. */
+static int FingerprintTake(struct FingerprintRecord *record, unsigned int *read)
+{
+    const struct FingerprintRegion *region;
+    const struct FingerprintRange *ranges;
+    unsigned short int word, first, count;
+    int i, n, result;
+
+    if ((result = MechaInitModel()) != 0)
+        return result;
+
+    memset(WordMap, 0, sizeof(WordMap));
+    for (region = FingerprintRegions; region->name != NULL; region++)
+    {
+        ranges = FingerprintGetRanges(region);
+        for (i = 0; i < 2 && ranges[i].first != FINGERPRINT_NO_WORD; i++)
+        {
+            for (word = ranges[i].first; word <= ranges[i].last; word++)
+                WordMap[word / 32] |= (1 << (word % 32));
+        }
+    }
+
+    *read = 0;
+    for (word = 0; word < 0x200; word++)
+    {
+        if (!(WordMap[word / 32] & (1 << (word % 32))) || !EEPMapIsValid(word))
+            continue;
+        words[word] = EEPMapRead(word);
+        WordMap[word / 32] &= ~(1 << (word % 32));
+    }
+    for (word = 0; word < 0x200; word += count)
+    {
+        for (count = 0; word + count < 0x200 && count < MAX_MECHA_TASKS && (WordMap[(word + count) / 32] & (1 << ((word + count) % 32))); count++)
+            ;
+        if (count == 0)
+        {
+            count = 1;
+            continue;
+        }
+        first = word;
+        if ((result = EEPROMReadWords(first, count, &words[first])) != 0)
+            return result;
+        *read += count;
+    }
+
+    memset(record, 0, sizeof(struct FingerprintRecord));
+    for (n = 0, region = FingerprintRegions; region->name != NULL; n++, region++)
+    {
+        ranges = FingerprintGetRanges(region);
+        if (ranges[0].first == FINGERPRINT_NO_WORD)
+            continue;
+        record->hashes[n] = FingerprintHash(ranges);
+        record->present |= 1 << n;
+    }
+    FingerprintFormatID(record->iLinkID, FingerprintGetRanges(&FingerprintRegions[FINGERPRINT_ILINK]));
+    FingerprintFormatID(record->ConsoleID, FingerprintGetRanges(&FingerprintRegions[FINGERPRINT_CONID]));
+    record->seen = (long long int)time(NULL);
+
+    return 0;
+}
+
+// IDs that were erased or never set (all 0s or all Fs) do not identify a console.
+static int FingerprintIsBlankID(const char *id)
+{
+    return (strspn(id, "0") == strlen(id) || strspn(id, "f") == strlen(id));
+}
+
+static int FingerprintIsSameConsole(const struct FingerprintRecord *a, const struct FingerprintRecord *b)
+{
+    return ((!FingerprintIsBlankID(a->iLinkID) && !strcmp(a->iLinkID, b->iLinkID)) ||
+            (!FingerprintIsBlankID(a->ConsoleID) && !strcmp(a->ConsoleID, b->ConsoleID)));
+}
+
+// Line format: <i.Link ID> <console ID> <time> <region>=<hash>...
+static int FingerprintParse(char *line, struct FingerprintRecord *record)
+{
+    const struct FingerprintRegion *region;
+    char *token, *value;
+    int n;
+
+    memset(record, 0, sizeof(struct FingerprintRecord));
+    if (sscanf(line, "%16s %16s %lld", record->iLinkID, record->ConsoleID, &record->seen) != 3)
+        return -EINVAL;
+
+    strtok(line, " \r\n");
+    strtok(NULL, " \r\n");
+    strtok(NULL, " \r\n");
+    while ((token = strtok(NULL, " \r\n")) != NULL)
+    {
+        if ((value = strchr(token, '=')) == NULL)
+            continue;
+        *value++ = '\0';
+        for (n = 0, region = FingerprintRegions; region->name != NULL; n++, region++)
+        {
+            if (!strcmp(token, region->name))
+            {
+                record->hashes[n] = (u32)strtoul(value, NULL, 16);
+                record->present |= 1 << n;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static void FingerprintFormat(char *line, int size, const struct FingerprintRecord *record)
+{
+    const struct FingerprintRegion *region;
+    int n, len;
+
+    len = snprintf(line, size, "%s %s %lld", record->iLinkID, record->ConsoleID, record->seen);
+    for (n = 0, region = FingerprintRegions; region->name != NULL && len < size; n++, region++)
+    {
+        if (record->present & (1 << n))
+            len += snprintf(line + len, size - len, " %s=%08x", region->name, record->hashes[n]);
+    }
+}
+
+static int FingerprintFind(const struct FingerprintRecord *record, struct FingerprintRecord *previous)
+{
+    char line[FINGERPRINT_LINE_MAX];
+    FILE *file;
+    int found;
+
+    if ((file = fopen(StoreFile, "r")) == NULL)
+        return 0;
+
+    for (found = 0; !found && fgets(line, sizeof(line), file) != NULL;)
+        found = (FingerprintParse(line, previous) == 0 && FingerprintIsSameConsole(record, previous));
+    fclose(file);
+
+    return found;
+}
+
+// The records of other consoles are kept; that of this console is replaced.
+static int FingerprintSave(const struct FingerprintRecord *record)
+{
+    char line[FINGERPRINT_LINE_MAX], copy[FINGERPRINT_LINE_MAX], *kept, *p;
+    struct FingerprintRecord other;
+    size_t KeptLen, KeptMax, len;
+    FILE *file;
+    int result;
+
+    kept    = NULL;
+    KeptLen = KeptMax = 0;
+    if ((file = fopen(StoreFile, "r")) != NULL)
+    {
+        while (fgets(line, sizeof(line), file) != NULL)
+        {
+            strcpy(copy, line);
+            if (FingerprintParse(copy, &other) == 0 && FingerprintIsSameConsole(record, &other))
+                continue;
+
+            len = strlen(line);
+            if (KeptLen + len + 1 > KeptMax)
+            {
+                KeptMax = (KeptMax + len + 1) * 2;
+                if ((p = realloc(kept, KeptMax)) == NULL)
+                {
+                    free(kept);
+                    fclose(file);
+                    return -ENOMEM;
+                }
+                kept = p;
+            }
+            memcpy(kept + KeptLen, line, len + 1);
+            KeptLen += len;
+        }
+        fclose(file);
+    }
+
+    if ((file = fopen(StoreFile, "w")) == NULL)
+    {
+        PlatShowMessage("Cannot create %s.\n", StoreFile);
+        free(kept);
+        return -EIO;
+    }
+    if (kept != NULL)
+        fputs(kept, file);
+    FingerprintFormat(line, sizeof(line), record);
+    fprintf(file, "%s\n", line);
+    result = ferror(file) ? -EIO : 0;
+    fclose(file);
+    free(kept);
+
+    return result;
+}
+
+static void FingerprintShowWords(const struct FingerprintRegion *region)
+{
+    const struct FingerprintRange *ranges;
+    u16 word;
+    int i;
+
+    ranges = FingerprintGetRanges(region);
+    PlatShowMessage("%s:", region->name);
+    for (i = 0; i < 2 && ranges[i].first != FINGERPRINT_NO_WORD; i++)
+    {
+        for (word = ranges[i].first; word <= ranges[i].last; word++)
+        {
+            if (word == ranges[i].first || (word - ranges[i].first) % 8 == 0)
+                PlatShowMessage("\n\t%03x:", word);
+            PlatShowMessage(" %04x", words[word]);
+        }
+    }
+    PlatShowMessage("\n");
+}
+
+static void FingerprintReport(const struct FingerprintRecord *record, const struct FingerprintRecord *previous)
+{
+    const struct FingerprintRegion *region;
+    char seen[32];
+    time_t when;
+    u32 changed;
+    int n;
+
+    when = (time_t)previous->seen;
+    strftime(seen, sizeof(seen), "%Y-%m-%d %H:%M", localtime(&when));
+
+    for (n = 0, changed = 0, region = FingerprintRegions; region->name != NULL; n++, region++)
+    {
+        if ((record->present & (1 << n)) &&
+            (!(previous->present & (1 << n)) || previous->hashes[n] != record->hashes[n]))
+            changed |= 1 << n;
+    }
+
+    if (changed == 0)
+    {
+        PlatShowMessage("Fingerprints: unchanged since %s.\n", seen);
+        return;
+    }
+
+    PlatShowMessage("Fingerprints: changed since %s:", seen);
+    for (n = 0, region = FingerprintRegions; region->name != NULL; n++, region++)
+    {
+        if (changed & (1 << n))
+            PlatShowMessage(" %s", region->name);
+    }
+    PlatShowMessage("\n");
+    for (n = 0, region = FingerprintRegions; region->name != NULL; n++, region++)
+    {
+        if (changed & (1 << n))
+            FingerprintShowWords(region);
+    }
+}
+
+int FingerprintOpen(const char *file)
+{
+    struct FingerprintRecord record, previous;
+    unsigned int read;
+    int result;
+    u64 start;
+
+    StoreFile = file;
+    start     = PlatGetTime();
+    if ((result = FingerprintTake(&record, &read)) != 0)
+    {
+        PlatShowMessage("Fingerprints: cannot read the EEPROM (%d).\n", result);
+        return result;
+    }
+    PlatShowMessage("Fingerprints: %u EEPROM words read in %.2fs.\n", read, (PlatGetTime() - start) / 1e9);
+
+    if (FingerprintIsBlankID(record.iLinkID) && FingerprintIsBlankID(record.ConsoleID))
+    {
+        PlatShowMessage("Fingerprints: the console has no i.Link ID or console ID, so its fingerprints are not kept.\n");
+        StoreFile = NULL;
+        return 0;
+    }
+
+    if (FingerprintFind(&record, &previous))
+        FingerprintReport(&record, &previous);
+    else
+        PlatShowMessage("Fingerprints: first visit of this console (i.Link ID %s, console ID %s).\n", record.iLinkID, record.ConsoleID);
+
+    return FingerprintSave(&record);
+}
+
+// Records the state that the console is left in.
+void FingerprintClose(void)
+{
+    struct FingerprintRecord record;
+    unsigned int read;
+
+    if (StoreFile == NULL)
+        return;
+
+    if (FingerprintTake(&record, &read) == 0 && FingerprintSave(&record) == 0)
+        PlatShowMessage("Fingerprints saved to %s.\n", StoreFile);
+    else
+        PlatShowMessage("Fingerprints: the state at the end of this visit could not be saved.\n");
+    StoreFile = NULL;
+}
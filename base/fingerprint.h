@@ -0,0 +1,11 @@
+/*  EEPROM fingerprints: a hash of each region of the EEPROM, kept per console in a file between visits.
+    Selected with "--fingerprints=<file>". When the console is connected, its regions are hashed and compared with
+    those of its previous visit, which is found by its i.Link ID or console ID. Only the words that are not already
+    known from the identification of the console are read. The words of the changed regions are then shown.
+    The fingerprints are saved when the console is connected, and again when PMAP quits.
+    Regions: DISCDET, SERVO, ECR, TILT, MODEL (model name), ILINK (i.Link ID), CONID (console ID),
+    TRAY (not on the Dragon), EEGS and OSD2, at their locations for the MD version of the console. */
+#define FINGERPRINT_LINE_MAX 512
+
+int FingerprintOpen(const char *file);
+void FingerprintClose(void);
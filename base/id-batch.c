@@ -0,0 +1,410 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "platform.h"
+#include "main.h"
+#include "mecha.h"
+#include "eeprom.h"
+#include "eeprom-id.h"
+#include "id-batch.h"
+
+extern unsigned char ConType;
+
+struct BatchBoard
+{
+    char port[64];
+    MechaTransport_t link;
+    unsigned char opened, IsDex, waiting;
+    int model, index, result;
+    const char *step; // The step that failed.
+    char cfd[11];
+    u32 cfc;
+    u8 iLinkID[8], ConsoleID[8];
+    char shimuke[MECHA_SHIMUKE_SIZE];
+};
+
+static const struct BatchStep
+{
+    unsigned short int command;
+    const char *label;
+} BatchSteps[] = {
+    {MECHA_CMD_INIT_MECHACON, "INIT DEX"},
+    {MECHA_CMD_INIT_SHIMUKE, "INIT SHIMUKE"},
+    {MECHA_CMD_CLEAR_CONF, "INIT ALL DEFAULT"},
+    {MECHA_CMD_SETUP_OSD, "INIT NTSC/PAL"},
+};
+
+static const char BatchColumns[] = "port,type,model,cfd,cfc,ilink_id,console_id,shimuke,result\n";
+
+static struct BatchBoard boards[BATCH_BOARDS_MAX];
+static int BoardCount;
+
+static void BatchFail(struct BatchBoard *board, int result, const char *step)
+{
+    board->result = (result != 0 ? result : -EIO);
+    board->step   = step;
+    PlatShowMessage("%s: %s failed (%d).\n", board->port, step, board->result);
+}
+
+static int BatchLoadManifest(const char *manifest)
+{
+    char line[128], port[64], type[8];
+    struct BatchBoard *board;
+    FILE *file;
+    int LineNo, model, result;
+
+    if ((file = fopen(manifest, "r")) == NULL)
+    {
+        PlatShowMessage("Cannot open %s.\n", manifest);
+        return -ENOENT;
+    }
+
+    result     = 0;
+    BoardCount = 0;
+    for (LineNo = 1; result == 0 && fgets(line, sizeof(line), file) != NULL; LineNo++)
+    {
+        if (sscanf(line, "%63s", port) != 1 || port[0] == '#')
+            continue;
+
+        if (sscanf(line, "%63s %7s %d", port, type, &model) != 3 || (strcmp(type, "cex") != 0 && strcmp(type, "dex") != 0))
+        {
+            PlatShowMessage("%s:%d: expected <port> <cex|dex> <model>\n", manifest, LineNo);
+            result = -EINVAL;
+        }
+        else if (BoardCount >= BATCH_BOARDS_MAX)
+        {
+            PlatShowMessage("%s:%d: no more than %d boards may be initialized at once.\n", manifest, LineNo, BATCH_BOARDS_MAX);
+            result = -E2BIG;
+        }
+        else
+        {
+            board = &boards[BoardCount];
+            memset(board, 0, sizeof(struct BatchBoard));
+            strcpy(board->port, port);
+            board->IsDex = (type[0] == 'd');
+            board->model = model;
+            if ((board->index = MechaFindInitModel(model, board->IsDex)) < 0)
+            {
+                PlatShowMessage("%s:%d: unknown %s model %d.\n", manifest, LineNo, type, model);
+                result = -EINVAL;
+            }
+            else
+                BoardCount++;
+        }
+    }
+    fclose(file);
+
+    if (result == 0 && BoardCount == 0)
+    {
+        PlatShowMessage("%s lists no boards.\n", manifest);
+        result = -EINVAL;
+    }
+
+    return result;
+}
+
+static void BatchClose(void)
+{
+    struct BatchBoard *board;
+    int i;
+
+    for (i = 0, board = boards; i < BoardCount; i++, board++)
+    {
+        if (!board->opened)
+            continue;
+
+        if (GetConsolePortType(board->port) == CONSOLE_PORT_COM)
+        {
+            PlatSelectCOMPort(board->link.port);
+            PlatCloseCOMPort();
+            PlatSelectCOMPort(0);
+        }
+        else
+            CloseConsole(board->port);
+        board->opened = 0;
+    }
+    MechaSetTransport(NULL);
+}
+
+// Each board on a COM port gets its own port slot. There may be one simulated board and one on a serial server.
+static int BatchOpen(void)
+{
+    struct BatchBoard *board;
+    int i, type, slot, others, result;
+
+    for (i = 0, board = boards, slot = 0, others = 0, result = 0; result == 0 && i < BoardCount; i++, board++)
+    {
+        if ((type = GetConsolePortType(board->port)) == CONSOLE_PORT_COM)
+        {
+            PlatSelectCOMPort(slot);
+            result = PlatOpenCOMPort(board->port);
+            PlatSelectCOMPort(0);
+
+            board->link.read     = &PlatReadCOMPort;
+            board->link.write    = &PlatWriteCOMPort;
+            board->link.prompt   = NULL;
+            board->link.times    = &PlatGetCOMPortTimes;
+            board->link.pipeline = 0;
+            board->link.port     = (unsigned char)slot++;
+        }
+        else if (others & (1 << type))
+        {
+            PlatShowMessage("Only one board may be simulated, and only one may be on a serial server.\n");
+            result = -EINVAL;
+            break;
+        }
+        else
+        {
+            others |= 1 << type;
+            if ((result = OpenConsole(board->port)) == 0)
+                board->link = *MechaGetTransport();
+            MechaSetTransport(NULL);
+        }
+
+        if (result != 0)
+            PlatShowMessage("Cannot open %s.\n", board->port);
+        else
+            board->opened = 1;
+    }
+
+    if (result != 0)
+        BatchClose();
+
+    return result;
+}
+
+static int BatchIdentify(struct BatchBoard *board)
+{
+    const struct MechaIdentRaw *raw;
+    int i;
+
+    MechaSetTransport(&board->link);
+    if (MechaInitModel() != 0)
+    {
+        PlatShowMessage("%s: cannot identify the board.\n", board->port);
+        return -EIO;
+    }
+
+    raw = MechaGetRawIdent();
+    strcpy(board->cfd, raw->cfd);
+    board->cfc = raw->cfc;
+    if (ConType != MECHA_TYPE_40)
+    {
+        PlatShowMessage("%s: %s is not a Dragon MECHACON.\n", board->port, MechaGetDesc());
+        return -EINVAL;
+    }
+    // As with MechaInitMechacon(), the MECHACON must be in EEP_CS high mode.
+    if (raw->cfc == 0)
+    {
+        PlatShowMessage("%s: EEP_CS isn't high.\n", board->port);
+        return -EINVAL;
+    }
+
+    if (EEPROMInitID() != 0)
+    {
+        PlatShowMessage("%s: cannot read the i.LINK ID and console ID.\n", board->port);
+        return -EIO;
+    }
+    EEPROMGetiLinkID(board->iLinkID);
+    EEPROMGetConsoleID(board->ConsoleID);
+
+    // The boards of a batch are made in the same second, so only the random part tells their Shimukes apart.
+    do
+    {
+        MechaMakeShimuke(board->index, board->IsDex, board->shimuke);
+        for (i = 0; &boards[i] < board && strcmp(boards[i].shimuke, board->shimuke) != 0; i++)
+            ;
+    } while (&boards[i] < board);
+
+    PlatShowMessage("%s:\tCFD: %s CFC: %08x\t%s %02d\tShimuke: %s\n",
+                    board->port, board->cfd, board->cfc, board->IsDex ? "DEX" : "CEX", board->model, board->shimuke);
+
+    return 0;
+}
+
+// Returns NULL if the step does not apply to the board.
+static const char *BatchGetArgs(const struct BatchBoard *board, unsigned short int command)
+{
+    switch (command)
+    {
+        case MECHA_CMD_INIT_MECHACON:
+            return (board->IsDex ? "0001" : NULL);
+        case MECHA_CMD_INIT_SHIMUKE:
+            return board->shimuke;
+        case MECHA_CMD_CLEAR_CONF:
+            return "00";
+        case MECHA_CMD_SETUP_OSD:
+            return (MechaGetInitVMode(board->index, board->IsDex) == 0 ? "00" : "01");
+        default:
+            return NULL;
+    }
+}
+
+// Collects the response of every board that a command was posted to, in the order that they were posted.
+static void BatchCollect(unsigned short int timeout, const char *step, int ready)
+{
+    char buffer[MECHA_RX_BUFFER_SIZE];
+    struct BatchBoard *board;
+    int i, result;
+
+    for (i = 0, board = boards; i < BoardCount; i++, board++)
+    {
+        if (!board->waiting || board->result != 0)
+            continue;
+
+        if ((result = MechaCommandCollect(timeout, buffer, sizeof(buffer))) > 0 && buffer[0] == '0')
+        {
+            if (ready)
+                board->waiting = 0;
+        }
+        else if (!ready)
+            BatchFail(board, result > 0 ? (int)strtoul(buffer, NULL, 16) : result, step);
+    }
+}
+
+/*  Instead of waiting for a fixed time, every board is polled until it responds again.
+    The boards that are still busy when BATCH_READY_MS runs out are failed. */
+static void BatchWaitReady(const char *step)
+{
+    struct BatchBoard *board;
+    int i, waiting, result;
+    u64 deadline;
+
+    deadline = PlatGetTime() + BATCH_READY_MS * 1000000ULL;
+    do
+    {
+        for (i = 0, board = boards; i < BoardCount; i++, board++)
+        {
+            if (board->waiting && board->result == 0 && (result = MechaCommandPost(&board->link, MECHA_CMD_READ_MODEL, NULL)) != 0)
+                BatchFail(board, result, step);
+        }
+        BatchCollect(BATCH_READY_MS, step, 1);
+
+        for (i = 0, board = boards, waiting = 0; i < BoardCount; i++, board++)
+            waiting += (board->waiting && board->result == 0);
+        if (waiting > 0)
+            PlatSleep(MECHA_WAIT_STEP_MS);
+    } while (waiting > 0 && PlatGetTime() < deadline);
+
+    for (i = 0, board = boards; i < BoardCount; i++, board++)
+    {
+        if (board->waiting && board->result == 0)
+            BatchFail(board, -ETIMEDOUT, step);
+        board->waiting = 0;
+    }
+}
+
+// Sends a step to all boards at once. Returns the number of boards that are still good.
+static int BatchRunStep(const struct BatchStep *step)
+{
+    char buffer[MECHA_RX_BUFFER_SIZE];
+    struct BatchBoard *board;
+    const char *args;
+    int i, good, result;
+
+    for (i = 0, board = boards; i < BoardCount; i++, board++)
+    {
+        if (board->result != 0 || (args = BatchGetArgs(board, step->command)) == NULL)
+            continue;
+        if ((result = MechaCommandPost(&board->link, step->command, args)) != 0)
+            BatchFail(board, result, step->label);
+        else
+            board->waiting = 1;
+    }
+    BatchCollect(MECHA_TASK_NORMAL_TO, step->label, 0);
+    BatchWaitReady(step->label);
+
+    // Discard the responses that are still outstanding after an error.
+    while (MechaCommandCollect(MECHA_TASK_NORMAL_TO, buffer, sizeof(buffer)) != -EINVAL)
+        ;
+
+    for (i = 0, good = 0; i < BoardCount; i++)
+        good += (boards[i].result == 0);
+
+    return good;
+}
+
+static void BatchWriteRow(FILE *file, const struct BatchBoard *board)
+{
+    const char *p;
+    int i;
+
+    fputc('"', file);
+    for (p = board->port; *p != '\0'; p++)
+    {
+        if (*p == '"')
+            fputc('"', file);
+        fputc(*p, file);
+    }
+    fprintf(file, "\",%s,%02d,%s,%08x,", board->IsDex ? "dex" : "cex", board->model, board->cfd, board->cfc);
+    for (i = 0; i < 8; i++)
+        fprintf(file, "%02x", board->iLinkID[i]);
+    fputc(',', file);
+    for (i = 0; i < 8; i++)
+        fprintf(file, "%02x", board->ConsoleID[i]);
+    if (board->result == 0)
+        fprintf(file, ",%s,done\n", board->shimuke);
+    else
+        fprintf(file, ",%s,%s failed (%d)\n", board->shimuke, board->step, board->result);
+}
+
+int BatchInitMechacon(const char *manifest, const char *output)
+{
+    struct BatchBoard *board;
+    FILE *file;
+    int i, good, result;
+    u64 start;
+
+    if ((result = BatchLoadManifest(manifest)) != 0)
+        return result;
+
+    if ((file = fopen(output, "w")) == NULL)
+    {
+        PlatShowMessage("Cannot create %s.\n", output);
+        return -EIO;
+    }
+
+    if ((result = BatchOpen()) != 0)
+    {
+        fclose(file);
+        return result;
+    }
+    PlatSetCancelHandler(&MechaCancel);
+
+    PlatShowMessage("\nBoards:\n");
+    for (i = 0, board = boards, good = 0; i < BoardCount; i++, board++)
+    {
+        if ((result = BatchIdentify(board)) != 0)
+        {
+            board->result = result;
+            board->step   = "Identification";
+        }
+        else
+            good++;
+    }
+    MechaSetTransport(NULL);
+
+    PlatShowMessage("\nInitializing %d of %d boards:\n", good, BoardCount);
+    start = PlatGetTime();
+    for (i = 0; good > 0 && i < (int)(sizeof(BatchSteps) / sizeof(BatchSteps[0])); i++)
+    {
+        PlatShowMessage("%s\n", BatchSteps[i].label);
+        good = BatchRunStep(&BatchSteps[i]);
+    }
+    PlatShowMessage("%d of %d boards initialized in %.2fs.\n", good, BoardCount, (PlatGetTime() - start) / 1e9);
+
+    fputs(BatchColumns, file);
+    for (i = 0; i < BoardCount; i++)
+        BatchWriteRow(file, &boards[i]);
+    result = ferror(file) ? -EIO : 0;
+    fclose(file);
+
+    BatchClose();
+
+    if (result == 0 && good < BoardCount)
+        result = -EIO;
+
+    return result;
+}
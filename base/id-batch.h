@@ -0,0 +1,11 @@
+/*  Batch MECHACON initialization, for a tray of replacement Dragon (H/I-chassis) boards:
+        PMAP --init-batch <manifest> <CSV file>
+    Each line of the manifest names a port, the type and the model of a board (i.e. "/dev/ttyUSB0 cex 4" for SCPH-xx004).
+    Lines that start with # are comments. The ports may be COM ports, plus the simulator and a serial server.
+    The initialization steps are sent to all boards at once and each step is followed by polling every board until
+    it responds again, rather than by fixed waits. The identity of each board (MECHACON ID, i.LINK ID and console ID)
+    is written to the CSV file with the Shimuke value that it was given. */
+#define BATCH_BOARDS_MAX 8    // No more than MECHA_PIPELINE_MAX and PLAT_COM_PORTS.
+#define BATCH_READY_MS   1000 // Longest time for a board to become ready after a step.
+
+int BatchInitMechacon(const char *manifest, const char *output);
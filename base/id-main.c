@@ -8,6 +8,7 @@
 #include "eeprom.h"
 #include "eeprom-id.h"
 #include "main.h"
+#include "session.h"
 
 extern unsigned char ConType;
 
@@ -29,10 +30,12 @@ static void InitMechacon(void)
                                 "\t3. Quit\n"
                                 "Your choice: ");
                 choice = 0;
+                SessionWaitBegin("MECHACON type");
                 if (scanf("%d", &choice) > 0)
                     while (getchar() != '\n')
                     {
                     };
+                SessionWaitEnd();
             } while (choice < 1 || choice > 3);
 
             switch (choice)
@@ -87,10 +90,12 @@ static void InitMechacon(void)
                         NumChoices = 8;
                     }
                     choice = 0;
+                    SessionWaitBegin("MECHACON model name");
                     if (scanf("%d", &choice) > 0)
                         while (getchar() != '\n')
                         {
                         };
+                    SessionWaitEnd();
                 } while (choice < 1 || choice > NumChoices);
                 if (!dex)
                 {
@@ -109,7 +114,7 @@ static void InitMechacon(void)
                         case 11:
                         case 12:
                         case 13:
-                            PlatShowMessage("MechaInit: %s\n", MechaInitMechacon(choice, 0) == 0 ? "done" : "failed");
+                            PlatShowMessage("MechaInit: %s\n", MechaInitMechacon(choice - 1, 0) == 0 ? "done" : "failed");
                             break;
                         case 14:
                             done = 1;
@@ -127,7 +132,7 @@ static void InitMechacon(void)
                         case 5:
                         case 6:
                         case 7:
-                            PlatShowMessage("MechaInit: %s\n", MechaInitMechacon(choice, 1) == 0 ? "done" : "failed");
+                            PlatShowMessage("MechaInit: %s\n", MechaInitMechacon(choice - 1, 1) == 0 ? "done" : "failed");
                             break;
                         case 8:
                             done = 1;
@@ -151,16 +156,19 @@ static void WriteiLinkID(void)
     PlatShowMessage("Current i.Link ID:\t%02x %02x %02x %02x %02x %02x %02x %02x\n"
                     "Enter new ID:\t\t",
                     iLinkID[0], iLinkID[1], iLinkID[2], iLinkID[3], iLinkID[4], iLinkID[5], iLinkID[6], iLinkID[7]);
+    SessionWaitBegin("i.Link ID");
     if (scanf("%02hx %02hx %02hx %02hx %02hx %02hx %02hx %02hx",
               &NewiLinkIDInput[0], &NewiLinkIDInput[1], &NewiLinkIDInput[2], &NewiLinkIDInput[3], &NewiLinkIDInput[4],
               &NewiLinkIDInput[5], &NewiLinkIDInput[6], &NewiLinkIDInput[7]) == 8)
     {
+        SessionWaitEnd();
         for (i = 0; i < 8; i++)
             iLinkID[i] = (u8)NewiLinkIDInput[i];
         PlatShowMessage("iLink ID update %s\n", (EEPROMSetiLinkID(iLinkID) == 0) ? "completed" : "failed");
     }
     else
     {
+        SessionWaitEnd();
         PlatShowMessage("Operation aborted.\n");
     }
 
@@ -179,16 +187,19 @@ static void WriteConsoleID(void)
     PlatShowMessage("Current console ID:\t%02x %02x %02x %02x %02x %02x %02x %02x\n"
                     "Enter new ID:\t\t",
                     ConsoleID[0], ConsoleID[1], ConsoleID[2], ConsoleID[3], ConsoleID[4], ConsoleID[5], ConsoleID[6], ConsoleID[7]);
+    SessionWaitBegin("Console ID");
     if (scanf("%02hx %02hx %02hx %02hx %02hx %02hx %02hx %02hx",
               &NewConsoleIDInput[0], &NewConsoleIDInput[1], &NewConsoleIDInput[2], &NewConsoleIDInput[3], &NewConsoleIDInput[4],
               &NewConsoleIDInput[5], &NewConsoleIDInput[6], &NewConsoleIDInput[7]) == 8)
     {
+        SessionWaitEnd();
         for (i = 0; i < 8; i++)
             ConsoleID[i] = (u8)NewConsoleIDInput[i];
         PlatShowMessage("Console ID update %s\n", (EEPROMSetConsoleID(ConsoleID) == 0) ? "completed" : "failed");
     }
     else
     {
+        SessionWaitEnd();
         PlatShowMessage("Operation aborted.\n");
     }
 
@@ -214,8 +225,10 @@ static void WriteModelName(void)
                     "Maximum length is 16\n"
                     "Enter new name:\t\t",
                     ModelName[0] == 0x00 ? "<No model name>" : ModelName);
+    SessionWaitBegin("Model name");
     if (fgets(NewModelName, sizeof(NewModelName), stdin))
     {
+        SessionWaitEnd();
         NewModelName[16] = '\0';
         PlatShowMessage("Model name update %s\n", (EEPROMSetModelName(NewModelName) == 0) ? "completed" : "failed");
     }
@@ -245,10 +258,12 @@ static void InitNTSCPALDefaults(void)
                         "\t3. Quit\n"
                         "Your choice: ");
         choice = 0;
+        SessionWaitBegin("NTSC/PAL selection");
         if (scanf("%d", &choice) > 0)
             while (getchar() != '\n')
             {
             };
+        SessionWaitEnd();
     } while (choice < 1 || choice > 3);
 
     switch (choice)
@@ -289,10 +304,12 @@ void MenuID(void)
                             "\t6. Quit\n"
                             "Your choice: ");
             choice = 0;
+            SessionWaitBegin("ID menu");
             if (scanf("%d", &choice) > 0)
                 while (getchar() != '\n')
                 {
                 };
+            SessionWaitEnd();
         } while (choice < 1 || choice > 6);
         putchar('\n');
 
@@ -0,0 +1,185 @@
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "platform.h"
+#include "mecha.h"
+#include "latency.h"
+
+struct LatencyStats
+{
+    unsigned short int command;
+    unsigned int count;
+    u64 total, wire;
+};
+
+static struct LatencyStats stats[LATENCY_MAX_COMMANDS];
+static unsigned short int StatsCount;
+static unsigned char enabled = 0;
+static u64 AdapterLatency;
+
+u64 LatencyGetWireTime(unsigned int bytes)
+{
+    return bytes * 10ULL * 1000000000ULL / MECHA_BAUD_RATE;
+}
+
+void LatencyInit(u64 adapter)
+{
+    StatsCount     = 0;
+    AdapterLatency = adapter;
+    enabled        = 1;
+}
+
+void LatencyRecord(unsigned short int command, unsigned int TxBytes, unsigned int RxBytes, u64 time)
+{
+    struct LatencyStats *stat;
+    unsigned short int i;
+    u64 wire;
+
+    if (!enabled)
+        return;
+
+    for (i = 0, stat = stats; i < StatsCount; i++, stat++)
+    {
+        if (stat->command == command)
+            break;
+    }
+    if (i == StatsCount)
+    {
+        if (StatsCount >= LATENCY_MAX_COMMANDS)
+            return;
+        memset(stat, 0, sizeof(*stat));
+        stat->command = command;
+        StatsCount++;
+    }
+
+    /*  Links that are faster than MECHA_BAUD_RATE (e.g. the simulator or a network bridge) can answer sooner than the wire time.
+        The wire time is never more than the round-trip time, so that the wire, adapter and device shares add up to 100%. */
+    wire = LatencyGetWireTime(TxBytes + RxBytes);
+    stat->count++;
+    stat->total += time;
+    stat->wire += wire < time ? wire : time;
+}
+
+void LatencyReport(void)
+{
+    const MechaTransport_t *transport;
+    struct LatencyStats *stat, temp;
+    unsigned short int i, j;
+    double rtt, wire, adapter, device, TotalTime, TotalWire, TotalAdapter, TotalDevice;
+
+    if (!enabled || StatsCount == 0)
+        return;
+
+    // Most time first.
+    for (i = 1; i < StatsCount; i++)
+    {
+        for (j = i; j > 0 && stats[j].total > stats[j - 1].total; j--)
+        {
+            temp         = stats[j];
+            stats[j]     = stats[j - 1];
+            stats[j - 1] = temp;
+        }
+    }
+
+    PlatShowMessage("\nLatency per command (mean, ms; adapter latency: %.2f ms%s):\n"
+                    "Cmd  Name                  Count      RTT     Wire  Adapter   Device  Total time\n",
+                    AdapterLatency / 1e6, AdapterLatency == 0 ? ", not probed" : "");
+
+    TotalTime = TotalWire = TotalAdapter = TotalDevice = 0.0;
+    for (i = 0, stat = stats; i < StatsCount; i++, stat++)
+    {
+        rtt  = stat->total / 1e6 / stat->count;
+        wire = stat->wire / 1e6 / stat->count;
+        if (wire > rtt)
+            wire = rtt;
+        // Whatever the wire and the adapter do not account for is the device.
+        adapter = AdapterLatency / 1e6 < rtt - wire ? AdapterLatency / 1e6 : (rtt > wire ? rtt - wire : 0.0);
+        device  = rtt - wire - adapter > 0.0 ? rtt - wire - adapter : 0.0;
+
+        PlatShowMessage("%03x  %-20.20s %6u %8.2f %8.2f %8.2f %8.2f %10.2fs\n",
+                        stat->command, MechaGetCommandName(stat->command), stat->count, rtt, wire, adapter, device, stat->total / 1e9);
+
+        TotalTime += stat->total / 1e9;
+        TotalWire += wire * stat->count / 1e3;
+        TotalAdapter += adapter * stat->count / 1e3;
+        TotalDevice += device * stat->count / 1e3;
+    }
+
+    if (TotalTime > 0.0)
+        PlatShowMessage("Total: %.2fs, of which wire %.1f%%, adapter %.1f%%, device %.1f%%.\n",
+                        TotalTime, TotalWire * 100.0 / TotalTime, TotalAdapter * 100.0 / TotalTime, TotalDevice * 100.0 / TotalTime);
+    transport = MechaGetTransport();
+    if (transport != NULL && transport->pipeline > 1)
+        PlatShowMessage("Note: with pipelining, the RTT of a command includes the time that it was queued behind earlier commands,\n"
+                        "      which is attributed to the device.\n");
+}
+
+/*  Sends frames of different lengths and times their echoes, with TXD connected to RXD on the serial adapter.
+    The round-trip time of a frame is its wire time, plus the latency of the adapter in both directions.
+    A least-squares fit of the round-trip time against the frame length gives the adapter latency (intercept)
+    and the effective line rate (slope). */
+int LatencyProbe(void)
+{
+    const MechaTransport_t *transport;
+    char frame[MECHA_TX_BUFFER_SIZE], echo[MECHA_TX_BUFFER_SIZE];
+    int i, len, size, result, samples;
+    double x, y, SumX, SumY, SumXX, SumXY, slope, intercept;
+    u64 start;
+
+    transport = MechaGetTransport();
+    samples   = 0;
+    SumX = SumY = SumXX = SumXY = 0.0;
+
+    PlatShowMessage("Loopback probe (TXD must be connected to RXD):\n");
+    for (i = 0; i < LATENCY_PROBE_FRAMES; i++)
+    {
+        len = 4 + (i % 8) * 3;
+        memset(frame, 'U', len);
+        strcpy(&frame[len], "\r\n");
+        len += 2;
+
+        start = PlatGetTime();
+        if (transport->write(frame) != len)
+            return -EIO;
+
+        for (size = 0, result = 0; size < len; size++)
+        {
+            if ((result = transport->read(&echo[size], 1, 1000)) <= 0)
+                break;
+        }
+        if (result <= 0 || memcmp(echo, frame, len) != 0)
+        {
+            PlatShowMessage("No echo (frame %d).\n", i);
+            PlatSleep(100); // Let the line become idle.
+            continue;
+        }
+
+        x = len;
+        y = (PlatGetTime() - start) / 1e6;
+        SumX += x;
+        SumY += y;
+        SumXX += x * x;
+        SumXY += x * y;
+        samples++;
+    }
+
+    if (samples < LATENCY_PROBE_FRAMES / 2 || samples * SumXX - SumX * SumX <= 0.0)
+    {
+        PlatShowMessage("Loopback probe failed: %d of %d frames echoed.\n", samples, LATENCY_PROBE_FRAMES);
+        return -EIO;
+    }
+
+    slope     = (samples * SumXY - SumX * SumY) / (samples * SumXX - SumX * SumX);
+    intercept = (SumY - slope * SumX) / samples;
+    if (intercept < 0.0)
+        intercept = 0.0;
+
+    PlatShowMessage("%d frames echoed.\n"
+                    "Wire time per byte:\t%.3f ms (expected %.3f ms at %u bps)\n"
+                    "Adapter latency:\t%.2f ms\n"
+                    "Use --latency=%.2f to attribute the latency of commands with this adapter.\n",
+                    samples, slope, LatencyGetWireTime(1) / 1e6, MECHA_BAUD_RATE, intercept, intercept);
+
+    return 0;
+}
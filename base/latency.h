@@ -0,0 +1,13 @@
+/*  Latency attribution: splits the round-trip time of every command into
+        wire time: the time to send the command and response frames at MECHA_BAUD_RATE,
+        adapter latency: the latency of the serial adapter (i.e. the USB latency timer), measured with a loopback probe,
+        device time: the remainder, which is the processing time of the MECHACON. */
+#define LATENCY_MAX_COMMANDS 128
+#define LATENCY_PROBE_FRAMES 64
+
+void LatencyInit(u64 adapter); // Adapter latency, in ns.
+void LatencyRecord(unsigned short int command, unsigned int TxBytes, unsigned int RxBytes, u64 time);
+void LatencyReport(void);
+u64 LatencyGetWireTime(unsigned int bytes);
+
+int LatencyProbe(void); // Requires TXD to be connected to RXD on the serial adapter.
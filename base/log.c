@@ -0,0 +1,87 @@
+#include <errno.h>
+#include <string.h>
+
+#include "platform.h"
+#include "log.h"
+
+// Wire logging is opt-in: it formats every command and response.
+unsigned char LogLevels[LOG_CATEGORIES] = {LOG_OFF, LOG_INFO, LOG_INFO, LOG_INFO};
+
+static const char *const LogCategoryNames[LOG_CATEGORIES] = {"wire", "judge", "ui", "engine"};
+static const char *const LogLevelNames[]                  = {"off", "error", "info", "debug"};
+
+static int LogParseLevel(const char *name, int len)
+{
+    int i;
+
+    for (i = 0; i <= LOG_DEBUG; i++)
+    {
+        if ((int)strlen(LogLevelNames[i]) == len && !pstrincmp(name, LogLevelNames[i], len))
+            return i;
+    }
+
+    return -1;
+}
+
+int LogConfigure(const char *spec)
+{
+    const char *end, *equals;
+    int i, category, level;
+
+    for (; *spec != '\0'; spec = (*end == ',' ? end + 1 : end))
+    {
+        if ((end = strchr(spec, ',')) == NULL)
+            end = spec + strlen(spec);
+
+        if ((equals = memchr(spec, '=', end - spec)) == NULL)
+        {
+            // A level on its own applies to all categories.
+            category = -1;
+            equals   = spec - 1;
+        }
+        else
+        {
+            for (category = 0; category < LOG_CATEGORIES; category++)
+            {
+                if ((int)strlen(LogCategoryNames[category]) == equals - spec && !pstrincmp(spec, LogCategoryNames[category], (int)(equals - spec)))
+                    break;
+            }
+            if (category == LOG_CATEGORIES)
+            {
+                if (equals - spec != 3 || pstrincmp(spec, "all", 3))
+                {
+                    PlatShowMessage("Unknown log category: %.*s\n", (int)(equals - spec), spec);
+                    return -EINVAL;
+                }
+                category = -1;
+            }
+        }
+
+        if ((level = LogParseLevel(equals + 1, (int)(end - equals - 1))) < 0)
+        {
+            PlatShowMessage("Unknown log level: %.*s\n", (int)(end - equals - 1), equals + 1);
+            return -EINVAL;
+        }
+
+        for (i = 0; i < LOG_CATEGORIES; i++)
+        {
+            if (category < 0 || category == i)
+                LogLevels[i] = (unsigned char)level;
+        }
+    }
+
+    return 0;
+}
+
+int LogIsActive(void)
+{
+    int i;
+
+    for (i = 0; i < LOG_CATEGORIES; i++)
+    {
+        if (LogLevels[i] != LOG_OFF)
+            return 1;
+    }
+
+    return 0;
+}
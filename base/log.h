@@ -0,0 +1,25 @@
+/*  Log levels per category, for the debug log (pmap_<time>.log).
+    Messages of a disabled category or level are not formatted: LogPrintf() only tests a flag. */
+#define LOG_WIRE       0 // Commands and responses
+#define LOG_JUDGE      1 // Measurements and their judgements
+#define LOG_UI         2 // Messages shown to the user
+#define LOG_ENGINE     3 // Command engine: skipped tasks, injected faults
+#define LOG_CATEGORIES 4
+
+#define LOG_OFF        0
+#define LOG_ERROR      1
+#define LOG_INFO       2
+#define LOG_DEBUG      3
+
+extern unsigned char LogLevels[LOG_CATEGORIES];
+
+#define LogEnabled(category, level) (LogLevels[category] >= (level))
+#define LogPrintf(category, level, ...)  \
+    do                                   \
+    {                                    \
+        if (LogEnabled(category, level)) \
+            PlatDPrintf(__VA_ARGS__);    \
+    } while (0)
+
+int LogConfigure(const char *spec); // "<level>" or "<category>=<level>[,<category>=<level>...]"
+int LogIsActive(void);
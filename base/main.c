@@ -5,9 +5,23 @@
 #include <errno.h>
 
 #include "platform.h"
+#include "log.h"
 #include "main.h"
 #include "mecha.h"
 #include "eeprom.h"
+#include "session.h"
+#include "trace.h"
+#include "sim.h"
+#include "fault.h"
+#include "net.h"
+#include "latency.h"
+#include "extract.h"
+#include "watch.h"
+#include "clone.h"
+#include "fingerprint.h"
+#ifdef ID_MANAGEMENT
+#include "id-batch.h"
+#endif
 
 void DisplayRawIdentData(void)
 {
@@ -68,29 +82,200 @@ void DisplayConnHelp(void)
            "Check the connections, press the RESET button and try again.\n\n");
 }
 
+int GetConsolePortType(const char *port)
+{
+    if (!strncmp(port, "sim:", 4))
+        return CONSOLE_PORT_SIM;
+    if (!strncmp(port, "tcp:", 4) || !strncmp(port, "rfc2217:", 8))
+        return CONSOLE_PORT_NET;
+
+    return CONSOLE_PORT_COM;
+}
+
+// The console is reached through a COM port, the simulator or a serial server on the network.
+int OpenConsole(const char *port)
+{
+    switch (GetConsolePortType(port))
+    {
+        case CONSOLE_PORT_SIM:
+            return SimOpen(&port[4]);
+        case CONSOLE_PORT_NET:
+            return (!strncmp(port, "tcp:", 4) ? NetOpen(&port[4], 0) : NetOpen(&port[8], 1));
+        default:
+            return PlatOpenCOMPort(port);
+    }
+}
+
+void CloseConsole(const char *port)
+{
+    switch (GetConsolePortType(port))
+    {
+        case CONSOLE_PORT_SIM:
+            SimClose();
+            break;
+        case CONSOLE_PORT_NET:
+            NetClose();
+            break;
+        default:
+            PlatCloseCOMPort();
+    }
+}
+
 int main(int argc, char *argv[])
 {
     short int choice;
     unsigned char done;
+    const char *faults = NULL, *fingerprints = NULL;
+    int i;
+
+    // Offline tools, which do not require a console.
+    if (argc == 4 && !strcmp(argv[1], "--import-capture"))
+        return (TraceImportCapture(argv[2], argv[3]) == 0 ? 0 : EIO);
+    if (argc == 4 && !strcmp(argv[1], "--compare"))
+        return (TraceCompare(argv[2], argv[3]) == 0 ? 0 : EIO);
+    if (argc == 4 && !strcmp(argv[1], "--extract"))
+        return (ExtractDumps(argv[2], argv[3]) == 0 ? 0 : EIO);
+    if (argc == 4 && !strcmp(argv[1], "--classify"))
+        return (ExtractClassify(argv[2], argv[3]) == 0 ? 0 : EIO);
+    if ((argc == 4 || (argc == 5 && !strcmp(argv[4], "--keep-id"))) && !strcmp(argv[1], "--clone"))
+        return (CloneConsole(argv[2], argv[3], argc == 5) == 0 ? 0 : EIO);
+#ifdef ID_MANAGEMENT
+    if (argc == 4 && !strcmp(argv[1], "--init-batch"))
+        return (BatchInitMechacon(argv[2], argv[3]) == 0 ? 0 : EIO);
+#endif
+    if (argc == 3 && !strcmp(argv[1], "--loopback-probe"))
+    {
+        if (OpenConsole(argv[2]) != 0)
+        {
+            PlatShowMessage("Cannot open %s.\n", argv[2]);
+            return ENODEV;
+        }
+        i = LatencyProbe();
+        CloseConsole(argv[2]);
+        return (i == 0 ? 0 : EIO);
+    }
 
-    if (argc != 2)
+    if (argc < 2 || !strncmp(argv[1], "--", 2))
     {
-        PlatShowMessage("Syntax error. Syntax: PMAP <COM port>\n");
+        PlatShowMessage("Syntax error. Syntax: PMAP <COM port> [options]\n"
+                        "\tPMAP sim:<profile>[:<speed>[:<seed>]] [options]\n"
+                        "\tPMAP tcp:<host>:<port>[:<depth>] [options]\n"
+                        "\tPMAP rfc2217:<host>:<port>[:<depth>] [options]\n"
+                        "Options:\n"
+                        "\t--rt-io[=<CPU>]\tRun serial I/O on a real-time thread (optionally bound to a CPU)\n"
+                        "\t--trace=<file>\tRecord the session to a trace file\n"
+                        "\t--chrome-trace=<file>\tRecord the session timeline as Chrome trace-event JSON\n"
+                        "\t--pcapng=<file>\tWrite the frames sent and received to a pcapng file on exit\n"
+                        "\t--latency[=<ms>]\tAttribute command latency to the wire, the adapter (latency in ms) and the console\n"
+                        "\t--faults=<schedule>\tInject faults into the received data (random:<percent>[:<seed>[:<classes>]] or a script)\n"
+                        "\t--watch=<words>[@<ms>]\tShow changes to EEPROM words (hex, <first>-<last>, eegs, osd2, model, ilink, conid or all)\n"
+                        "\t--fingerprints=<file>\tReport the EEPROM regions that changed since the last visit of the console\n"
+                        "\t--io-stats\tShow the system calls, wakeups and blocked time of the serial I/O of every job\n"
+                        "\t--log=<levels>\tLog levels (off, error, info, debug) of the wire, judge, ui and engine categories\n"
+                        "Tools:\n"
+                        "\tPMAP --import-capture <capture> <trace>\n"
+                        "\tPMAP --compare <reference trace> <trace>\n"
+                        "\tPMAP --loopback-probe <COM port or serial server>\n"
+                        "\tPMAP --clone <source port> <target port> [--keep-id]\n"
+#ifdef ID_MANAGEMENT
+                        "\tPMAP --init-batch <manifest> <CSV file>\n"
+#endif
+                        "\tPMAP --extract <directory or .tar archive> <CSV file>\n"
+                        "\tPMAP --classify <directory or .tar archive> <CSV file>\n");
+        SimListProfiles();
         return EINVAL;
     }
 
-    if (PlatOpenCOMPort(argv[1]) != 0)
+    for (i = 2; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--rt-io"))
+            PlatEnableRTIO(-1);
+        else if (!strncmp(argv[i], "--rt-io=", 8))
+            PlatEnableRTIO(atoi(&argv[i][8]));
+        else if (!strncmp(argv[i], "--trace=", 8))
+        {
+            if (TraceOpen(&argv[i][8]) != 0)
+            {
+                PlatShowMessage("Cannot create %s.\n", &argv[i][8]);
+                return EIO;
+            }
+        }
+        else if (!strncmp(argv[i], "--chrome-trace=", 15))
+        {
+            if (TraceChromeOpen(&argv[i][15], argv[1]) != 0)
+            {
+                PlatShowMessage("Cannot create %s.\n", &argv[i][15]);
+                TraceClose();
+                return EIO;
+            }
+        }
+        else if (!strncmp(argv[i], "--pcapng=", 9))
+        {
+            if (TracePcapngOpen(&argv[i][9], argv[1]) != 0)
+            {
+                PlatShowMessage("Cannot create %s.\n", &argv[i][9]);
+                TraceClose();
+                TraceChromeClose();
+                return EIO;
+            }
+        }
+        else if (!strcmp(argv[i], "--latency"))
+            LatencyInit(0);
+        else if (!strncmp(argv[i], "--latency=", 10))
+            LatencyInit((u64)(atof(&argv[i][10]) * 1e6));
+        else if (!strncmp(argv[i], "--faults=", 9))
+            faults = &argv[i][9];
+        else if (!strncmp(argv[i], "--watch=", 8))
+        {
+            if (WatchOpen(&argv[i][8]) != 0)
+                return EINVAL;
+        }
+        else if (!strncmp(argv[i], "--fingerprints=", 15))
+            fingerprints = &argv[i][15];
+        else if (!strcmp(argv[i], "--io-stats"))
+            SessionEnableIOReport();
+        else if (!strncmp(argv[i], "--log=", 6))
+        {
+            if (LogConfigure(&argv[i][6]) != 0)
+                return EINVAL;
+        }
+        else
+        {
+            PlatShowMessage("Unrecognized option: %s\n", argv[i]);
+            return EINVAL;
+        }
+    }
+
+    if (OpenConsole(argv[1]) != 0)
     {
         PlatShowMessage("Cannot open %s.\n", argv[1]);
+        TraceClose();
+        TraceChromeClose();
+        TracePcapngClose();
         return ENODEV;
     }
 
-    // TODO!
-    PlatDebugInit();
+    if (faults != NULL && FaultOpen(faults) != 0)
+    {
+        CloseConsole(argv[1]);
+        TraceClose();
+        TraceChromeClose();
+        TracePcapngClose();
+        return EINVAL;
+    }
+
+    if (LogIsActive())
+        PlatDebugInit();
+    SessionInit();
+    PlatSetCancelHandler(&MechaCancel);
+
+    if (fingerprints != NULL && FingerprintOpen(fingerprints) != 0)
+        DisplayConnHelp();
 
     done = 0;
     do
     {
+        // pmap-bench scripts choices of this menu (BENCH_MAIN_* in PMAP-unix/bench.c): keep them in step when renumbering.
         do
         {
             PlatShowMessage("\nP.M.A.P (v1.2)\n"
@@ -106,10 +291,14 @@ int main(int argc, char *argv[])
                    "Your choice: ");
 
             choice = 0;
+            SessionWaitBegin("Main menu");
             if (scanf("%hd", &choice) > 0)
                 while (getchar() != '\n')
                 {
                 };
+            SessionWaitEnd();
+            if (MechaCancelStop())
+                choice = 5; // Ctrl-C with the drive running: it was stopped, so PMAP exits as asked.
 
 #ifdef ID_MANAGEMENT
             if (choice == 99)
@@ -142,9 +331,20 @@ int main(int argc, char *argv[])
             default:
                 done = 1;
         }
-    } while (!done);
+    } while (!done && !MechaIsExitRequested());
+
+    FingerprintClose();
+    WatchClose();
+    SessionReport();
+    LatencyReport();
+    FaultReport();
+    FaultClose();
+
+    CloseConsole(argv[1]);
 
-    PlatCloseCOMPort();
+    TraceClose();
+    TraceChromeClose();
+    TracePcapngClose();
 
     PlatDebugDeinit();
 
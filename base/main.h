@@ -1,3 +1,14 @@
+enum CONSOLE_PORT
+{
+    CONSOLE_PORT_COM = 0,
+    CONSOLE_PORT_SIM,
+    CONSOLE_PORT_NET,
+};
+
+int GetConsolePortType(const char *port);
+int OpenConsole(const char *port);
+void CloseConsole(const char *port);
+
 void DisplayRawIdentData(void);
 void DisplayCommonConsoleInfo(void);
 void DisplayConnHelp(void);
@@ -7,6 +7,7 @@
 #include "mecha.h"
 #include "eeprom.h"
 #include "main.h"
+#include "session.h"
 
 /*  Adjustment process:
     1. Remove tray (Not required for B-chassis)
@@ -59,15 +60,53 @@ struct CdError
     u16 c1, c2;
 };
 
+struct MechaAdjSpeed
+{
+    u16 command;
+    u16 timeout;
+    const char *name;
+};
+
+static const struct MechaAdjSpeed CdSpeeds[] = {
+    {MECHA_CMD_CD_PLAY_1, 3000, "1x"},
+    {MECHA_CMD_CD_PLAY_2, 3000, "2x"},
+    {MECHA_CMD_CD_PLAY_3, 3000, "4x"},
+    {MECHA_CMD_CD_PLAY_4, 4000, "5-12x"},
+    {MECHA_CMD_CD_PLAY_5, 3000, "10-24x"}};
+
+static const struct MechaAdjSpeed DvdSpeeds[] = {
+    {MECHA_CMD_DVD_PLAY_1, 5000, "1x"},
+    {MECHA_CMD_DVD_PLAY_2, 5000, "1.6x"},
+    {MECHA_CMD_DVD_PLAY_3, 5000, "1.6-4x"}};
+
+#define MECHA_ADJ_CD_SPEEDS  (int)(sizeof(CdSpeeds) / sizeof(CdSpeeds[0]))
+#define MECHA_ADJ_DVD_SPEEDS (int)(sizeof(DvdSpeeds) / sizeof(DvdSpeeds[0]))
+
+// One speed of the speed profile. The errors are C1/C2 for a CD, PI+PO correctable/PI non-correctable for a DVD.
+struct MechaAdjProfileRow
+{
+    const struct MechaAdjSpeed *speed;
+    int result; // Of the play command.
+    unsigned short int samples;
+    u32 JitterSum, ErrorSum;
+    u16 JitterMax, ErrorMax, FatalMax;
+};
+
 extern unsigned char ConType;
 static unsigned char ConIsT10K, status, SledIsAtHome, DiscDetect;
+static unsigned char FocusLayer; // Layer of a DVD-DL that is in focus (0 = L0): play starts on L0, and every focus jump changes it.
 static unsigned short int DvdJitter, StepAmount;
 static struct DvdError DvdError;
 static struct CdError CdError;
 
 typedef int (*MechaCmdFunction_t)(short int argc, char *argv[]);
 
-#define MECHA_ADJ_MAX_ARGS   4
+#define MECHA_ADJ_MAX_ARGS   5
+#define MECHA_ADJ_PROFILE_DWELL       2000 // Default time at each speed before it is sampled, in ms.
+#define MECHA_ADJ_PROFILE_SAMPLES     4    // Default number of samples at each speed.
+#define MECHA_ADJ_PROFILE_SAMPLES_MAX 64
+#define MECHA_ADJ_PROFILE_GAP         250 // Between samples, in ms.
+#define MECHA_ADJ_FJ_MAX              1000 // Focus jumps in a stress test.
 #define MECHA_ADJ_SYNTAX_ERR "Syntax error. For help, type HELP for help.\n"
 
 static int MechaAdjInit(short int argc, char *argv[]);
@@ -81,6 +120,7 @@ static int MechaAdjAutoTilt(short int argc, char *argv[]);
 static int MechaAdjTray(short int argc, char *argv[]);
 static int MechaAdjJitter(short int argc, char *argv[]);
 static int MechaAdjGetError(short int argc, char *argv[]);
+static int MechaAdjProfile(short int argc, char *argv[]);
 
 static int MechaTestDiscControl(short int argc, char *argv[]);
 static int MechaTestLaserControl(short int argc, char *argv[]);
@@ -264,7 +304,8 @@ static const struct MechaDiagCommand AdjCommands[] = {
                             "\t\t1\t- 1x mode\n"
                             "\t\t2\t- 2x mode\n"
                             "\t\t3\t- 1.6x-4x mode\n"
-                            "\t\tFJ\t- Focus Jump (DVD-DL only)",
+                            "\t\tFJ\t- Focus Jump (DVD-DL only)\n"
+                            "\t\tFJ <n>\t- Focus Jump n times (1-1000), with the latency and layer lock of each jump",
      &MechaAdjPlay},
     {"STOP", "STOP", "Stops play mode.", &MechaAdjStop},
     {"PAUSE", "PAUSE", "Pauses play mode.", &MechaAdjPause},
@@ -287,6 +328,14 @@ static const struct MechaDiagCommand AdjCommands[] = {
                        "\tDVD\t- Gets DVD error rate measurement.\n"
                        "\tCD\t- Gets CD error rate measurement.\n",
      &MechaAdjGetError},
+    {"PROFILE", "PROFILE <mode> [<dwell> [<samples> [<file>]]]", "Plays at every speed of the disc in turn and samples jitter and errors at each speed. Modes:\n"
+                                                             "\tCD\t- CD (C1/C2 errors).\n"
+                                                             "\tDVD-SL\t- DVD-SL (PI/PO errors).\n"
+                                                             "\tDVD-DL\t- DVD-DL (PI/PO errors).\n"
+                                                             "Initialization is done first, unless it was already done for the mode.\n"
+                                                             "Each speed is held for <dwell> ms (default: 2000) before <samples> samples (default: 4) are taken.\n"
+                                                             "The table is also appended to <file> in CSV format, if specified.",
+     &MechaAdjProfile},
     {"HELP", "HELP", "Displays this help message.\nType HELP <command> to get help on specific commands.\n"
                      "Entering a blank line will cause the previous command entered to be executed.",
      &MechaAdjHelp},
@@ -538,13 +587,84 @@ static int MechaAdjInit(short int argc, char *argv[])
     return 0;
 }
 
+static int MechaAdjCompareLatency(const void *a, const void *b)
+{
+    u32 x = *(const u32 *)a, y = *(const u32 *)b;
+
+    return x < y ? -1 : (x > y);
+}
+
+/*  Focus-jump stress test: jumps between L0 and L1 the specified number of times, from the layer that is in focus
+    (as tracked by FocusLayer, so that the jitter of each layer is attributed correctly). Each jump is timed (round trip of
+    the FOCUS JUMP command) and followed by the FE loop gain (0x08-0x60) and jitter (256), which show whether focus
+    was locked on the new layer. */
+static int MechaAdjFocusJumpStress(unsigned short int count)
+{
+    static u32 latency[MECHA_ADJ_FJ_MAX];
+    u32 JitterSum[2], JitterCount[2], gain, jitter;
+    unsigned short int i, jumps, JumpFailed, LockFailed;
+    unsigned char layer;
+    char buffer[8];
+    int result;
+    u64 start;
+
+    JitterSum[0] = JitterSum[1] = JitterCount[0] = JitterCount[1] = 0;
+    layer = FocusLayer;
+    for (i = 0, jumps = 0, JumpFailed = 0, LockFailed = 0, result = 0; i < count; i++)
+    {
+        start  = PlatGetTime();
+        result = MechaCommandExecute(MECHA_CMD_FOCUS_JUMP, 2000, "0300", buffer, sizeof(buffer));
+        if (result == -ECANCELED)
+            break;
+        if (result < 0 || strtoul(buffer, NULL, 16) != 0)
+        {
+            PlatShowMessage("Focus jump %u: error %d\n", i + 1, result < 0 ? result : (int)strtoul(buffer, NULL, 16));
+            JumpFailed++;
+            continue;
+        }
+        latency[jumps++] = (u32)((PlatGetTime() - start) / 1000);
+        layer ^= 1;
+        FocusLayer = layer;
+
+        if ((result = MechaCommandExecute(MECHA_CMD_GAIN, 2000, "13", buffer, sizeof(buffer))) == -ECANCELED)
+            break;
+        gain = (result >= 0 && buffer[0] == '0') ? (u32)strtoul(&buffer[1], NULL, 16) : 0;
+        if ((result = MechaCommandExecute(MECHA_CMD_JITTER, 2000, "01", buffer, sizeof(buffer))) == -ECANCELED)
+            break;
+        if (result < 0 || buffer[0] != '0' || gain < 0x08 || gain > 0x60)
+        {
+            PlatShowMessage("Focus jump %u: no lock on L%u (FE loop gain %#x)\n", i + 1, layer, gain);
+            LockFailed++;
+            continue;
+        }
+        jitter = (u32)strtoul(&buffer[1], NULL, 16);
+        JitterSum[layer] += jitter;
+        JitterCount[layer]++;
+    }
+
+    PlatShowMessage("Focus jumps: %u of %u, %u failed, %u without lock on the new layer. Success rate: %.1f%%\n",
+                    i, count, JumpFailed, LockFailed, i > 0 ? (i - JumpFailed - LockFailed) * 100.0 / i : 0.0);
+    if (jumps > 0)
+    {
+        qsort(latency, jumps, sizeof(latency[0]), &MechaAdjCompareLatency);
+        PlatShowMessage("Jump latency (ms): min %.1f, median %.1f, 90%% %.1f, 99%% %.1f, max %.1f\n",
+                        latency[0] / 1000.0, latency[jumps / 2] / 1000.0, latency[jumps * 9 / 10] / 1000.0,
+                        latency[jumps * 99 / 100] / 1000.0, latency[jumps - 1] / 1000.0);
+    }
+    PlatShowMessage("Mean jitter (256): L0 %04x, L1 %04x\n", JitterCount[0] > 0 ? JitterSum[0] / JitterCount[0] : 0,
+                    JitterCount[1] > 0 ? JitterSum[1] / JitterCount[1] : 0);
+    PlatShowMessage("Focus is now on L%u.\n", layer);
+
+    return 0;
+}
+
 static int MechaAdjPlay(short int argc, char *argv[])
 {
+    const struct MechaAdjSpeed *speeds;
     char buffer[8];
-    u16 command, timeout;
-    int speed, result;
+    int count, speed, result;
 
-    if (argc == 2)
+    if (argc == 2 || (argc == 3 && !pstricmp(argv[1], "FJ")))
     {
         switch (status)
         {
@@ -557,8 +677,18 @@ static int MechaAdjPlay(short int argc, char *argv[])
             case MECHA_ADJ_STATE_DVDDL_1p64:
                 if (!pstricmp(argv[1], "FJ"))
                 {
-                    if ((result = MechaCommandExecute(MECHA_CMD_FOCUS_JUMP, 2000, "0300", buffer, sizeof(buffer))) < 0 || (result = strtoul(buffer, NULL, 16)) != 0)
+                    if (argc == 3)
+                    {
+                        count = (int)strtol(argv[2], NULL, 0);
+                        if (count < 1 || count > MECHA_ADJ_FJ_MAX)
+                            PlatShowMessage("The number of focus jumps must be 1-%d.\n", MECHA_ADJ_FJ_MAX);
+                        else
+                            MechaAdjFocusJumpStress((unsigned short int)count);
+                    }
+                    else if ((result = MechaCommandExecute(MECHA_CMD_FOCUS_JUMP, 2000, "0300", buffer, sizeof(buffer))) < 0 || (result = strtoul(buffer, NULL, 16)) != 0)
                         PlatShowMessage("Error %d\n", result);
+                    else
+                        FocusLayer ^= 1;
                 }
                 break;
             case MECHA_ADJ_STATE_DVDSL_PAUSE:
@@ -574,81 +704,26 @@ static int MechaAdjPlay(short int argc, char *argv[])
                 PlatShowMessage("Please STOP the drive. It is currently in PLAY mode.\n");
                 break;
             case MECHA_ADJ_STATE_CD:
-                speed = (int)strtol(argv[1], NULL, 0);
-
-                switch (speed)
-                {
-                    case 1:
-                        timeout = 3000;
-                        command = MECHA_CMD_CD_PLAY_1;
-                        break;
-                    case 2:
-                        timeout = 3000;
-                        command = MECHA_CMD_CD_PLAY_2;
-                        break;
-                    case 3:
-                        timeout = 3000;
-                        command = MECHA_CMD_CD_PLAY_3;
-                        break;
-                    case 4:
-                        timeout = 4000;
-                        command = MECHA_CMD_CD_PLAY_4;
-                        break;
-                    case 5:
-                        timeout = 3000;
-                        command = MECHA_CMD_CD_PLAY_5;
-                        break;
-                    default:
-                        PlatShowMessage("Unsupported speed.\n");
-                        timeout = 0;
-                        command = 0;
-                        break;
-                }
-
-                if (command != 0)
-                {
-                    if ((result = MechaCommandExecute(command, timeout, NULL, buffer, sizeof(buffer))) < 0 || (result = strtoul(buffer, NULL, 16)) != 0)
-                        PlatShowMessage("Error %d\n", result);
-                    else
-                        status += speed;
-
-                    SledIsAtHome = 0;
-                }
-                break;
             case MECHA_ADJ_STATE_DVDSL:
             case MECHA_ADJ_STATE_DVDDL:
-                speed = (int)strtol(argv[1], NULL, 0);
+                speeds = status == MECHA_ADJ_STATE_CD ? CdSpeeds : DvdSpeeds;
+                count  = status == MECHA_ADJ_STATE_CD ? MECHA_ADJ_CD_SPEEDS : MECHA_ADJ_DVD_SPEEDS;
+                speed  = (int)strtol(argv[1], NULL, 0);
 
-                switch (speed)
+                if (speed >= 1 && speed <= count)
                 {
-                    case 1:
-                        timeout = 5000;
-                        command = MECHA_CMD_DVD_PLAY_1;
-                        break;
-                    case 2:
-                        timeout = 5000;
-                        command = MECHA_CMD_DVD_PLAY_2;
-                        break;
-                    case 3:
-                        timeout = 5000;
-                        command = MECHA_CMD_DVD_PLAY_3;
-                        break;
-                    default:
-                        PlatShowMessage("Unsupported speed.\n");
-                        timeout = 0;
-                        command = 0;
-                        break;
-                }
-
-                if (command != 0)
-                {
-                    if ((result = MechaCommandExecute(command, timeout, NULL, buffer, sizeof(buffer))) < 0 || (result = strtoul(buffer, NULL, 16)) != 0)
+                    if ((result = MechaCommandExecute(speeds[speed - 1].command, speeds[speed - 1].timeout, NULL, buffer, sizeof(buffer))) < 0 || (result = strtoul(buffer, NULL, 16)) != 0)
                         PlatShowMessage("Error %d\n", result);
                     else
+                    {
                         status += speed;
+                        FocusLayer = 0;
+                    }
 
                     SledIsAtHome = 0;
                 }
+                else
+                    PlatShowMessage("Unsupported speed.\n");
                 break;
         }
     }
@@ -972,6 +1047,203 @@ static int MechaAdjGetError(short int argc, char *argv[])
     return 0;
 }
 
+// Waits, then takes one sample of the errors and the jitter (256) at the speed that is being played.
+static int MechaAdjProfileSample(int IsDVD, unsigned short int wait, struct MechaAdjProfileRow *row)
+{
+    char buffer[8];
+    u32 jitter, errors, fatal;
+    int result;
+
+    MechaCommandAdd(MECHA_TASK_UI_CMD_WAIT, NULL, MECHA_TASK_ID_UI, 0, wait, "PROFILE WAIT");
+    if (IsDVD)
+        MechaCommandAdd(MECHA_CMD_DSP_ERROR_RATE, "00", 1, MECHA_CMD_TAG_MECHA_DVD_ERROR_RATE, 2000, "DVD GET DSP ERROR RATE");
+    else
+        MechaCommandAdd(MECHA_CMD_CD_ERROR, "00", 1, MECHA_CMD_TAG_MECHA_CD_ERROR_RATE, 2000, "CD GET DSP ERROR RATE");
+    if ((result = MechaCommandExecuteList(&MechaAdjTxHandler, &MechaAdjRxHandler)) != 0)
+        return result;
+
+    if ((result = MechaCommandExecute(MECHA_CMD_JITTER, 2000, "01", buffer, sizeof(buffer))) < 0)
+        return result;
+    if (buffer[0] != '0')
+        return -EIO;
+
+    jitter = strtoul(&buffer[1], NULL, 16);
+    if (IsDVD)
+    {
+        errors = DvdError.PICorrect + DvdError.POCorrect;
+        fatal  = DvdError.PINCorrect;
+    }
+    else
+    {
+        errors = CdError.c1;
+        fatal  = CdError.c2;
+    }
+
+    row->samples++;
+    row->JitterSum += jitter;
+    row->ErrorSum += errors;
+    if (jitter > row->JitterMax)
+        row->JitterMax = jitter;
+    if (errors > row->ErrorMax)
+        row->ErrorMax = errors;
+    if (fatal > row->FatalMax)
+        row->FatalMax = fatal;
+
+    return 0;
+}
+
+static const char *MechaAdjProfileResult(const struct MechaAdjProfileRow *row, unsigned short int samples)
+{
+    if (row->result != 0)
+        return "no play";
+    if (row->samples < samples)
+        return "no data";
+
+    return row->FatalMax == 0 ? "clean" : "errors";
+}
+
+static void MechaAdjProfileShow(const struct MechaAdjProfileRow *rows, int count, int IsDVD, unsigned short int samples)
+{
+    const struct MechaAdjProfileRow *row, *best;
+    int i;
+
+    PlatShowMessage("Speed\tPlay\tSamples\tJitter avg/max\t%s\t%s\tResult\n", IsDVD ? "PI+PO avg/max" : "C1 avg/max", IsDVD ? "PI NC max" : "C2 max");
+    for (i = 0, best = NULL, row = rows; i < count && row->speed != NULL; i++, row++)
+    {
+        if (row->result != 0)
+            PlatShowMessage("%s\tError %d\n", row->speed->name, row->result);
+        else if (row->samples == 0)
+            PlatShowMessage("%s\tOK\t0\t-\t\t-\t\t-\t\t%s\n", row->speed->name, MechaAdjProfileResult(row, samples));
+        else
+            PlatShowMessage("%s\tOK\t%u\t%04x/%04x\t%u/%u\t\t%u\t\t%s\n", row->speed->name, row->samples,
+                            row->JitterSum / row->samples, row->JitterMax, row->ErrorSum / row->samples, row->ErrorMax,
+                            row->FatalMax, MechaAdjProfileResult(row, samples));
+
+        if (!strcmp(MechaAdjProfileResult(row, samples), "clean"))
+            best = row;
+    }
+    PlatShowMessage("Highest clean speed: %s\n", best != NULL ? best->speed->name : "none");
+}
+
+static int MechaAdjProfileSave(const char *output, const struct MechaAdjProfileRow *rows, int count, const char *mode, u32 serial,
+                               unsigned short int dwell, unsigned short int samples)
+{
+    const struct MechaAdjProfileRow *row;
+    FILE *file;
+    int i;
+
+    if ((file = fopen(output, "a")) == NULL)
+    {
+        PlatShowMessage("Cannot open %s.\n", output);
+        return -EIO;
+    }
+
+    fseek(file, 0, SEEK_END);
+    if (ftell(file) == 0)
+        fprintf(file, "serial,mechacon,mode,speed,dwell,play,samples,jitter_avg,jitter_max,errors_avg,errors_max,fatal_max,result\n");
+    for (i = 0, row = rows; i < count && row->speed != NULL; i++, row++)
+    {
+        fprintf(file, "%07u,%s,%s,%s,%u,%d,%u,", serial, MechaGetDesc(), mode, row->speed->name, dwell, row->result, row->samples);
+        if (row->samples > 0)
+            fprintf(file, "%u,%u,%u,%u,%u,", row->JitterSum / row->samples, row->JitterMax, row->ErrorSum / row->samples, row->ErrorMax, row->FatalMax);
+        else
+            fprintf(file, ",,,,,");
+        fprintf(file, "%s\n", MechaAdjProfileResult(row, samples));
+    }
+    fclose(file);
+
+    return 0;
+}
+
+/*  Speed-capability profile: every speed of the disc is played in turn and held for the dwell time, before its samples
+    are taken. A speed is clean if it could be played and none of its samples had uncorrectable errors
+    (C2 for a CD, PI non-correctable for a DVD). The drive is stopped between speeds, as PLAY requires. */
+static int MechaAdjProfile(short int argc, char *argv[])
+{
+    struct MechaAdjProfileRow rows[MECHA_ADJ_CD_SPEEDS], *row;
+    const struct MechaAdjSpeed *speeds;
+    unsigned short int dwell, samples, i;
+    unsigned char base;
+    char buffer[8], *init[2];
+    int count, sample, IsDVD, result;
+    u32 serial;
+    u8 emcs;
+
+    if (argc < 2)
+        return -EINVAL;
+
+    if (!pstricmp(argv[1], "CD"))
+        base = MECHA_ADJ_STATE_CD;
+    else if (!pstricmp(argv[1], "DVD-SL"))
+        base = MECHA_ADJ_STATE_DVDSL;
+    else if (!pstricmp(argv[1], "DVD-DL"))
+        base = MECHA_ADJ_STATE_DVDDL;
+    else
+        return -EINVAL;
+
+    dwell   = argc >= 3 ? (unsigned short int)strtoul(argv[2], NULL, 0) : MECHA_ADJ_PROFILE_DWELL;
+    samples = argc >= 4 ? (unsigned short int)strtoul(argv[3], NULL, 0) : MECHA_ADJ_PROFILE_SAMPLES;
+    if (samples < 1 || samples > MECHA_ADJ_PROFILE_SAMPLES_MAX)
+    {
+        PlatShowMessage("The number of samples must be 1-%d.\n", MECHA_ADJ_PROFILE_SAMPLES_MAX);
+        return 0;
+    }
+
+    if (status != base)
+    {
+        if (status != MECHA_ADJ_STATE_NONE && status != MECHA_ADJ_STATE_CD && status != MECHA_ADJ_STATE_DVDSL && status != MECHA_ADJ_STATE_DVDDL)
+        {
+            PlatShowMessage("Please STOP the drive first! Currently in another PLAY mode.\n");
+            return 0;
+        }
+
+        init[0] = "INIT";
+        init[1] = argv[1];
+        MechaAdjInit(2, init);
+        if (status != base)
+            return 0;
+    }
+
+    serial = 0;
+    if (EEPROMInitSerial() == 0)
+        EEPROMGetSerial(&serial, &emcs);
+
+    IsDVD  = base != MECHA_ADJ_STATE_CD;
+    speeds = IsDVD ? DvdSpeeds : CdSpeeds;
+    count  = IsDVD ? MECHA_ADJ_DVD_SPEEDS : MECHA_ADJ_CD_SPEEDS;
+    memset(rows, 0, sizeof(rows));
+    for (i = 0, result = 0, row = rows; i < count && result != -ECANCELED; i++, row++)
+    {
+        row->speed = &speeds[i];
+        PlatShowMessage("PLAY %s\n", row->speed->name);
+        if ((result = MechaCommandExecute(row->speed->command, row->speed->timeout, NULL, buffer, sizeof(buffer))) < 0 || (result = strtoul(buffer, NULL, 16)) != 0)
+        {
+            row->result = result;
+            continue;
+        }
+        status       = base + i + 1;
+        SledIsAtHome = 0;
+
+        for (sample = 0; sample < samples; sample++)
+        {
+            if ((result = MechaAdjProfileSample(IsDVD, sample == 0 ? dwell : MECHA_ADJ_PROFILE_GAP, row)) == -ECANCELED)
+                break;
+        }
+
+        // On cancellation, the drive was already stopped.
+        if (result != -ECANCELED && ((result = MechaCommandExecute(IsDVD ? MECHA_CMD_DVD_STOP : MECHA_CMD_CD_STOP, IsDVD ? 5000 : 4000, NULL, buffer, sizeof(buffer))) < 0 || (result = strtoul(buffer, NULL, 16)) != 0))
+            PlatShowMessage("Error %d\n", result);
+        status = result != -ECANCELED ? base : MECHA_ADJ_STATE_NONE;
+    }
+
+    PlatShowMessage("\nSpeed profile of %07u (%s), %s, %ums dwell, %u samples:\n", serial, MechaGetDesc(), argv[1], dwell, samples);
+    MechaAdjProfileShow(rows, count, IsDVD, samples);
+    if (argc >= 5)
+        MechaAdjProfileSave(argv[4], rows, count, argv[1], serial, dwell, samples);
+
+    return 0;
+}
+
 static int MechaAdjSled(short int argc, char *argv[])
 {
     int result;
@@ -1346,6 +1618,7 @@ static int MechaTestPlay(short int argc, char *argv[])
                         PlatShowMessage("Failed to execute.\n");
                     else
                     {
+                        FocusLayer = 0;
                         switch (DiscDetect)
                         {
                             case DISC_TYPE_DVDS12:
@@ -1513,6 +1786,8 @@ static int MechaTestPlay(short int argc, char *argv[])
                     MechaCommandAdd(MECHA_CMD_FOCUS_JUMP, "0205", id++, 0, 2000, "DVD-DL FOCUS JUMP");
                     if (MechaCommandExecuteList(&MechaAdjTxHandler, &MechaAdjRxHandler) != 0)
                         PlatShowMessage("Failed to execute.\n");
+                    else
+                        FocusLayer ^= 1;
                 }
                 else
                     PlatShowMessage("Not in PLAY mode.\n");
@@ -1575,6 +1850,13 @@ static int MechaTestSpindle(short int argc, char *argv[])
     return 0;
 }
 
+static void MechaAdjResetState(void)
+{
+    status       = MECHA_ADJ_STATE_NONE;
+    SledIsAtHome = 0;
+    FocusLayer   = 0;
+}
+
 static void MechaCommonMain(const struct MechaDiagCommand *commands, char prompt)
 {
     int result;
@@ -1584,17 +1866,18 @@ static void MechaCommonMain(const struct MechaDiagCommand *commands, char prompt
     char input[128], previous[128], *argv[MECHA_ADJ_MAX_ARGS], *pTok;
 
     MechaGetMode(&tm, &md);
-    status       = MECHA_ADJ_STATE_NONE;
-    StepAmount   = 100;
-    SledIsAtHome = 0;
-    DiscDetect   = 0xFF;
-    done         = 0;
-    previous[0]  = '\0';
+    MechaAdjResetState();
+    StepAmount  = 100;
+    DiscDetect  = 0xFF;
+    done        = 0;
+    previous[0] = '\0';
     do
     {
         PlatShowMessage("MD1.%d %c> ", md, prompt);
+        SessionWaitBegin("MECHA command line");
         if (fgets(input, sizeof(input), stdin))
         {
+            SessionWaitEnd();
             input[strlen(input) - 1] = '\0';
             if (input[0] != '\0')
                 strcpy(previous, input);
@@ -1629,6 +1912,18 @@ static void MechaCommonMain(const struct MechaDiagCommand *commands, char prompt
             else
                 PlatShowMessage("Unrecognized command. For help, type HELP.\n");
         }
+        else
+        {
+            SessionWaitEnd();
+            clearerr(stdin); // Interrupted by Ctrl-C.
+        }
+
+        // Ctrl-C at this prompt, with the drive running: it is stopped here and PMAP exits.
+        if (MechaCancelStop())
+            done = 1;
+        // The drive was stopped by a cancellation, so the mode set with INIT and PLAY no longer applies.
+        if (MechaWasCancelled())
+            MechaAdjResetState();
     } while (!done);
 }
 
@@ -1648,10 +1943,12 @@ static int MechaAdjPromptT10K(void)
     do
     {
         PlatShowMessage("Is this a DTL-T10000? [y,n] ");
+        SessionWaitBegin("DTL-T10000?");
         input = getchar();
         while (getchar() != '\n')
         {
         };
+        SessionWaitEnd();
     } while (input != 'y' && input != 'n');
 
     return (input == 'y');
@@ -1684,10 +1981,12 @@ void MenuMECHA(void)
                         "Warning! This process MAY damage the laser if the wrong type of disc is used!\n"
                         "\nContinue with MECHA adjustment? [y/n]");
 
+        SessionWaitBegin("Start MECHA adjustment?");
         choice = getchar();
         while (getchar() != '\n')
         {
         };
+        SessionWaitEnd();
     } while (choice != 'y' && choice != 'n');
 
     if (choice == 'y')
@@ -1705,10 +2004,14 @@ void MenuMECHA(void)
                                 "\t3. Quit\n"
                                 "Your choice: ");
                 input = 0;
+                SessionWaitBegin("MECHA menu");
                 if (scanf("%d", &input) > 0)
                     while (getchar() != '\n')
                     {
                     };
+                SessionWaitEnd();
+                if (MechaCancelStop())
+                    input = 3;
             } while (input < 1 || input > 3);
 
             switch (input)
@@ -1723,6 +2026,6 @@ void MenuMECHA(void)
                     done = 1;
                     break;
             }
-        } while (!done);
+        } while (!done && !MechaIsExitRequested());
     }
 }
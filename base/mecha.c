@@ -5,10 +5,17 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <signal.h>
 
 #include "platform.h"
+#include "log.h"
 #include "mecha.h"
 #include "eeprom.h"
+#include "session.h"
+#include "trace.h"
+#include "latency.h"
+#include "watch.h"
+#include "updates.h"
 
 static struct MechaTask tasks[MAX_MECHA_TASKS];
 static unsigned char TaskCount = 0;
@@ -16,6 +23,50 @@ char MechaName[9], RTCData[19];
 struct MechaIdentRaw MechaIdentRaw;
 unsigned char ConMD, ConType, ConTM, ConCEXDEX, ConOP, ConLens, ConRTC, ConRTCStat, ConECR, ConChecksumStat, ConSlim;
 
+static const MechaTransport_t SerialTransport = {&PlatReadCOMPort, &PlatWriteCOMPort, NULL, 0, 0, &PlatGetCOMPortTimes};
+static const MechaTransport_t *transport      = &SerialTransport;
+
+// What the drive was last told to do, for the safe-stop sequence.
+#define MECHA_STATE_PLAY_CD  0x01
+#define MECHA_STATE_PLAY_DVD 0x02
+#define MECHA_STATE_FOCUS    0x04
+#define MECHA_STATE_LASER    0x08
+#define MECHA_STATE_SLED     0x10
+#define MECHA_STATE_SERVO    (MECHA_STATE_FOCUS | MECHA_STATE_LASER | MECHA_STATE_SLED)
+
+struct MechaStopStep
+{
+    unsigned char state;
+    unsigned short int command, timeout;
+    const char *args, *label;
+};
+
+static const struct MechaStopStep MechaStopSequence[] = {
+    {MECHA_STATE_PLAY_CD, MECHA_CMD_CD_STOP, 20000, NULL, "CD STOP"},
+    {MECHA_STATE_PLAY_DVD, MECHA_CMD_DVD_STOP, 20000, NULL, "DVD STOP"},
+    {MECHA_STATE_FOCUS, MECHA_CMD_FOCUS_UPDOWN, 3000, "00", "FOCUS UP/DOWN STOP"},
+    {MECHA_STATE_LASER, MECHA_CMD_LASER_DIODE, 3000, "00", "LD OFF"},
+    {MECHA_STATE_SLED, MECHA_CMD_SLED_POS_HOME, 3000, NULL, "SLED HOME POSITION"},
+    {0, 0, 0, NULL, NULL}};
+
+static unsigned char MechaState = 0, MechaStopping = 0;
+
+// Commands that were sent, but whose responses were not read yet (oldest first).
+struct MechaPending
+{
+    const MechaTransport_t *link;
+    unsigned short int command;
+    char cmd[MECHA_TX_BUFFER_SIZE];
+    u64 start, sent;
+};
+
+static struct MechaPending pending[MECHA_PIPELINE_MAX];
+static unsigned char PendingHead = 0, PendingCount = 0;
+static unsigned int InFlightBytes = 0;
+static u64 LastReceived = 0;
+static volatile sig_atomic_t MechaBusy = 0, MechaCancelRequested = 0, MechaExitRequested = 0;
+static unsigned char MechaCancelled = 0;
+
 int is_valid_data(const char *data, int size)
 {
     // Validate the received data
@@ -29,6 +80,166 @@ int is_valid_data(const char *data, int size)
     return 1;
 }
 
+void MechaSetTransport(const MechaTransport_t *NewTransport)
+{
+    transport = (NewTransport != NULL) ? NewTransport : &SerialTransport;
+}
+
+const MechaTransport_t *MechaGetTransport(void)
+{
+    return transport;
+}
+
+/*  Called on Ctrl-C, possibly from a signal handler: only sets a flag, which the command engine checks between commands.
+    When no command is running or posted but the drive is still running (i.e. after PLAY at the MECHA command line),
+    the exit is deferred: the prompt stops the drive (see MechaCancelStop()) and PMAP then exits from its main menu.
+    Returns 0 if the program is to be terminated now: the drive is idle, it is already being stopped, or Ctrl-C was
+    pressed again before the exit. */
+int MechaCancel(void)
+{
+    if (MechaStopping)
+        return 0;
+
+    if (MechaBusy == 0 && PendingCount == 0)
+    {
+        if (MechaState == 0 || MechaExitRequested)
+            return 0;
+        MechaExitRequested = 1;
+    }
+
+    MechaCancelRequested = 1;
+    return 1;
+}
+
+static void MechaTrackState(unsigned short int command, const char *args)
+{
+    int off;
+
+    off = (args != NULL && !strcmp(args, "00"));
+    switch (command)
+    {
+        case MECHA_CMD_CD_PLAY_1:
+        case MECHA_CMD_CD_PLAY_2:
+        case MECHA_CMD_CD_PLAY_3:
+        case MECHA_CMD_CD_PLAY_4:
+        case MECHA_CMD_CD_PLAY_5:
+            MechaState |= MECHA_STATE_PLAY_CD | MECHA_STATE_SERVO;
+            break;
+        case MECHA_CMD_DVD_PLAY_1:
+        case MECHA_CMD_DVD_PLAY_2:
+        case MECHA_CMD_DVD_PLAY_3:
+            MechaState |= MECHA_STATE_PLAY_DVD | MECHA_STATE_SERVO;
+            break;
+        case MECHA_CMD_CD_STOP:
+            MechaState &= ~MECHA_STATE_PLAY_CD;
+            break;
+        case MECHA_CMD_DVD_STOP:
+            MechaState &= ~MECHA_STATE_PLAY_DVD;
+            break;
+        case MECHA_CMD_FOCUS_UPDOWN:
+            if (off)
+                MechaState &= ~(MECHA_STATE_FOCUS | MECHA_STATE_PLAY_CD | MECHA_STATE_PLAY_DVD);
+            else
+                MechaState |= MECHA_STATE_FOCUS | MECHA_STATE_LASER;
+            break;
+        case MECHA_CMD_FOCUS_AUTO_START:
+            MechaState |= MECHA_STATE_FOCUS | MECHA_STATE_LASER;
+            break;
+        case MECHA_CMD_FOCUS_AUTO_STOP:
+            MechaState &= ~MECHA_STATE_FOCUS;
+            break;
+        case MECHA_CMD_LASER_DIODE:
+            if (off)
+                MechaState &= ~MECHA_STATE_LASER;
+            else
+                MechaState |= MECHA_STATE_LASER;
+            break;
+        case MECHA_CMD_SLED_CTL_MICRO:
+        case MECHA_CMD_SLED_CTL_BIPHS:
+        case MECHA_CMD_SLED_CTL_POS:
+            MechaState |= MECHA_STATE_SLED;
+            break;
+        case MECHA_CMD_SLED_POS_HOME:
+            MechaState &= ~MECHA_STATE_SLED;
+            break;
+        // Adjustments and servo commands leave the laser and focus on, and may move the sled.
+        case MECHA_CMD_TRACKING:
+        case MECHA_CMD_SP_CTL:
+        case MECHA_CMD_SP_CLV_S:
+        case MECHA_CMD_SP_CLV_A:
+        case MECHA_CMD_DETECT_ADJ:
+        case MECHA_CMD_AUTO_ADJ_ST_1:
+        case MECHA_CMD_AUTO_ADJ_ST_2:
+        case MECHA_CMD_AUTO_ADJ_ST_12:
+        case MECHA_CMD_AUTO_ADJ_ST_2MD:
+        case MECHA_CMD_AUTO_ADJ_FIX_GAIN:
+        case MECHA_CMD_CD_TRACK_CTL:
+        case MECHA_CMD_CD_TRACK_LONG_CTL:
+        case MECHA_CMD_DVD_TRACK_CTL:
+        case MECHA_CMD_DVD_TRACK_LONG_CTL:
+        case MECHA_CMD_FOCUS_JUMP:
+        case MECHA_CMD_FOCUS_JUMP_NEW:
+        case MECHA_CMD_ADJ_AUTO_TILT:
+        case MECHA_CMD_INIT_AUTO_TILT:
+        case MECHA_CMD_MOV_AUTO_TILT:
+            MechaState |= MECHA_STATE_SERVO;
+            break;
+    }
+}
+
+/*  If cancellation was requested, stops whatever the drive was doing (play, focus, laser and sled, in that order),
+    so that the console can be used again without a power cycle. Returns 1 if the running job must end. */
+static int MechaCancelPending(void)
+{
+    const struct MechaStopStep *step;
+    char buffer[16];
+
+    if (!MechaCancelRequested || MechaStopping)
+        return 0;
+
+    MechaCancelRequested = 0;
+    MechaStopping        = 1;
+    PlatShowMessage("\nCancelled.\n");
+    for (step = MechaStopSequence; step->label != NULL; step++)
+    {
+        if (MechaState & step->state)
+        {
+            PlatShowMessage("%s\n", step->label);
+            MechaCommandExecute(step->command, step->timeout, step->args, buffer, sizeof(buffer));
+        }
+    }
+    MechaState     = 0;
+    MechaStopping  = 0;
+    MechaCancelled = 1;
+    TaskCount      = 0;
+
+    return 1;
+}
+
+// For prompts, once their input ends (i.e. was interrupted): stops the drive if Ctrl-C was pressed. Returns 1 if PMAP must exit.
+int MechaCancelStop(void)
+{
+    MechaCancelPending();
+
+    return MechaExitRequested;
+}
+
+int MechaIsExitRequested(void)
+{
+    return MechaExitRequested;
+}
+
+// Returns 1 once after a job was cancelled and the drive stopped, so that the state kept by the UI can be reset.
+int MechaWasCancelled(void)
+{
+    int result;
+
+    result         = MechaCancelled;
+    MechaCancelled = 0;
+
+    return result;
+}
+
 int MechaCommandAdd(unsigned short int command, const char *args, unsigned char id, unsigned char tag, unsigned short int timeout, const char *label)
 {
     struct MechaTask *task;
@@ -59,66 +270,238 @@ int MechaCommandAdd(unsigned short int command, const char *args, unsigned char
     return result;
 }
 
-int MechaCommandExecute(unsigned short int command, unsigned short int timeout, const char *args, char *buffer, unsigned char BufferSize)
+// Consoles on COM ports other than the first are reached by selecting their port around each transfer.
+static int MechaLinkWrite(const MechaTransport_t *link, const char *data)
 {
-    char cmd[MECHA_TX_BUFFER_SIZE];
-    unsigned short int size;
-    int result = 0;
+    int result;
+
+    if (link->port != 0)
+        PlatSelectCOMPort(link->port);
+    result = link->write(data);
+    if (link->port != 0)
+        PlatSelectCOMPort(0);
 
+    return result;
+}
+
+static int MechaLinkRead(const MechaTransport_t *link, char *data, int n, unsigned short timeout)
+{
+    int result;
+
+    if (link->port != 0)
+        PlatSelectCOMPort(link->port);
+    result = link->read(data, n, timeout);
+    if (link->port != 0)
+        PlatSelectCOMPort(0);
+
+    return result;
+}
+
+// Replaces the times taken by the engine with those of the transport (i.e. taken by the RT I/O thread), if it has them.
+static void MechaLinkTimes(const MechaTransport_t *link, u64 *WriteStart, u64 *WriteEnd, u64 *ReadTime)
+{
+    if (link->times == NULL)
+        return;
+
+    if (link->port != 0)
+        PlatSelectCOMPort(link->port);
+    link->times(WriteStart, WriteEnd, ReadTime);
+    if (link->port != 0)
+        PlatSelectCOMPort(0);
+}
+
+static int MechaCommandSend(const MechaTransport_t *link, unsigned short int command, const char *args)
+{
+    struct MechaPending *p;
+    unsigned int len;
+
+    if (PendingCount >= MECHA_PIPELINE_MAX)
+        return -ENOBUFS;
+
+    p = &pending[(PendingHead + PendingCount) % MECHA_PIPELINE_MAX];
     if (args != NULL)
-        snprintf(cmd, sizeof(cmd), "%03x%s\r\n", command, args);
+        snprintf(p->cmd, sizeof(p->cmd), "%03x%s\r\n", command, args);
     else
-        snprintf(cmd, sizeof(cmd), "%03x\r\n", command);
+        snprintf(p->cmd, sizeof(p->cmd), "%03x\r\n", command);
+    p->link    = link;
+    p->command = command;
+    len        = (unsigned int)strlen(p->cmd);
 
-    PlatDPrintf("PlatWriteCOMPort: %s", cmd);
+    LogPrintf(LOG_WIRE, LOG_DEBUG, "PlatWriteCOMPort: %s", p->cmd);
 
-    if (PlatWriteCOMPort(cmd) == strlen(cmd))
+    SessionBusyBegin();
+    p->start = PlatGetTime();
+    TraceChromeCounter("In flight", p->start, InFlightBytes + len);
+    if (MechaLinkWrite(link, p->cmd) != len)
     {
-        for (size = 0; size < BufferSize - 1; size++)
+        TraceRecord(TRACE_EVENT_TX, p->start, p->cmd);
+        TraceChromeCounter("In flight", PlatGetTime(), InFlightBytes);
+        SessionBusyEnd();
+        return -EPIPE;
+    }
+    p->sent = PlatGetTime();
+    MechaLinkTimes(link, &p->start, &p->sent, NULL);
+    TraceRecord(TRACE_EVENT_TX, p->start, p->cmd);
+    TraceRingRecord(TRACE_EVENT_TX, link->port, p->start, p->cmd, len);
+    InFlightBytes += len;
+    PendingCount++;
+
+    return 0;
+}
+
+// Reads the response to the oldest command that was sent.
+static int MechaCommandReceive(unsigned short int timeout, const char *args, char *buffer, unsigned char BufferSize)
+{
+    struct MechaPending *p;
+    char SpanArgs[160], response[64];
+    unsigned short int size, RawSize;
+    int result = 0;
+    u64 begin, received, end;
+
+    if (PendingCount == 0)
+        return -EINVAL;
+    p = &pending[PendingHead];
+
+    // A command that was sent ahead of its turn is only waited for from the end of the previous one.
+    begin = received = p->sent > LastReceived ? p->sent : LastReceived;
+    for (size = 0; size < BufferSize - 1; size++)
+    {
+        if ((result = MechaLinkRead(p->link, buffer + size, 1, timeout)) > 0)
         {
-            if ((result = PlatReadCOMPort(buffer + size, 1, timeout)) > 0)
+            result = 0;
+            if (size == 0)
             {
-                result = 0;
+                received = PlatGetTime();
+                MechaLinkTimes(p->link, NULL, NULL, &received);
+            }
 
-                if ((size + 1 >= 2) && buffer[size - 1] == '\r' && buffer[size] == '\n')
-                {
-                    size--; // So that the NULL-terminator will overwrite the carriage return character, making the output perfect for functions like strcmp.
-                    break;
-                }
+            if ((size + 1 >= 2) && buffer[size - 1] == '\r' && buffer[size] == '\n')
+            {
+                size--; // So that the NULL-terminator will overwrite the carriage return character, making the output perfect for functions like strcmp.
+                break;
             }
-            else
+        }
+        else
+        {
+            if (result == 0)
             {
-                if (result == 0)
-                {
-                    result = -EPIPE;
-                    break;
-                }
+                result = -EPIPE;
+                break;
             }
         }
+    }
 
-        buffer[size] = '\0';
-        if (result == 0)
-            result = size;
-        PlatDPrintf("PlatReadCOMPort : %s\n", buffer);
+    // The bytes as received, with the CR/LF terminator if it was received, and when the last of them was received.
+    RawSize = (result == 0 && size < BufferSize - 1) ? size + 2 : size;
+    end     = PlatGetTime();
+    if (RawSize > 0)
+    {
+        MechaLinkTimes(p->link, NULL, NULL, &end);
+        TraceRingRecord(TRACE_EVENT_RX, p->link->port, end, buffer, RawSize);
     }
-    else
-        result = -EPIPE;
+
+    buffer[size] = '\0';
+    if (result == 0)
+    {
+        result = size;
+        TraceRecord(TRACE_EVENT_RX, end, buffer);
+        LatencyRecord(p->command, (unsigned int)strlen(p->cmd), size + 2, end - p->start);
+        MechaTrackState(p->command, args);
+    }
+    LogPrintf(LOG_WIRE, LOG_DEBUG, "PlatReadCOMPort : %s\n", buffer);
+
+    // TX, then the wait for the first byte of the response, then RX.
+    if (p->start >= LastReceived)
+        TraceChromeSpan(TRACE_TRACK_PORT, "TX", "io", p->start, p->sent, NULL);
+    TraceChromeSpan(TRACE_TRACK_PORT, size > 0 ? "wait" : "timeout", "io", begin, size > 0 ? received : end, NULL);
+    if (size > 0)
+        TraceChromeSpan(TRACE_TRACK_PORT, "RX", "io", received, end, NULL);
+    TraceChromeEscape(response, sizeof(response), buffer);
+    snprintf(SpanArgs, sizeof(SpanArgs), "\"command\":\"%.*s\",\"response\":\"%s\",\"result\":%d", (int)strlen(p->cmd) - 2, p->cmd, response, result);
+    LastReceived = end;
+    TraceChromeSpan(TRACE_TRACK_PORT, MechaGetCommandName(p->command), "command", p->start > begin ? p->start : begin, LastReceived, SpanArgs);
+
+    InFlightBytes -= (unsigned int)strlen(p->cmd);
+    TraceChromeCounter("In flight", LastReceived, InFlightBytes);
+    PendingHead = (PendingHead + 1) % MECHA_PIPELINE_MAX;
+    PendingCount--;
+    SessionBusyEnd();
+
+    return result;
+}
+
+// Reads (and discards) the responses to the commands that were sent ahead, which are no longer waited for.
+static void MechaCommandFlush(void)
+{
+    char buffer[MECHA_RX_BUFFER_SIZE];
+
+    while (PendingCount > 0)
+        MechaCommandReceive(MECHA_TASK_NORMAL_TO, NULL, buffer, sizeof(buffer));
+}
+
+int MechaCommandExecute(unsigned short int command, unsigned short int timeout, const char *args, char *buffer, unsigned char BufferSize)
+{
+    int result;
+
+    if (MechaCancelPending())
+        return -ECANCELED;
+
+    MechaCommandFlush();
+    MechaBusy++;
+    if ((result = MechaCommandSend(transport, command, args)) == 0)
+        result = MechaCommandReceive(timeout, args, buffer, BufferSize);
+    MechaBusy--;
 
     return result;
 }
 
+int MechaCommandPost(const MechaTransport_t *link, unsigned short int command, const char *args)
+{
+    if (MechaCancelPending())
+        return -ECANCELED;
+
+    return MechaCommandSend(link != NULL ? link : transport, command, args);
+}
+
+int MechaCommandCollect(unsigned short int timeout, char *buffer, unsigned char BufferSize)
+{
+    return MechaCommandReceive(timeout, NULL, buffer, BufferSize);
+}
+
+/*  EEPROM reads have no side effects, so the reads that follow one another in a list may be sent before the
+    response to the previous one arrives. Tasks with a transmit handler may be changed before they are sent. */
+static int MechaCommandPipelinable(const struct MechaTask *task, MechaCommandTxHandler_t transmit)
+{
+    return (transmit == NULL && task->id != MECHA_TASK_ID_UI && task->command == MECHA_CMD_EEPROM_READ);
+}
+
 int MechaCommandExecuteList(MechaCommandTxHandler_t transmit, MechaCommandRxHandler_t receive)
 {
     char RxBuffer[MECHA_RX_BUFFER_SIZE];
     struct MechaTask *task;
-    unsigned short int i;
+    const char *stage;
+    unsigned short int i, ahead;
     int result = 0, size;
+    u64 StageStart, TaskStart, start;
 
+    ahead      = 0; // Tasks before this one were already sent.
+    stage      = "Start";
+    StageStart = PlatGetTime();
+    MechaBusy++;
     for (i = 0, task = tasks; i < TaskCount; i++, task++)
     {
+        if (MechaCancelPending())
+        {
+            result = -ECANCELED;
+            break;
+        }
+
+        TaskStart = PlatGetTime();
         if (transmit != NULL)
         {
-            if ((result = transmit(task)) != 0)
+            result = transmit(task);
+            TraceChromeSpan(TRACE_TRACK_PORT, "tx handler", "handler", TaskStart, PlatGetTime(), NULL);
+            if (result != 0)
                 break;
         }
 
@@ -132,15 +515,30 @@ int MechaCommandExecuteList(MechaCommandTxHandler_t transmit, MechaCommandRxHand
                 switch (task->command)
                 {
                     case MECHA_TASK_UI_CMD_SKIP:
-                        PlatDPrintf("SKIP: %s\n", task->label);
+                        LogPrintf(LOG_ENGINE, LOG_INFO, "SKIP: %s\n", task->label);
                         result = 0;
                         break;
                     case MECHA_TASK_UI_CMD_WAIT:
-                        PlatSleep(task->timeout);
+                        SessionBusyBegin();
+                        start = PlatGetTime();
+                        // In steps, so that cancellation is not held up by the wait.
+                        while (!MechaCancelRequested && PlatGetTime() - start < task->timeout * 1000000ULL)
+                            PlatSleep(MECHA_WAIT_STEP_MS);
+                        TraceChromeSpan(TRACE_TRACK_PORT, task->label, "wait", start, PlatGetTime(), NULL);
+                        SessionBusyEnd();
                         result = 0;
                         break;
                     case MECHA_TASK_UI_CMD_MSG:
+                        TraceRecord(TRACE_EVENT_STAGE, PlatGetTime(), task->label);
+                        if (transport->prompt != NULL)
+                            transport->prompt(task->label);
+                        start = PlatGetTime();
+                        TraceChromeSpan(TRACE_TRACK_STAGE, stage, "stage", StageStart, start, NULL);
+                        SessionWaitBegin(task->label);
                         PlatShowMessageB(task->label);
+                        SessionWaitEnd();
+                        stage      = task->label;
+                        StageStart = PlatGetTime();
                         result = 0;
                         break;
                     default:
@@ -148,9 +546,39 @@ int MechaCommandExecuteList(MechaCommandTxHandler_t transmit, MechaCommandRxHand
                 }
                 break;
             default:
-                result = MechaCommandExecute(task->command, task->timeout, task->args, RxBuffer, sizeof(RxBuffer));
+                if (transport->pipeline <= 1)
+                {
+                    result = MechaCommandExecute(task->command, task->timeout, task->args, RxBuffer, sizeof(RxBuffer));
+                    break;
+                }
+
+                result = 0;
+                if (i >= ahead)
+                {
+                    result = MechaCommandSend(transport, task->command, task->args);
+                    ahead  = i + 1;
+                }
+                // Overlap the round trips of the reads that follow with this one.
+                while (result == 0 && ahead < TaskCount && PendingCount < transport->pipeline &&
+                       MechaCommandPipelinable(task, transmit) && MechaCommandPipelinable(&tasks[ahead], transmit))
+                {
+                    if (MechaCommandSend(transport, tasks[ahead].command, tasks[ahead].args) != 0)
+                        break;
+                    ahead++;
+                }
+                if (result == 0)
+                    result = MechaCommandReceive(task->timeout, task->args, RxBuffer, sizeof(RxBuffer));
+
+                if (result == -EPIPE && PendingCount > 0)
+                { // A late response would be taken for the next one: start again after this task.
+                    MechaCommandFlush();
+                    ahead = i + 1;
+                }
         }
 
+        if (result == -ECANCELED)
+            break;
+
         if (result >= 0)
         {
             size   = result;
@@ -174,10 +602,25 @@ int MechaCommandExecuteList(MechaCommandTxHandler_t transmit, MechaCommandRxHand
 
         if (receive != NULL)
         {
-            if ((result = receive(task, RxBuffer, size)) != 0)
-                break;
+            start  = PlatGetTime();
+            result = receive(task, RxBuffer, size);
+            TraceChromeSpan(TRACE_TRACK_PORT, "rx handler", "handler", start, PlatGetTime(), NULL);
         }
+        if (PendingCount == 0 && ahead > i + 1)
+            ahead = i + 1; // The handler ran a command of its own, which discarded the responses to the reads sent ahead.
+
+        if (task->id != MECHA_TASK_ID_UI)
+            TraceChromeSpan(TRACE_TRACK_PORT, task->label != NULL ? task->label : MechaGetCommandName(task->command),
+                            (task->label != NULL && strstr(task->label, "RETRY") != NULL) ? "retry" : "task", TaskStart, PlatGetTime(), NULL);
+        if (receive != NULL && result != 0)
+            break;
+
+        if (task->id != MECHA_TASK_ID_UI && PendingCount == 0)
+            WatchPoll(task->label);
     }
+    MechaCommandFlush();
+    TraceChromeSpan(TRACE_TRACK_STAGE, stage, "stage", StageStart, PlatGetTime(), NULL);
+    MechaBusy--;
 
     TaskCount = 0;
 
@@ -189,6 +632,133 @@ void MechaCommandListClear(void)
     TaskCount = 0;
 }
 
+// Allows queued tasks to be inspected without executing them.
+const MechaTask_t *MechaCommandListGet(unsigned short int *count)
+{
+    *count = TaskCount;
+    return tasks;
+}
+
+static void MechaCommandSkip(struct MechaTask *task)
+{
+    task->id      = MECHA_TASK_ID_UI;
+    task->tag     = 0;
+    task->command = MECHA_TASK_UI_CMD_SKIP;
+}
+
+/*  Removes redundant EEPROM writes from the queued tasks:
+        1. Repeated writes to the same word are collapsed, with the last write winning.
+        2. Writes of values that the word is already known to contain are dropped.
+    A read, checksum or upload is a barrier: writes queued before it are never combined with writes after it.
+    Commands that may change the EEPROM (i.e. loading defaults) also make every known value unknown.
+    Only untagged tasks are optimized, as handlers may modify tagged tasks during execution.
+    Returns the number of tasks that were removed. */
+int MechaCommandListOptimize(void)
+{
+    static u16 known[0x200];
+    static u32 KnownMap[0x200 / 32];
+    static short int pending[0x200];
+    struct MechaTask *task;
+    char value[5];
+    unsigned short int i, word;
+    u16 data;
+    int removed, barrier, invalidate;
+
+    for (word = 0; word < 0x200; word++)
+    {
+        pending[word] = -1;
+        if (EEPMapIsValid(word))
+        {
+            known[word] = EEPMapRead(word);
+            KnownMap[word / 32] |= (1 << (word % 32));
+        }
+        else
+            KnownMap[word / 32] &= ~(1 << (word % 32));
+    }
+
+    for (i = 0, task = tasks, removed = 0; i < TaskCount; i++, task++)
+    {
+        barrier    = 1;
+        invalidate = 0;
+
+        switch (task->id)
+        {
+            case MECHA_TASK_ID_UI:
+                barrier = (task->command != MECHA_TASK_UI_CMD_SKIP);
+                break;
+            default:
+                switch (task->command)
+                {
+                    case MECHA_CMD_EEPROM_WRITE:
+                        if (task->tag != 0 || strlen(task->args) != 8)
+                        {
+                            invalidate = 1;
+                            break;
+                        }
+
+                        strncpy(value, task->args, 4);
+                        value[4] = '\0';
+                        word     = (u16)strtoul(value, NULL, 16);
+                        data     = (u16)strtoul(&task->args[4], NULL, 16);
+                        if (word >= 0x200)
+                        {
+                            invalidate = 1;
+                            break;
+                        }
+
+                        barrier = 0;
+                        if (pending[word] >= 0)
+                        { // Superseded by this write.
+                            MechaCommandSkip(&tasks[pending[word]]);
+                            pending[word] = -1;
+                            removed++;
+                        }
+
+                        if ((KnownMap[word / 32] & (1 << (word % 32))) && known[word] == data)
+                        {
+                            MechaCommandSkip(task);
+                            removed++;
+                        }
+                        else
+                            pending[word] = i;
+                        break;
+                    case MECHA_CMD_RTC_READ:
+                    case MECHA_CMD_RTC_WRITE:
+                    case MECHA_CMD_ECR_READ:
+                    case MECHA_CMD_ECR_WRITE:
+                        barrier = 0; // Does not access the EEPROM.
+                        break;
+                    case MECHA_CMD_EEPROM_READ:
+                    case MECHA_CMD_READ_CHECKSUM:
+                    case MECHA_CMD_UPLOAD_TO_RAM:
+                    case MECHA_CMD_UPLOAD_NEW:
+                        break;
+                    default:
+                        invalidate = 1;
+                        break;
+                }
+        }
+
+        if (barrier)
+        { // Queued writes become committed values.
+            for (word = 0; word < 0x200; word++)
+            {
+                if (pending[word] >= 0)
+                {
+                    known[word] = (u16)strtoul(&tasks[pending[word]].args[4], NULL, 16);
+                    KnownMap[word / 32] |= (1 << (word % 32));
+                    pending[word] = -1;
+                }
+            }
+        }
+
+        if (invalidate)
+            memset(KnownMap, 0, sizeof(KnownMap));
+    }
+
+    return removed;
+}
+
 int MechaDefaultHandleRes1(MechaTask_t *task, const char *result, short int len)
 {
     PlatShowEMessage("%d. %04x%s %s - Rx-command error: %s\n", task->id, task->command, task->args, task->label, result);
@@ -220,67 +790,91 @@ const struct MechaIdentRaw *MechaGetRawIdent(void)
     return &MechaIdentRaw;
 }
 
-static void MechaGetNameOfMD(void)
+static u16 MechaImageRead(const MechaImage_t *image, u16 word)
+{
+    return (image->words != NULL ? image->words[word] : EEPMapRead(word));
+}
+
+static void MechaGetImage(MechaImage_t *image)
+{
+    image->words = NULL;
+    image->md    = ConMD;
+    image->slim  = ConSlim;
+    image->name  = MechaName;
+}
+
+// Dumps of the MD1.36 and MD1.38 A-chassis have the layout of MD1.39 and are classified as such.
+void MechaImageFromDump(MechaImage_t *image, const u16 *words, int IsNewLayout)
+{
+    image->words = words;
+    image->md    = IsNewLayout ? 40 : 39;
+    image->slim  = (IsNewLayout && words[EEPROM_MAP_CON_NEW] == MECHA_CHASSIS_SLIM);
+    image->name  = NULL;
+}
+
+// Returns the MECHA_TYPE of the image, 0xFF if it is not known or -EINVAL for an unknown MD version.
+int MechaImageGetType(const MechaImage_t *image)
 {
-    switch (ConMD)
+    int type;
+
+    switch (image->md)
     {
         case 36:
-            ConType = MECHA_TYPE_36;
+            type = MECHA_TYPE_36;
             break;
         case 38:
-            ConType = MECHA_TYPE_38;
+            type = MECHA_TYPE_38;
             break;
         case 39:
-            switch (EEPMapRead(EEPROM_MAP_CON))
+            switch (MechaImageRead(image, EEPROM_MAP_CON))
             {
                 case MECHA_CHASSIS_F_SONY:
                 case MECHA_CHASSIS_F_SANYO:
-                    ConType = MECHA_TYPE_F;
+                    type = MECHA_TYPE_F;
                     break;
                 case MECHA_CHASSIS_G_SONY:
                 case MECHA_CHASSIS_G_SANYO:
-                    if (!pstrincmp(MechaName, "000603", 6))
-                        ConType = MECHA_TYPE_G;
-                    else if (!pstrincmp(MechaName, "000803", 6))
-                        ConType = MECHA_TYPE_G2;
+                    if (image->name == NULL)
+                        type = MECHA_TYPE_G;
+                    else if (!pstrincmp(image->name, "000603", 6))
+                        type = MECHA_TYPE_G;
+                    else if (!pstrincmp(image->name, "000803", 6))
+                        type = MECHA_TYPE_G2;
                     else
-                        ConType = 0xFF;
+                        type = 0xFF;
                     break;
                 default:
-                    ConType = MECHA_TYPE_39;
+                    type = MECHA_TYPE_39;
                     break;
             }
             break;
         case 40:
-            ConType = MECHA_TYPE_40;
+            type = MECHA_TYPE_40;
             break;
         default:
-            ConType = 0xFF;
-            PlatShowEMessage("MD Name: Unknown MD version.\n");
+            type = -EINVAL;
             break;
     }
+
+    return type;
 }
 
-static void MechaParseOP(void)
+// Returns MECHA_OP_SONY or MECHA_OP_SANYO, or -EINVAL for an unknown MD version.
+int MechaImageGetOP(const MechaImage_t *image)
 {
     u16 idReg;
 
-    if (ConMD == 40)
-        idReg = EEPMapRead(EEPROM_MAP_CON_NEW);
-    else if (ConMD < 40)
-        idReg = EEPMapRead(EEPROM_MAP_CON);
+    if (image->md == 40)
+        idReg = MechaImageRead(image, EEPROM_MAP_CON_NEW);
+    else if (image->md < 40)
+        idReg = MechaImageRead(image, EEPROM_MAP_CON);
     else
-    {
-        ConOP = 0xFF;
-        PlatShowEMessage("OP name: unknown MD version.\n");
-        return;
-    }
+        return -EINVAL;
 
-    ConOP = (idReg & 0x20) ? MECHA_OP_SANYO : MECHA_OP_SONY;
-
-    if (ConSlim)
-        ConOP = MECHA_OP_SONY; // hardcode SONY OP for slims, CDratio range 700..1320, DVDratio range 1.8-3.0
+    if (image->slim)
+        return MECHA_OP_SONY; // hardcode SONY OP for slims, CDratio range 700..1320, DVDratio range 1.8-3.0
 
+    return ((idReg & 0x20) ? MECHA_OP_SANYO : MECHA_OP_SONY);
 
     // Old version from EEPROM 2003/03/13:
     /* switch (reg10)
@@ -306,104 +900,170 @@ static void MechaParseOP(void)
     } */
 }
 
-static void MechaParseLens(u16 reg10, u16 reg12, u16 reg13)
+// Returns the MECHA_LENS of the image, 0xFF if it is not known or -EINVAL for an unknown MD version.
+int MechaImageGetLens(const MechaImage_t *image)
 {
-    if (ConMD == 40)
+    u16 reg10, reg12, reg13;
+    int lens;
+
+    if (image->md == 40)
     {
-        ConLens = MECHA_LENS_T609K; // Starting from the G-chassis, SONY stopped allowing the lens type to be selected. The T609K probably became the standard SONY lens.
+        lens = MECHA_LENS_T609K; // Starting from the G-chassis, SONY stopped allowing the lens type to be selected. The T609K probably became the standard SONY lens.
     }
-    else if (ConMD < 40)
+    else if (image->md < 40)
     {
+        reg10 = MechaImageRead(image, EEPROM_MAP_CON);
+        reg12 = MechaImageRead(image, EEPROM_MAP_OPT_12);
+        reg13 = MechaImageRead(image, EEPROM_MAP_OPT_13);
+
         switch (reg10)
         {
             case MECHA_CHASSIS_DEX_A:
             case MECHA_CHASSIS_A:
                 if (reg12 == 0x98c9 && reg13 == 0x7878)
-                    ConLens = MECHA_LENS_T609K;
+                    lens = MECHA_LENS_T609K;
                 else if (reg12 == 0x97c9 && reg13 == 0x7777)
-                    ConLens = MECHA_LENS_T487;
+                    lens = MECHA_LENS_T487;
                 else
-                    ConLens = 0xFF;
+                    lens = 0xFF;
                 break;
             case MECHA_CHASSIS_AB:
                 if (reg12 == 0x6d8f && reg13 == 0x6f6f)
-                    ConLens = MECHA_LENS_T609K;
+                    lens = MECHA_LENS_T609K;
                 else if (reg12 == 0x4d8f && reg13 == 0x4f4f)
-                    ConLens = MECHA_LENS_T487;
+                    lens = MECHA_LENS_T487;
                 else
-                    ConLens = 0xFF;
+                    lens = 0xFF;
                 break;
             case MECHA_CHASSIS_DEX_B_OLD:
             case MECHA_CHASSIS_BC_OLD:
             case MECHA_CHASSIS_DEX_B:
             case MECHA_CHASSIS_B:
                 if (reg12 == 0x6d8f && reg13 == 0x6f6f)
-                    ConLens = MECHA_LENS_T609K;
+                    lens = MECHA_LENS_T609K;
                 else if (reg12 == 0x4d8f && (reg13 == 0x4f4f || reg13 == 0x6f4f))
-                    ConLens = MECHA_LENS_T487;
+                    lens = MECHA_LENS_T487;
                 else
-                    ConLens = 0xFF;
+                    lens = 0xFF;
                 break;
             case MECHA_CHASSIS_DEX_BD:
             case MECHA_CHASSIS_BCD: // B/C/D-chassis
                 if ((reg12 == 0x6d8f || reg12 == 0x6b8b) && reg13 == 0x6f6f)
-                    ConLens = MECHA_LENS_T609K;
+                    lens = MECHA_LENS_T609K;
                 else if (reg12 == 0x4d8f && (reg13 == 0x4f4f || reg13 == 0x6f4f || reg13 == 0x6f5f))
-                    ConLens = MECHA_LENS_T487;
+                    lens = MECHA_LENS_T487;
                 else
-                    ConLens = 0xFF;
+                    lens = 0xFF;
                 break;
             case MECHA_CHASSIS_F_SONY:
                 if (reg12 == 0x6b8b && reg13 == 0x4f6f)
-                    ConLens = MECHA_LENS_T609K;
+                    lens = MECHA_LENS_T609K;
                 else if (reg12 == 0x4d8f && reg13 == 0x6f4f)
-                    ConLens = MECHA_LENS_T487;
+                    lens = MECHA_LENS_T487;
                 else
-                    ConLens = 0xFF;
+                    lens = 0xFF;
                 break;
             case MECHA_CHASSIS_F_SANYO: // F-chassis with SANYO OP
                 if (reg12 == 0x6d8f && reg13 == 0x6f6f)
-                    ConLens = MECHA_LENS_T487;
+                    lens = MECHA_LENS_T487;
                 else
-                    ConLens = 0xFF;
+                    lens = 0xFF;
                 break;
             case MECHA_CHASSIS_G_SONY:
             case MECHA_CHASSIS_G_SANYO:
-                ConLens = MECHA_LENS_T609K;
+                lens = MECHA_LENS_T609K;
                 break;
             default:
-                ConLens = 0xFF;
+                lens = 0xFF;
                 break;
         }
     }
     else
-    {
-        ConLens = 0xFF;
-        PlatShowEMessage("Lens name: unknown MD version.\n");
-    }
+        lens = -EINVAL;
+
+    return lens;
 }
 
-static void MechaParseCEXDEX(void)
+// Returns 1 for CEX, 0 for DEX or -EINVAL for an unknown MD version.
+int MechaImageGetCEXDEX(const MechaImage_t *image)
 {
     char value[3];
     u8 type;
 
-    if (ConMD == 40)
+    if (image->md == 40)
     {
-        strncpy(value, &MechaName[2], 2);
-        value[2]  = '\0';
-        type      = (u8)strtoul(value, NULL, 16);
-        ConCEXDEX = (~type & 1);
+        if (image->name == NULL) // The model names of the DEX units start with "DTL".
+            return (MechaImageRead(image, EEPROM_MAP_MODEL_NAME_NEW_0) != ('D' | ('T' << 8)));
+
+        strncpy(value, &image->name[2], 2);
+        value[2] = '\0';
+        type     = (u8)strtoul(value, NULL, 16);
+        return (~type & 1);
     }
-    else if (ConMD < 40)
+    else if (image->md < 40)
+        return (MechaImageRead(image, EEPROM_MAP_CON) & 1);
+    else
+        return -EINVAL;
+}
+
+static void MechaGetNameOfMD(void)
+{
+    MechaImage_t image;
+    int type;
+
+    MechaGetImage(&image);
+    if ((type = MechaImageGetType(&image)) < 0)
     {
-        ConCEXDEX = EEPMapRead(EEPROM_MAP_CON) & 1;
+        ConType = 0xFF;
+        PlatShowEMessage("MD Name: Unknown MD version.\n");
     }
     else
+        ConType = (u8)type;
+}
+
+static void MechaParseOP(void)
+{
+    MechaImage_t image;
+    int op;
+
+    MechaGetImage(&image);
+    if ((op = MechaImageGetOP(&image)) < 0)
+    {
+        ConOP = 0xFF;
+        PlatShowEMessage("OP name: unknown MD version.\n");
+    }
+    else
+        ConOP = (u8)op;
+}
+
+static void MechaParseLens(void)
+{
+    MechaImage_t image;
+    int lens;
+
+    MechaGetImage(&image);
+    if ((lens = MechaImageGetLens(&image)) < 0)
+    {
+        ConLens = 0xFF;
+        PlatShowEMessage("Lens name: unknown MD version.\n");
+    }
+    else
+        ConLens = (u8)lens;
+}
+
+static void MechaParseCEXDEX(void)
+{
+    MechaImage_t image;
+    int cexdex;
+
+    MechaGetImage(&image);
+    if ((cexdex = MechaImageGetCEXDEX(&image)) < 0)
     {
         ConCEXDEX = 0xFF;
         PlatShowEMessage("CEXDEX: Unknown MD version\n");
     }
+    else
+        ConCEXDEX = (u8)cexdex;
 }
 
 static int MechaCmdInitRxModelHandler(const char *data, int len)
@@ -619,7 +1279,7 @@ int MechaInitModel(void)
                 MechaGetNameOfMD();
                 MechaParseCEXDEX();
                 MechaParseOP();
-                MechaParseLens(EEPMapRead(EEPROM_MAP_CON), EEPMapRead(EEPROM_MAP_OPT_12), EEPMapRead(EEPROM_MAP_OPT_13));
+                MechaParseLens();
             }
         }
         else
@@ -831,32 +1491,42 @@ int MechaAddPostEEPROMWrCmds(unsigned char id)
     return 0;
 }
 
-int MechaAddPostUpdateCmds(unsigned char ClearOSD2InitBit, unsigned char id)
+/*  Only the regions that were changed are copied from the EEPROM to the MECHACON RAM, and the checksum is only
+    rewritten if the EEPROM was written to: an update of the RTC alone needs none of these commands. */
+int MechaAddPostUpdateCmds(unsigned short int regions, unsigned char id)
 {
     char value[9];
 
     if (ConMD <= 39)
     {
-        if (ClearOSD2InitBit)
+        if (regions & UPDATE_REGION_OSD2)
         {
             snprintf(value, 9, "%04x%04x", EEPROM_MAP_OSD2_17, EEPMapRead(EEPROM_MAP_OSD2_17) & ~0x80);
             MechaCommandAdd(MECHA_CMD_EEPROM_WRITE, value, id++, 0, MECHA_TASK_NORMAL_TO, "CLEAR OSD2 INIT BIT");
         }
 
-        MechaCommandAdd(MECHA_CMD_WRITE_CHECKSUM, "00", id++, 0, MECHA_TASK_NORMAL_TO, "EEPROM CHECKSUM WRITE");
-        MechaCommandAdd(MECHA_CMD_READ_CHECKSUM, "00", id++, MECHA_CMD_TAG_INIT_CHECKSUM_CHK, MECHA_TASK_NORMAL_TO, "EEPROM CHECKSUM CHK");
-        MechaCommandAdd(MECHA_CMD_UPLOAD_TO_RAM, "02", id++, 0, MECHA_TASK_NORMAL_TO, "EEPROM TO MECHACON-RAM (DISC DETECT)");
-        MechaCommandAdd(MECHA_CMD_UPLOAD_TO_RAM, "03", id++, 0, MECHA_TASK_NORMAL_TO, "EEPROM TO MECHACON-RAM (SERVO)");
-        if (IsAutoTiltModel())
+        if (regions & UPDATE_REGIONS_EEPROM)
+        {
+            MechaCommandAdd(MECHA_CMD_WRITE_CHECKSUM, "00", id++, 0, MECHA_TASK_NORMAL_TO, "EEPROM CHECKSUM WRITE");
+            MechaCommandAdd(MECHA_CMD_READ_CHECKSUM, "00", id++, MECHA_CMD_TAG_INIT_CHECKSUM_CHK, MECHA_TASK_NORMAL_TO, "EEPROM CHECKSUM CHK");
+        }
+        if (regions & (UPDATE_REGION_DISCDET | UPDATE_REGION_DEFAULTS))
+            MechaCommandAdd(MECHA_CMD_UPLOAD_TO_RAM, "02", id++, 0, MECHA_TASK_NORMAL_TO, "EEPROM TO MECHACON-RAM (DISC DETECT)");
+        // The EEPROM copy of the ECR is within the servo region.
+        if (regions & (UPDATE_REGION_SERVO | UPDATE_REGION_EEP_ECR | UPDATE_REGION_DEFAULTS))
+            MechaCommandAdd(MECHA_CMD_UPLOAD_TO_RAM, "03", id++, 0, MECHA_TASK_NORMAL_TO, "EEPROM TO MECHACON-RAM (SERVO)");
+        if (IsAutoTiltModel() && (regions & (UPDATE_REGION_TILT | UPDATE_REGION_DEFAULTS)))
             MechaCommandAdd(MECHA_CMD_UPLOAD_TO_RAM, "04", id++, 0, MECHA_TASK_NORMAL_TO, "EEPROM TO MECHACON-RAM (TILT)");
         switch (ConMD)
         {
             case 36:
             case 38:
-                MechaCommandAdd(MECHA_CMD_UPLOAD_TO_RAM, "04", id++, 0, MECHA_TASK_NORMAL_TO, "EEPROM TO MECHACON-RAM (TRAY)");
+                if (regions & (UPDATE_REGION_TRAY | UPDATE_REGION_DEFAULTS))
+                    MechaCommandAdd(MECHA_CMD_UPLOAD_TO_RAM, "04", id++, 0, MECHA_TASK_NORMAL_TO, "EEPROM TO MECHACON-RAM (TRAY)");
                 break;
             case 39:
-                MechaCommandAdd(MECHA_CMD_UPLOAD_TO_RAM, "05", id++, 0, MECHA_TASK_NORMAL_TO, "EEPROM TO MECHACON-RAM (TRAY)");
+                if (regions & (UPDATE_REGION_TRAY | UPDATE_REGION_DEFAULTS))
+                    MechaCommandAdd(MECHA_CMD_UPLOAD_TO_RAM, "05", id++, 0, MECHA_TASK_NORMAL_TO, "EEPROM TO MECHACON-RAM (TRAY)");
                 break;
             default:
                 // Shouldn't happen.
@@ -865,18 +1535,25 @@ int MechaAddPostUpdateCmds(unsigned char ClearOSD2InitBit, unsigned char id)
     }
     else if (ConMD == 40)
     {
-        if (ClearOSD2InitBit)
+        if (regions & UPDATE_REGION_OSD2)
         {
             snprintf(value, 9, "%04x%04x", EEPROM_MAP_OSD2_17_NEW, EEPMapRead(EEPROM_MAP_OSD2_17_NEW) & ~0x80);
             MechaCommandAdd(MECHA_CMD_EEPROM_WRITE, value, id++, 0, MECHA_TASK_NORMAL_TO, "CLEAR OSD2 INIT BIT");
         }
 
-        MechaCommandAdd(MECHA_CMD_WRITE_CHECKSUM, "00", id++, 0, MECHA_TASK_NORMAL_TO, "EEPROM CHECKSUM WRITE");
-        MechaCommandAdd(MECHA_TASK_UI_CMD_WAIT, NULL, MECHA_TASK_ID_UI, 0, 100, "WAIT 100ms");
-        MechaCommandAdd(MECHA_CMD_READ_CHECKSUM, "00", id++, MECHA_CMD_TAG_INIT_CHECKSUM_CHK, MECHA_TASK_NORMAL_TO, "EEPROM CHECKSUM CHK");
-        MechaCommandAdd(MECHA_TASK_UI_CMD_WAIT, NULL, MECHA_TASK_ID_UI, 0, 100, "WAIT 100ms");
-        MechaCommandAdd(MECHA_CMD_UPLOAD_NEW, "00", id++, 0, MECHA_TASK_NORMAL_TO, "EEPROM TO MECHACON-RAM");
-        MechaCommandAdd(MECHA_TASK_UI_CMD_WAIT, NULL, MECHA_TASK_ID_UI, 0, 100, "WAIT 100ms");
+        if (regions & UPDATE_REGIONS_EEPROM)
+        {
+            MechaCommandAdd(MECHA_CMD_WRITE_CHECKSUM, "00", id++, 0, MECHA_TASK_NORMAL_TO, "EEPROM CHECKSUM WRITE");
+            MechaCommandAdd(MECHA_TASK_UI_CMD_WAIT, NULL, MECHA_TASK_ID_UI, 0, 100, "WAIT 100ms");
+            MechaCommandAdd(MECHA_CMD_READ_CHECKSUM, "00", id++, MECHA_CMD_TAG_INIT_CHECKSUM_CHK, MECHA_TASK_NORMAL_TO, "EEPROM CHECKSUM CHK");
+            MechaCommandAdd(MECHA_TASK_UI_CMD_WAIT, NULL, MECHA_TASK_ID_UI, 0, 100, "WAIT 100ms");
+        }
+        // All regions are copied at once.
+        if (regions & UPDATE_REGIONS_RAM)
+        {
+            MechaCommandAdd(MECHA_CMD_UPLOAD_NEW, "00", id++, 0, MECHA_TASK_NORMAL_TO, "EEPROM TO MECHACON-RAM");
+            MechaCommandAdd(MECHA_TASK_UI_CMD_WAIT, NULL, MECHA_TASK_ID_UI, 0, 100, "WAIT 100ms");
+        }
     }
     else
     {
@@ -887,11 +1564,11 @@ int MechaAddPostUpdateCmds(unsigned char ClearOSD2InitBit, unsigned char id)
     return 0;
 }
 
-int IsChassisCex10000(void)
+int MechaImageIsChassisCex10000(const MechaImage_t *image)
 {
-    if (ConMD <= 39)
+    if (image->md <= 39)
     {
-        switch (EEPMapRead(EEPROM_MAP_CON))
+        switch (MechaImageRead(image, EEPROM_MAP_CON))
         {
             case MECHA_CHASSIS_A:
             case MECHA_CHASSIS_AB:
@@ -902,11 +1579,11 @@ int IsChassisCex10000(void)
     return 0;
 }
 
-int IsChassisA(void)
+int MechaImageIsChassisA(const MechaImage_t *image)
 {
-    if (ConMD <= 39)
+    if (image->md <= 39)
     {
-        switch (EEPMapRead(EEPROM_MAP_CON))
+        switch (MechaImageRead(image, EEPROM_MAP_CON))
         {
             case MECHA_CHASSIS_AB:
                 return 1;
@@ -916,30 +1593,30 @@ int IsChassisA(void)
     return 0;
 }
 
-int IsChassisB(void)
+int MechaImageIsChassisB(const MechaImage_t *image)
 {
-    if (ConMD <= 39)
+    if (image->md <= 39)
     {
-        switch (EEPMapRead(EEPROM_MAP_CON))
+        switch (MechaImageRead(image, EEPROM_MAP_CON))
         {
             case MECHA_CHASSIS_BC_OLD:
             case MECHA_CHASSIS_BCD:
             case MECHA_CHASSIS_B:
-                switch (EEPMapRead(EEPROM_MAP_OPT_13))
+                switch (MechaImageRead(image, EEPROM_MAP_OPT_13))
                 {
                     case 0x4f4f:
                     case 0x6f4f:
                     case 0x6f6f:
-                        switch (EEPMapRead(0x029))
+                        switch (MechaImageRead(image, 0x029))
                         {
                             case 0x0019:
                             case 0x0015:
-                                switch (EEPMapRead(0x026))
+                                switch (MechaImageRead(image, 0x026))
                                 {
                                     case 0x0c0a:
                                     case 0x0c06:
                                     case 0x0e06:
-                                        switch (EEPMapRead(EEPROM_MAP_OPT_12))
+                                        switch (MechaImageRead(image, EEPROM_MAP_OPT_12))
                                         {
                                             case 0x4d8f:
                                             case 0x6d8f:
@@ -954,29 +1631,29 @@ int IsChassisB(void)
     return 0;
 }
 
-int IsChassisC(void)
+int MechaImageIsChassisC(const MechaImage_t *image)
 {
-    if (ConMD <= 39)
+    if (image->md <= 39)
     {
-        switch (EEPMapRead(EEPROM_MAP_CON))
+        switch (MechaImageRead(image, EEPROM_MAP_CON))
         {
             case MECHA_CHASSIS_BC_OLD:
             case MECHA_CHASSIS_BCD:
-                switch (EEPMapRead(EEPROM_MAP_OPT_13))
+                switch (MechaImageRead(image, EEPROM_MAP_OPT_13))
                 {
                     case 0x4f4f:
                     case 0x6f4f:
                     case 0x6f6f:
-                        switch (EEPMapRead(0x029))
+                        switch (MechaImageRead(image, 0x029))
                         {
                             case 0x0019:
                             case 0x0015:
-                                switch (EEPMapRead(0x026))
+                                switch (MechaImageRead(image, 0x026))
                                 {
                                     case 0x0c0a:
                                     case 0x0c06:
                                     case 0x0e06:
-                                        switch (EEPMapRead(EEPROM_MAP_OPT_12))
+                                        switch (MechaImageRead(image, EEPROM_MAP_OPT_12))
                                         {
                                             case 0x4d8f:
                                             case 0x6d8f:
@@ -991,28 +1668,28 @@ int IsChassisC(void)
     return 0;
 }
 
-int IsChassisD(void)
+int MechaImageIsChassisD(const MechaImage_t *image)
 {
-    if (ConMD <= 39)
+    if (image->md <= 39)
     {
-        switch (EEPMapRead(EEPROM_MAP_CON))
+        switch (MechaImageRead(image, EEPROM_MAP_CON))
         {
             case MECHA_CHASSIS_BCD:
-                switch (EEPMapRead(EEPROM_MAP_OPT_13))
+                switch (MechaImageRead(image, EEPROM_MAP_OPT_13))
                 {
                     case 0x6f4f:
                     case 0x6f5f:
                     case 0x6f6f:
-                        switch (EEPMapRead(0x026))
+                        switch (MechaImageRead(image, 0x026))
                         {
                             case 0x0c06:
                             case 0x0e06:
                             case 0x9a4d:
-                                switch (EEPMapRead(0x029))
+                                switch (MechaImageRead(image, 0x029))
                                 {
                                     case 0x0019:
                                     case 0x0013:
-                                        switch (EEPMapRead(EEPROM_MAP_OPT_12))
+                                        switch (MechaImageRead(image, EEPROM_MAP_OPT_12))
                                         {
                                             case 0x4d8f:
                                             case 0x6b8b:
@@ -1027,11 +1704,11 @@ int IsChassisD(void)
     return 0;
 }
 
-int IsChassisF(void)
+int MechaImageIsChassisF(const MechaImage_t *image)
 {
-    if (ConMD <= 39)
+    if (image->md <= 39)
     {
-        switch (EEPMapRead(EEPROM_MAP_CON))
+        switch (MechaImageRead(image, EEPROM_MAP_CON))
         {
             case MECHA_CHASSIS_F_SONY:
             case MECHA_CHASSIS_F_SANYO:
@@ -1042,11 +1719,11 @@ int IsChassisF(void)
     return 0;
 }
 
-int IsChassisG(void)
+int MechaImageIsChassisG(const MechaImage_t *image)
 {
-    if (ConMD <= 39)
+    if (image->md <= 39)
     {
-        switch (EEPMapRead(EEPROM_MAP_CON))
+        switch (MechaImageRead(image, EEPROM_MAP_CON))
         {
             case MECHA_CHASSIS_G_SONY:
             case MECHA_CHASSIS_G_SANYO:
@@ -1057,11 +1734,11 @@ int IsChassisG(void)
     return 0;
 }
 
-int IsChassisDragon(void)
+int MechaImageIsChassisDragon(const MechaImage_t *image)
 {
-    if (ConMD == 40)
+    if (image->md == 40)
     {
-        switch (EEPMapRead(EEPROM_MAP_CON_NEW))
+        switch (MechaImageRead(image, EEPROM_MAP_CON_NEW))
         {
             case MECHA_CHASSIS_H_SONY:
             case MECHA_CHASSIS_H_SANYO:
@@ -1071,17 +1748,15 @@ int IsChassisDragon(void)
                 return 0;
         }
     }
-    else if (ConMD > 40)
-        PlatShowEMessage("IsChassisDragon: Unknown MD version.\n");
 
     return 0;
 }
 
-int IsChassisDexA(void)
+int MechaImageIsChassisDexA(const MechaImage_t *image)
 {
-    if (ConMD <= 39)
+    if (image->md <= 39)
     {
-        switch (EEPMapRead(EEPROM_MAP_CON))
+        switch (MechaImageRead(image, EEPROM_MAP_CON))
         {
             case MECHA_CHASSIS_DEX_A:
                 return 1;
@@ -1091,16 +1766,16 @@ int IsChassisDexA(void)
     return 0;
 }
 
-int IsChassisDexB(void)
+int MechaImageIsChassisDexB(const MechaImage_t *image)
 {
-    if (ConMD <= 39)
+    if (image->md <= 39)
     {
-        switch (EEPMapRead(EEPROM_MAP_CON))
+        switch (MechaImageRead(image, EEPROM_MAP_CON))
         {
             case MECHA_CHASSIS_DEX_B_OLD:
             case MECHA_CHASSIS_DEX_BD:
             case MECHA_CHASSIS_DEX_B:
-                switch (EEPMapRead(0x026))
+                switch (MechaImageRead(image, 0x026))
                 {
                     case 0x0c0a:
                     case 0x0c06:
@@ -1113,14 +1788,14 @@ int IsChassisDexB(void)
     return 0;
 }
 
-int IsChassisDexD(void)
+int MechaImageIsChassisDexD(const MechaImage_t *image)
 {
-    if (ConMD <= 39)
+    if (image->md <= 39)
     {
-        switch (EEPMapRead(EEPROM_MAP_CON))
+        switch (MechaImageRead(image, EEPROM_MAP_CON))
         {
             case MECHA_CHASSIS_DEX_BD:
-                switch (EEPMapRead(0x026))
+                switch (MechaImageRead(image, 0x026))
                 {
                     case 0x9a4d:
                         return 1;
@@ -1131,6 +1806,96 @@ int IsChassisDexD(void)
     return 0;
 }
 
+int IsChassisCex10000(void)
+{
+    MechaImage_t image;
+
+    MechaGetImage(&image);
+    return MechaImageIsChassisCex10000(&image);
+}
+
+int IsChassisA(void)
+{
+    MechaImage_t image;
+
+    MechaGetImage(&image);
+    return MechaImageIsChassisA(&image);
+}
+
+int IsChassisB(void)
+{
+    MechaImage_t image;
+
+    MechaGetImage(&image);
+    return MechaImageIsChassisB(&image);
+}
+
+int IsChassisC(void)
+{
+    MechaImage_t image;
+
+    MechaGetImage(&image);
+    return MechaImageIsChassisC(&image);
+}
+
+int IsChassisD(void)
+{
+    MechaImage_t image;
+
+    MechaGetImage(&image);
+    return MechaImageIsChassisD(&image);
+}
+
+int IsChassisF(void)
+{
+    MechaImage_t image;
+
+    MechaGetImage(&image);
+    return MechaImageIsChassisF(&image);
+}
+
+int IsChassisG(void)
+{
+    MechaImage_t image;
+
+    MechaGetImage(&image);
+    return MechaImageIsChassisG(&image);
+}
+
+int IsChassisDragon(void)
+{
+    MechaImage_t image;
+
+    if (ConMD > 40)
+        PlatShowEMessage("IsChassisDragon: Unknown MD version.\n");
+    MechaGetImage(&image);
+    return MechaImageIsChassisDragon(&image);
+}
+
+int IsChassisDexA(void)
+{
+    MechaImage_t image;
+
+    MechaGetImage(&image);
+    return MechaImageIsChassisDexA(&image);
+}
+
+int IsChassisDexB(void)
+{
+    MechaImage_t image;
+
+    MechaGetImage(&image);
+    return MechaImageIsChassisDexB(&image);
+}
+
+int IsChassisDexD(void)
+{
+    MechaImage_t image;
+
+    MechaGetImage(&image);
+    return MechaImageIsChassisDexD(&image);
+}
+
 // Non-SONY helper functions
 int IsAutoTiltModel(void)
 {
@@ -1193,6 +1958,110 @@ const char *MechaGetRTCName(int rtc)
     }
 }
 
+const char *MechaGetCommandName(unsigned short int command)
+{
+    static const struct
+    {
+        unsigned short int command;
+        const char *name;
+    } names[] = {
+        {MECHA_CMD_INIT_SHIMUKE, "INIT_SHIMUKE"},
+        {MECHA_CMD_INIT_MECHACON, "INIT_MECHACON"},
+        {MECHA_CMD_DISC_MODE_CD_8, "DISC_MODE_CD_8"},
+        {MECHA_CMD_DISC_MODE_CD_12, "DISC_MODE_CD_12"},
+        {MECHA_CMD_DISC_MODE_DVDSL_8, "DISC_MODE_DVDSL_8"},
+        {MECHA_CMD_DISC_MODE_DVDDL_8, "DISC_MODE_DVDDL_8"},
+        {MECHA_CMD_DISC_MODE_DVDSL_12, "DISC_MODE_DVDSL_12"},
+        {MECHA_CMD_DISC_MODE_DVDDL_12, "DISC_MODE_DVDDL_12"},
+        {MECHA_CMD_DISC_DETECT, "DISC_DETECT"},
+        {MECHA_CMD_DISC_CUR_MODE, "DISC_CUR_MODE"},
+        {MECHA_CMD_FOCUS_UPDOWN, "FOCUS_UPDOWN"},
+        {MECHA_CMD_FOCUS_AUTO_START, "FOCUS_AUTO_START"},
+        {MECHA_CMD_FOCUS_AUTO_STOP, "FOCUS_AUTO_STOP"},
+        {MECHA_CMD_FCS_SEARCH_CHECK, "FCS_SEARCH_CHECK"},
+        {MECHA_CMD_LASER_DIODE, "LASER_DIODE"},
+        {MECHA_CMD_TRACKING, "TRACKING"},
+        {MECHA_CMD_SLED_CTL_MICRO, "SLED_CTL_MICRO"},
+        {MECHA_CMD_SLED_CTL_BIPHS, "SLED_CTL_BIPHS"},
+        {MECHA_CMD_SLED_CTL_POS, "SLED_CTL_POS"},
+        {MECHA_CMD_SLED_POS_HOME, "SLED_POS_HOME"},
+        {MECHA_CMD_SLED_IN_SW, "SLED_IN_SW"},
+        {MECHA_CMD_SP_CTL, "SP_CTL"},
+        {MECHA_CMD_SP_CLV_S, "SP_CLV_S"},
+        {MECHA_CMD_SP_CLV_A, "SP_CLV_A"},
+        {MECHA_CMD_TRAY, "TRAY"},
+        {MECHA_CMD_TRAY_SW, "TRAY_SW"},
+        {MECHA_CMD_CLEAR_CONF, "CLEAR_CONF"},
+        {MECHA_CMD_UPLOAD_NEW, "UPLOAD_NEW"},
+        {MECHA_CMD_UPLOAD_TO_RAM, "UPLOAD_TO_RAM"},
+        {MECHA_CMD_DETECT_ADJ, "DETECT_ADJ"},
+        {MECHA_CMD_WRITE_CHECKSUM, "WRITE_CHECKSUM"},
+        {MECHA_CMD_READ_CHECKSUM, "READ_CHECKSUM"},
+        {MECHA_CMD_SETUP_OSD, "SETUP_OSD"},
+        {MECHA_CMD_SETUP_SANYO, "SETUP_SANYO"},
+        {MECHA_CMD_AUTO_ADJ_ST_1, "AUTO_ADJ_ST_1"},
+        {MECHA_CMD_AUTO_ADJ_ST_2, "AUTO_ADJ_ST_2"},
+        {MECHA_CMD_AUTO_ADJ_ST_12, "AUTO_ADJ_ST_12"},
+        {MECHA_CMD_AUTO_ADJ_ST_2MD, "AUTO_ADJ_ST_2MD"},
+        {MECHA_CMD_AUTO_ADJ_FIX_GAIN, "AUTO_ADJ_FIX_GAIN"},
+        {MECHA_CMD_RFDC_LEVEL, "RFDC_LEVEL"},
+        {MECHA_CMD_TPP, "TPP"},
+        {MECHA_CMD_MIRR_CHECK, "MIRR_CHECK"},
+        {MECHA_CMD_FE_OFFSET, "FE_OFFSET"},
+        {MECHA_CMD_CD_PLAY_1, "CD_PLAY_1"},
+        {MECHA_CMD_CD_PLAY_2, "CD_PLAY_2"},
+        {MECHA_CMD_CD_PLAY_3, "CD_PLAY_3"},
+        {MECHA_CMD_CD_PLAY_4, "CD_PLAY_4"},
+        {MECHA_CMD_CD_STOP, "CD_STOP"},
+        {MECHA_CMD_CD_PAUSE, "CD_PAUSE"},
+        {MECHA_CMD_CD_TRACK_CTL, "CD_TRACK_CTL"},
+        {MECHA_CMD_CD_TRACK_LONG_CTL, "CD_TRACK_LONG_CTL"},
+        {MECHA_CMD_CD_PLAY_5, "CD_PLAY_5"},
+        {MECHA_CMD_DVD_PLAY_1, "DVD_PLAY_1"},
+        {MECHA_CMD_DVD_PLAY_2, "DVD_PLAY_2"},
+        {MECHA_CMD_DVD_PLAY_3, "DVD_PLAY_3"},
+        {MECHA_CMD_DVD_STOP, "DVD_STOP"},
+        {MECHA_CMD_DVD_PAUSE, "DVD_PAUSE"},
+        {MECHA_CMD_DVD_TRACK_CTL, "DVD_TRACK_CTL"},
+        {MECHA_CMD_DVD_TRACK_LONG_CTL, "DVD_TRACK_LONG_CTL"},
+        {MECHA_CMD_FOCUS_JUMP, "FOCUS_JUMP"},
+        {MECHA_CMD_ADJ_AUTO_TILT, "ADJ_AUTO_TILT"},
+        {MECHA_CMD_INIT_AUTO_TILT, "INIT_AUTO_TILT"},
+        {MECHA_CMD_MOV_AUTO_TILT, "MOV_AUTO_TILT"},
+        {MECHA_CMD_SET_DSP, "SET_DSP"},
+        {MECHA_CMD_GAIN, "GAIN"},
+        {MECHA_CMD_DSP_ERROR_RATE_CTL, "DSP_ERROR_RATE_CTL"},
+        {MECHA_CMD_DSP_ERROR_RATE, "DSP_ERROR_RATE"},
+        {MECHA_CMD_EEPROM_WRITE, "EEPROM_WRITE"},
+        {MECHA_CMD_EEPROM_READ, "EEPROM_READ"},
+        {MECHA_CMD_RTC_READ, "RTC_READ"},
+        {MECHA_CMD_RTC_WRITE, "RTC_WRITE"},
+        {MECHA_CMD_ECR_READ, "ECR_READ"},
+        {MECHA_CMD_ECR_WRITE, "ECR_WRITE"},
+        {MECHA_CMD_CD_ERROR, "CD_ERROR"},
+        {MECHA_CMD_JITTER, "JITTER"},
+        {MECHA_CMD_FOCUS_JUMP_NEW, "FOCUS_JUMP_NEW"},
+        {MECHA_CMD_WRITE_1A6, "WRITE_1A6"},
+        {MECHA_CMD_READ_1A6, "READ_1A6"},
+        {MECHA_CMD_READ_1EA_1FA, "READ_1EA_1FA"},
+        {MECHA_CMD_WRITE_1EA_1FA, "WRITE_1EA_1FA"},
+        {MECHA_CMD_WRITECONFIG, "WRITECONFIG"},
+        {MECHA_CMD_READCONFIG, "READCONFIG"},
+        {MECHA_CMD_READ_MODEL_2, "READ_MODEL_2"},
+        {MECHA_CMD_READ_MODEL, "READ_MODEL"},
+        {MECHA_CMD_EEPROM_ERASE, "EEPROM_ERASE"},
+        {0, NULL}};
+    int i;
+
+    for (i = 0; names[i].name != NULL; i++)
+    {
+        if (names[i].command == command)
+            return names[i].name;
+    }
+
+    return "unknown";
+}
+
 const char *MechaGetOPTypeName(int type)
 {
     switch (type)
@@ -5,6 +5,10 @@
 #define MECHA_TX_BUFFER_SIZE 32
 #define MECHA_RX_BUFFER_SIZE 32
 
+#define MECHA_BAUD_RATE      57600 // Of the serial link (8N1: 10 bits per byte).
+#define MECHA_WAIT_STEP_MS   10    // Waits in command lists are split into steps of this length, to check for cancellation.
+#define MECHA_PIPELINE_MAX   8     // Most commands that may be in flight at once (see MechaTransport_t).
+
 struct MechaIdentRaw
 {
     u32 cfc;
@@ -125,10 +129,35 @@ typedef int (*MechaCommandHandler_t)(const char *data, int len);
 typedef int (*MechaCommandTxHandler_t)(MechaTask_t *task);
 typedef int (*MechaCommandRxHandler_t)(MechaTask_t *task, const char *result, short int len);
 
+// The link to the MECHACON. By default, this is the serial port of the platform.
+typedef struct MechaTransport
+{
+    int (*read)(char *data, int n, unsigned short timeout);
+    int (*write)(const char *data);
+    void (*prompt)(const char *label); // Optional: called before the operator is prompted.
+    unsigned char pipeline;            // EEPROM reads of a command list that may be in flight at once (0 or 1: one command at a time).
+    unsigned char port;                // COM port that read and write act on (see PlatSelectCOMPort).
+    void (*times)(u64 *WriteStart, u64 *WriteEnd, u64 *ReadTime); // Optional: times of the last transfers (see PlatGetCOMPortTimes()).
+} MechaTransport_t;
+
+void MechaSetTransport(const MechaTransport_t *transport); // NULL = restore the serial port
+const MechaTransport_t *MechaGetTransport(void);
+
 int MechaCommandAdd(unsigned short int command, const char *args, unsigned char id, unsigned char tag, unsigned short int timeout, const char *label);
+int MechaCancel(void); // Requests cancellation of the running command list (i.e. on Ctrl-C).
+int MechaCancelStop(void);      // Stops the drive at a prompt, if Ctrl-C was pressed while idle. Returns 1 if PMAP must exit.
+int MechaIsExitRequested(void); // Ctrl-C was pressed while idle, with the drive running.
+int MechaWasCancelled(void);    // 1 (once) after the drive was stopped by a cancellation.
 int MechaCommandExecute(unsigned short int command, unsigned short int timeout, const char *args, char *buffer, unsigned char BufferSize);
 int MechaCommandExecuteList(MechaCommandTxHandler_t transmit, MechaCommandRxHandler_t receive);
+/*  For commands to more than one console at once: MechaCommandPost() sends a command over link (NULL = the current
+    transport) without waiting for its response, and MechaCommandCollect() reads the response to the oldest command posted.
+    Up to MECHA_PIPELINE_MAX commands may be outstanding. MechaCommandExecute() discards the responses not yet collected. */
+int MechaCommandPost(const MechaTransport_t *link, unsigned short int command, const char *args);
+int MechaCommandCollect(unsigned short int timeout, char *buffer, unsigned char BufferSize);
 void MechaCommandListClear(void);
+const MechaTask_t *MechaCommandListGet(unsigned short int *count);
+int MechaCommandListOptimize(void);
 
 int MechaDefaultHandleRes1(MechaTask_t *task, const char *result, short int len);
 int MechaDefaultHandleRes2(MechaTask_t *task, const char *result, short int len);
@@ -144,9 +173,40 @@ int MechaGetOP(void);
 int MechaGetLens(void);
 int MechaGetEEPROMStat(void);
 int MechaAddPostEEPROMWrCmds(unsigned char id);
-int MechaAddPostUpdateCmds(unsigned char ClearOSD2InitBit, unsigned char id);
+int MechaAddPostUpdateCmds(unsigned short int regions, unsigned char id); // regions: UPDATE_REGION_* flags of what was changed.
 const char *MechaGetDesc(void);
 
+/*  A view of an EEPROM image for the identification functions, so that they can also classify EEPROM dumps.
+    words: the 512 words of the EEPROM, or NULL for the EEPROM shadow of the connected console.
+    name: the MECHACON version (i.e. "000603xx"), or NULL if it is not known.
+    Without the MECHACON version, the G-chassis cannot be told apart from the G-chassis with the newer MECHACON,
+    the slims are recognized from their chassis ID and the CEX/DEX type of the Dragon is taken from its model name. */
+typedef struct MechaImage
+{
+    const u16 *words;
+    u8 md;
+    u8 slim;
+    const char *name;
+} MechaImage_t;
+
+void MechaImageFromDump(MechaImage_t *image, const u16 *words, int IsNewLayout);
+int MechaImageGetType(const MechaImage_t *image);
+int MechaImageGetCEXDEX(const MechaImage_t *image);
+int MechaImageGetOP(const MechaImage_t *image);
+int MechaImageGetLens(const MechaImage_t *image);
+
+int MechaImageIsChassisCex10000(const MechaImage_t *image);
+int MechaImageIsChassisA(const MechaImage_t *image);
+int MechaImageIsChassisB(const MechaImage_t *image);
+int MechaImageIsChassisC(const MechaImage_t *image);
+int MechaImageIsChassisD(const MechaImage_t *image);
+int MechaImageIsChassisF(const MechaImage_t *image);
+int MechaImageIsChassisG(const MechaImage_t *image);
+int MechaImageIsChassisDragon(const MechaImage_t *image);
+int MechaImageIsChassisDexA(const MechaImage_t *image);
+int MechaImageIsChassisDexB(const MechaImage_t *image);
+int MechaImageIsChassisDexD(const MechaImage_t *image);
+
 int IsChassisCex10000(void);
 int IsChassisA(void);
 int IsChassisB(void);
@@ -372,6 +432,7 @@ enum MECHA_TYPE
 
 const char *MechaGetRtcStatusDesc(int type, int status);
 const char *MechaGetRTCName(int rtc);
+const char *MechaGetCommandName(unsigned short int command);
 const char *MechaGetOPTypeName(int type);
 const char *MechaGetLensTypeName(int type);
 const char *MechaGetTVSystemDesc(int type);
@@ -0,0 +1,284 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "platform.h"
+#include "log.h"
+#include "mecha.h"
+#include "net.h"
+
+#define NET_BUFFER_SIZE 256
+
+enum NET_STATE
+{
+    NET_STATE_DATA = 0,
+    NET_STATE_IAC,
+    NET_STATE_OPTION,
+    NET_STATE_SB,
+    NET_STATE_SB_IAC,
+};
+
+static MechaTransport_t NetTransport;
+static unsigned char opened = 0, telnet, NetState, NetVerb;
+static unsigned char NetSub[16], NetSubLen;
+static unsigned char NetRx[NET_BUFFER_SIZE];
+static int NetRxLen, NetRxPos;
+static u32 NetBaudRate; // As confirmed by the server.
+
+static void NetSendOption(unsigned char verb, unsigned char option)
+{
+    unsigned char frame[3];
+
+    frame[0] = TELNET_IAC;
+    frame[1] = verb;
+    frame[2] = option;
+    PlatWriteNetPort((const char *)frame, sizeof(frame));
+}
+
+// value is sent in size bytes, most significant byte first.
+static void NetSendComPort(unsigned char command, u32 value, int size)
+{
+    unsigned char frame[16];
+    int len;
+
+    frame[0] = TELNET_IAC;
+    frame[1] = TELNET_SB;
+    frame[2] = TELNET_OPT_COM_PORT;
+    frame[3] = command;
+    for (len = 4; size > 0; size--)
+    {
+        frame[len] = (value >> ((size - 1) * 8)) & 0xFF;
+        if (frame[len++] == TELNET_IAC)
+            frame[len++] = TELNET_IAC;
+    }
+    frame[len++] = TELNET_IAC;
+    frame[len++] = TELNET_SE;
+    PlatWriteNetPort((const char *)frame, len);
+}
+
+// Only binary transmission, suppress go-ahead and COM Port Control are supported.
+static void NetNegotiate(unsigned char verb, unsigned char option)
+{
+    LogPrintf(LOG_WIRE, LOG_DEBUG, "Telnet: %u %u\n", verb, option);
+
+    if (verb == TELNET_DO && option != TELNET_OPT_BINARY && option != TELNET_OPT_SGA && option != TELNET_OPT_COM_PORT)
+        NetSendOption(TELNET_WONT, option);
+    else if (verb == TELNET_WILL && option != TELNET_OPT_BINARY && option != TELNET_OPT_SGA)
+        NetSendOption(TELNET_DONT, option);
+}
+
+static void NetSubnegotiate(void)
+{
+    if (NetSubLen >= 6 && NetSub[0] == TELNET_OPT_COM_PORT && NetSub[1] == COM_PORT_SERVER + COM_PORT_SET_BAUDRATE)
+        NetBaudRate = ((u32)NetSub[2] << 24) | ((u32)NetSub[3] << 16) | ((u32)NetSub[4] << 8) | NetSub[5];
+}
+
+// Removes the Telnet commands from the received data, in place. Returns the number of data bytes left.
+static int NetDecode(unsigned char *data, int n)
+{
+    int i, len;
+    unsigned char c;
+
+    for (i = 0, len = 0; i < n; i++)
+    {
+        c = data[i];
+        switch (NetState)
+        {
+            case NET_STATE_DATA:
+                if (c == TELNET_IAC)
+                    NetState = NET_STATE_IAC;
+                else
+                    data[len++] = c;
+                break;
+            case NET_STATE_IAC:
+                if (c == TELNET_IAC)
+                { // Escaped 0xFF
+                    data[len++] = c;
+                    NetState    = NET_STATE_DATA;
+                }
+                else if (c >= TELNET_WILL && c <= TELNET_DONT)
+                {
+                    NetVerb  = c;
+                    NetState = NET_STATE_OPTION;
+                }
+                else if (c == TELNET_SB)
+                {
+                    NetSubLen = 0;
+                    NetState  = NET_STATE_SB;
+                }
+                else
+                    NetState = NET_STATE_DATA; // NOP, GA and the like.
+                break;
+            case NET_STATE_OPTION:
+                NetNegotiate(NetVerb, c);
+                NetState = NET_STATE_DATA;
+                break;
+            case NET_STATE_SB:
+                if (c == TELNET_IAC)
+                    NetState = NET_STATE_SB_IAC;
+                else if (NetSubLen < sizeof(NetSub))
+                    NetSub[NetSubLen++] = c;
+                break;
+            case NET_STATE_SB_IAC:
+                if (c == TELNET_SE)
+                {
+                    NetSubnegotiate();
+                    NetState = NET_STATE_DATA;
+                }
+                else
+                {
+                    if (NetSubLen < sizeof(NetSub))
+                        NetSub[NetSubLen++] = c;
+                    NetState = NET_STATE_SB;
+                }
+                break;
+        }
+    }
+
+    return len;
+}
+
+static int NetRead(char *data, int n, unsigned short timeout)
+{
+    u64 deadline, now;
+    int result;
+
+    deadline = PlatGetTime() + timeout * 1000000ULL;
+    while (NetRxPos >= NetRxLen)
+    {
+        now = PlatGetTime();
+        if ((result = PlatReadNetPort((char *)NetRx, sizeof(NetRx), now < deadline ? (unsigned short)((deadline - now) / 1000000ULL) : 0)) <= 0)
+            return result;
+
+        NetRxPos = 0;
+        NetRxLen = telnet ? NetDecode(NetRx, result) : result;
+        if (NetRxLen == 0 && PlatGetTime() >= deadline)
+            return 0; // Only Telnet commands were received.
+    }
+
+    if (n > NetRxLen - NetRxPos)
+        n = NetRxLen - NetRxPos;
+    memcpy(data, &NetRx[NetRxPos], n);
+    NetRxPos += n;
+
+    return n;
+}
+
+static int NetWrite(const char *data)
+{
+    char frame[MECHA_TX_BUFFER_SIZE * 2];
+    int i, len;
+
+    for (i = 0, len = 0; data[i] != '\0' && len < (int)sizeof(frame) - 1; i++)
+    {
+        frame[len++] = data[i];
+        if (telnet && (unsigned char)data[i] == TELNET_IAC)
+            frame[len++] = (char)TELNET_IAC;
+    }
+
+    return (PlatWriteNetPort(frame, len) == len ? i : -EPIPE);
+}
+
+/*  Asks the server to set its serial port up for the MECHACON, then waits for it to confirm the rate.
+    Servers that do not support COM Port Control are still used, as their ports may already be set up. */
+static void NetSetupLine(void)
+{
+    u64 deadline, now;
+    int result;
+
+    NetSendOption(TELNET_WILL, TELNET_OPT_BINARY);
+    NetSendOption(TELNET_DO, TELNET_OPT_BINARY);
+    NetSendOption(TELNET_WILL, TELNET_OPT_SGA);
+    NetSendOption(TELNET_DO, TELNET_OPT_SGA);
+    NetSendOption(TELNET_WILL, TELNET_OPT_COM_PORT);
+    NetSendComPort(COM_PORT_SET_BAUDRATE, MECHA_BAUD_RATE, 4);
+    NetSendComPort(COM_PORT_SET_DATASIZE, 8, 1);
+    NetSendComPort(COM_PORT_SET_PARITY, COM_PORT_PARITY_NONE, 1);
+    NetSendComPort(COM_PORT_SET_STOPSIZE, COM_PORT_STOPSIZE_1, 1);
+    NetSendComPort(COM_PORT_SET_CONTROL, COM_PORT_CONTROL_NONE, 1);
+
+    // Nothing was sent to the console yet, so any data received now is noise.
+    NetBaudRate = 0;
+    deadline    = PlatGetTime() + NET_CONFIRM_MS * 1000000ULL;
+    while (NetBaudRate == 0 && (now = PlatGetTime()) < deadline)
+    {
+        if ((result = PlatReadNetPort((char *)NetRx, sizeof(NetRx), (unsigned short)((deadline - now) / 1000000ULL))) <= 0)
+            break;
+        NetDecode(NetRx, result);
+    }
+
+    if (NetBaudRate == 0)
+        PlatShowMessage("The server did not confirm the line settings.\n");
+    else if (NetBaudRate != MECHA_BAUD_RATE)
+        PlatShowMessage("Warning: the server set its port to %u bps, not %u bps.\n", NetBaudRate, MECHA_BAUD_RATE);
+    else
+        PlatShowMessage("Line set to %u bps, 8N1.\n", NetBaudRate);
+}
+
+int NetOpen(const char *spec, int rfc2217)
+{
+    char host[128], port[16];
+    const char *p;
+    int len, depth, result;
+
+    // An IPv6 address must be enclosed in brackets.
+    if (spec[0] == '[' && (p = strchr(spec, ']')) != NULL)
+    {
+        len = (int)(p - spec) - 1;
+        spec++;
+        p++;
+    }
+    else
+    {
+        p   = strchr(spec, ':');
+        len = p != NULL ? (int)(p - spec) : 0;
+    }
+    if (p == NULL || *p != ':' || len <= 0 || len >= (int)sizeof(host))
+    {
+        PlatShowMessage("Syntax: %s:<host>:<port>[:<depth>]\n", rfc2217 ? "rfc2217" : "tcp");
+        return -EINVAL;
+    }
+    snprintf(host, sizeof(host), "%.*s", len, spec);
+    snprintf(port, sizeof(port), "%.*s", (int)strcspn(p + 1, ":"), p + 1);
+
+    depth = NET_PIPELINE_DEFAULT;
+    if ((p = strchr(p + 1, ':')) != NULL)
+        depth = atoi(p + 1);
+    if (depth < 1)
+        depth = 1;
+    if (depth > MECHA_PIPELINE_MAX)
+        depth = MECHA_PIPELINE_MAX;
+
+    if ((result = PlatOpenNetPort(host, port)) != 0)
+        return result;
+
+    telnet   = (unsigned char)rfc2217;
+    NetState = NET_STATE_DATA;
+    NetRxLen = NetRxPos = 0;
+    if (telnet)
+        NetSetupLine();
+
+    NetTransport.read     = &NetRead;
+    NetTransport.write    = &NetWrite;
+    NetTransport.prompt   = NULL;
+    NetTransport.times    = NULL;
+    NetTransport.pipeline = (unsigned char)depth;
+    MechaSetTransport(&NetTransport);
+    opened = 1;
+
+    if (depth > 1)
+        PlatShowMessage("Up to %d EEPROM reads are in flight at once.\n", depth);
+
+    return 0;
+}
+
+void NetClose(void)
+{
+    if (opened)
+    {
+        MechaSetTransport(NULL);
+        PlatCloseNetPort();
+        opened = 0;
+    }
+}
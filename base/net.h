@@ -0,0 +1,36 @@
+/*  Network transport: reaches the MECHACON through a serial-to-TCP server (i.e. on a remote bench).
+    Selected with one of these in place of the COM port name:
+        tcp:<host>:<port>[:<depth>]         Raw TCP: the server must already be set to 57600 bps, 8N1.
+        rfc2217:<host>:<port>[:<depth>]     Telnet with COM Port Control (RFC 2217): the line is set up by PMAP.
+    depth: number of EEPROM reads of a command list that may be in flight at once, so that the round trip of
+    the network overlaps the processing of the previous read (default 2, 1 = one command at a time). */
+#define NET_PIPELINE_DEFAULT    2
+#define NET_CONFIRM_MS          2000 // How long to wait for the server to confirm the line settings (RFC 2217).
+
+// Telnet (RFC 854)
+#define TELNET_SE               240
+#define TELNET_SB               250
+#define TELNET_WILL             251
+#define TELNET_WONT             252
+#define TELNET_DO               253
+#define TELNET_DONT             254
+#define TELNET_IAC              255
+
+#define TELNET_OPT_BINARY       0
+#define TELNET_OPT_SGA          3
+#define TELNET_OPT_COM_PORT     44
+
+// COM Port Control (RFC 2217). The server answers with the code of the command, plus COM_PORT_SERVER.
+#define COM_PORT_SET_BAUDRATE   1
+#define COM_PORT_SET_DATASIZE   2
+#define COM_PORT_SET_PARITY     3
+#define COM_PORT_SET_STOPSIZE   4
+#define COM_PORT_SET_CONTROL    5
+#define COM_PORT_SERVER         100
+
+#define COM_PORT_PARITY_NONE    1
+#define COM_PORT_STOPSIZE_1     1
+#define COM_PORT_CONTROL_NONE   1
+
+int NetOpen(const char *spec, int rfc2217);
+void NetClose(void);
@@ -1,12 +1,42 @@
 typedef unsigned char u8;
 typedef unsigned short int u16;
 typedef unsigned int u32;
+typedef unsigned long long int u64;
 
+#define PLAT_COM_PORTS 8 // COM ports that may be open at once (i.e. to clone a console onto another, or to initialize a tray of boards).
+
+int PlatEnableRTIO(int cpu); // Call before PlatOpenCOMPort(). cpu = CPU to run the I/O thread on, or -1 for any CPU.
 int PlatOpenCOMPort(const char *device);
 int PlatReadCOMPort(char *data, int n, unsigned short timeout);
 int PlatWriteCOMPort(const char *data);
 void PlatCloseCOMPort(void);
+int PlatSelectCOMPort(int port); // 0 (default) to PLAT_COM_PORTS - 1: the COM port that the functions above act on.
+/*  Times (PlatGetTime()) of the last transfers of the COM port: when the last PlatWriteCOMPort() started sending and
+    when its data was sent (drained), and when the data returned by the last PlatReadCOMPort() was received. With the
+    RT I/O thread, they are taken by that thread rather than when the calls return. */
+void PlatGetCOMPortTimes(u64 *WriteStart, u64 *WriteEnd, u64 *ReadTime);
+int PlatOpenNetPort(const char *host, const char *port); // TCP connection to a serial server.
+int PlatReadNetPort(char *data, int n, unsigned short timeout); // Returns 0 on timeout.
+int PlatWriteNetPort(const char *data, int n);
+void PlatCloseNetPort(void);
+
+/*  I/O accounting of the COM and network ports, for all ports and threads, since the last PlatResetIOStats().
+    Reads and writes include those of the notification pipes of the RT I/O thread. Empty wakeups are the waits that ended
+    without data (timeouts, or readiness with nothing to read). Blocked time is the time spent in the system calls above,
+    except for the RT I/O thread waiting for work. Times are in ns. */
+typedef struct PlatIOStats
+{
+    u64 writes, reads, selects, ReadBytes, EmptyWakeups;
+    u64 DrainTime, BlockedTime;
+} PlatIOStats_t;
+
+void PlatGetIOStats(PlatIOStats_t *stats);
+void PlatResetIOStats(void);
 void PlatSleep(unsigned short int msec);
+u64 PlatGetTime(void); // Monotonic clock, in nanoseconds.
+int PlatListFiles(const char *path, int (*callback)(const char *file, void *arg), void *arg); // Every regular file under path (recursively), or path itself if it is a file.
+int PlatRunThreads(int count, void (*function)(int thread, int count, void *arg), void *arg); // count = 0: one thread per CPU. Returns the number of threads run.
+int PlatSetCancelHandler(int (*handler)(void)); // Called on Ctrl-C. If it returns 0, the program is terminated.
 void PlatShowEMessage(const char *format, ...);
 void PlatShowMessage(const char *format, ...);
 void PlatShowMessageB(const char *format, ...);
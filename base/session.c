@@ -0,0 +1,175 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "platform.h"
+#include "session.h"
+#include "trace.h"
+
+#define SESSION_MAX_PROMPTS 48
+
+struct SessionPrompt
+{
+    const char *label;
+    unsigned int count;
+    u64 total, longest;
+};
+
+static struct SessionPrompt prompts[SESSION_MAX_PROMPTS];
+static unsigned short int PromptCount;
+static const char *WaitLabel = NULL;
+static u64 SessionStart, BusyStart, WaitStart, BusyTime, WaitTime;
+static unsigned char BusyDepth;
+
+// I/O accounting per job: a job is the work between two operator prompts, named after the prompt that started it.
+static PlatIOStats_t JobStart, JobEnd;
+static const char *JobLabel;
+static unsigned char IOReport = 0;
+
+void SessionInit(void)
+{
+    PromptCount  = 0;
+    WaitLabel    = NULL;
+    BusyDepth    = 0;
+    BusyTime     = 0;
+    WaitTime     = 0;
+    SessionStart = PlatGetTime();
+    JobLabel     = "start";
+    PlatResetIOStats();
+    PlatGetIOStats(&JobStart);
+}
+
+void SessionEnableIOReport(void)
+{
+    IOReport = 1;
+}
+
+static void SessionShowIO(const char *label, const PlatIOStats_t *start, const PlatIOStats_t *end)
+{
+    u64 reads;
+
+    reads = end->reads - start->reads;
+    PlatShowMessage("I/O %s: %llu writes, %llu reads (%.1f bytes/read), %llu selects, %llu empty wakeups, tcdrain %.3fs, blocked %.3fs\n",
+                    label, end->writes - start->writes, reads, reads > 0 ? (double)(end->ReadBytes - start->ReadBytes) / reads : 0.0,
+                    end->selects - start->selects, end->EmptyWakeups - start->EmptyWakeups,
+                    (end->DrainTime - start->DrainTime) / 1e9, (end->BlockedTime - start->BlockedTime) / 1e9);
+}
+
+// Machine-busy time is the time spent waiting on the console (commands and fixed delays).
+void SessionBusyBegin(void)
+{
+    if (BusyDepth++ == 0)
+        BusyStart = PlatGetTime();
+}
+
+void SessionBusyEnd(void)
+{
+    if (BusyDepth > 0 && --BusyDepth == 0)
+        BusyTime += PlatGetTime() - BusyStart;
+}
+
+// Operator wait time is the time spent blocked on user input.
+void SessionWaitBegin(const char *label)
+{
+    WaitLabel = label;
+    WaitStart = PlatGetTime();
+    PlatGetIOStats(&JobEnd);
+    TracePcapngFlush();
+}
+
+void SessionWaitEnd(void)
+{
+    struct SessionPrompt *prompt;
+    unsigned short int i;
+    char name[64];
+    u64 elapsed;
+
+    if (WaitLabel == NULL)
+        return;
+
+    elapsed = PlatGetTime() - WaitStart;
+    WaitTime += elapsed;
+    TraceChromeSpan(TRACE_TRACK_OPERATOR, WaitLabel, "prompt", WaitStart, WaitStart + elapsed, NULL);
+
+    for (i = 0, prompt = prompts; i < PromptCount; i++, prompt++)
+    {
+        if (!strcmp(prompt->label, WaitLabel))
+            break;
+    }
+
+    if (i == PromptCount)
+    {
+        if (PromptCount >= SESSION_MAX_PROMPTS)
+            prompt = &prompts[SESSION_MAX_PROMPTS - 1]; // Out of slots: account against the last prompt.
+        else
+        {
+            prompt          = &prompts[PromptCount++];
+            prompt->label   = WaitLabel;
+            prompt->count   = 0;
+            prompt->total   = 0;
+            prompt->longest = 0;
+        }
+    }
+
+    prompt->count++;
+    prompt->total += elapsed;
+    if (elapsed > prompt->longest)
+        prompt->longest = elapsed;
+
+    // Reported once the prompt is answered, so that the report does not come between the prompt and the cursor.
+    if (IOReport && JobEnd.writes + JobEnd.reads + JobEnd.selects > JobStart.writes + JobStart.reads + JobStart.selects)
+    {
+        snprintf(name, sizeof(name), "after \"%s\"", JobLabel);
+        SessionShowIO(name, &JobStart, &JobEnd);
+    }
+    PlatGetIOStats(&JobStart);
+    JobLabel  = WaitLabel;
+    WaitLabel = NULL;
+}
+
+void SessionReport(void)
+{
+    struct SessionPrompt *prompt, temp;
+    PlatIOStats_t none, io;
+    unsigned short int i, j;
+    u64 total, other;
+
+    total = PlatGetTime() - SessionStart;
+    // The remainder is spent by the host (e.g. menus, file I/O and the processing between commands), not necessarily with the link idle.
+    other = (total > BusyTime + WaitTime) ? total - BusyTime - WaitTime : 0;
+
+    // Longest total wait first.
+    for (i = 1; i < PromptCount; i++)
+    {
+        for (j = i; j > 0 && prompts[j].total > prompts[j - 1].total; j--)
+        {
+            temp           = prompts[j];
+            prompts[j]     = prompts[j - 1];
+            prompts[j - 1] = temp;
+        }
+    }
+
+    PlatShowMessage("\nSession time:\t%8.1fs\n"
+                    "Machine busy:\t%8.1fs (%4.1f%%)\n"
+                    "Operator wait:\t%8.1fs (%4.1f%%)\n"
+                    "Host/other:\t%8.1fs (%4.1f%%)\n",
+                    total / 1e9,
+                    BusyTime / 1e9, total > 0 ? BusyTime * 100.0 / total : 0.0,
+                    WaitTime / 1e9, total > 0 ? WaitTime * 100.0 / total : 0.0,
+                    other / 1e9, total > 0 ? other * 100.0 / total : 0.0);
+
+    if (PromptCount > 0)
+    {
+        PlatShowMessage("\nOperator wait per prompt:\n"
+                        "    Count     Total   Longest  Prompt\n");
+        for (i = 0, prompt = prompts; i < PromptCount; i++, prompt++)
+            PlatShowMessage("%9u %8.1fs %8.1fs  %s\n", prompt->count, prompt->total / 1e9, prompt->longest / 1e9, prompt->label);
+    }
+
+    PlatGetIOStats(&io);
+    if (io.writes + io.reads + io.selects > 0)
+    {
+        memset(&none, 0, sizeof(none));
+        PlatShowMessage("\n");
+        SessionShowIO("total", &none, &io);
+    }
+}
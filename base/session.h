@@ -0,0 +1,9 @@
+// Session time accounting: machine-busy time, operator wait time (per prompt) and the remainder (host/other).
+// With SessionEnableIOReport(), the I/O of the ports (see PlatGetIOStats()) is also shown for every job between two prompts.
+void SessionInit(void);
+void SessionBusyBegin(void);
+void SessionBusyEnd(void);
+void SessionWaitBegin(const char *label);
+void SessionWaitEnd(void);
+void SessionEnableIOReport(void);
+void SessionReport(void);
@@ -0,0 +1,558 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "platform.h"
+#include "log.h"
+#include "mecha.h"
+#include "eeprom.h"
+#include "sim.h"
+
+#define SIM_LINE_RATE (MECHA_BAUD_RATE / 10) // Bytes per second (8N1).
+#define SIM_NO_WORD   0xFFFF
+
+struct SimProfile
+{
+    const char *name, *desc;
+    const char *cfd, *cfc, *rtc;
+    u16 ConWord, con, opt12, opt13;
+    float timing;                         // Processing delays, relative to the MD1.39 MECHACON.
+    u16 CDminWord, CDmaxWord, DVDminWord; // Where DETECT ADJUSTMENT stores its results.
+    u16 CDmin, CDmax, DVDmin;
+    u16 jitter;                           // Mean DVD jitter (256).
+    char DVDDetectAdj;                    // Status returned by the DVD-SL DETECT ADJUSTMENT.
+};
+
+static const struct SimProfile SimProfiles[] = {
+    {"md36", "A-chassis (MD1.36)", "00000024", "00010100", "308801151803258401", EEPROM_MAP_CON, MECHA_CHASSIS_A, 0x98c9, 0x7878, 1.3f, 0x0002, 0x0003, 0x0004, 700, 1500, 300, 0x0c00, '1'},
+    {"md38", "AB-chassis (MD1.38)", "00000026", "00030100", "308801151803258401", EEPROM_MAP_CON, MECHA_CHASSIS_AB, 0x6d8f, 0x6f6f, 1.2f, 0x0002, 0x0003, 0x0004, 700, 1500, 300, 0x0c00, '0'},
+    {"md39", "B/C/D-chassis (MD1.39)", "00000027", "00020200", "308801151803258401", EEPROM_MAP_CON, MECHA_CHASSIS_BCD, 0x6d8f, 0x6f6f, 1.0f, 0x0002, 0x0003, 0x0004, 680, 1500, 300, 0x0c00, '0'},
+    {"f", "F-chassis (MD1.39)", "00000027", "00020301", "308801151803258401", EEPROM_MAP_CON, MECHA_CHASSIS_F_SONY, 0x6b8b, 0x4f6f, 1.0f, 0x0002, 0x0003, 0x0004, 660, 1500, 300, 0x0c00, '0'},
+    {"g", "G-chassis (MD1.39)", "00000027", "00060301", "308801151803258401", EEPROM_MAP_CON, MECHA_CHASSIS_G_SONY, 0x6d8f, 0x6f6f, 0.9f, 0x0002, 0x0003, 0x0004, 660, 1800, 300, 0x2000, '0'},
+    {"g2", "G-chassis with newer MECHACON (MD1.39)", "00000027", "00080300", "308801151803258401", EEPROM_MAP_CON, MECHA_CHASSIS_G_SONY, 0x6d8f, 0x6f6f, 0.9f, 0x0002, 0x0003, 0x0004, 660, 1800, 300, 0x2000, '0'},
+    {"md40", "H-chassis (Dragon, MD1.40)", "0311202005", "000e0502", "300001431800221001", EEPROM_MAP_CON_NEW, MECHA_CHASSIS_H_SONY, 0x0000, 0x0000, 0.8f, SIM_NO_WORD, 0x0034, 0x0035, 0, 1800, 300, 0x2000, '0'},
+    {"slim", "Slim (Dragon, MD1.40)", "0701290347", "00120603", "300001431800221001", EEPROM_MAP_CON_NEW, MECHA_CHASSIS_SLIM, 0x0000, 0x0000, 0.8f, SIM_NO_WORD, 0x0034, 0x0035, 0, 1800, 300, 0x2000, '0'},
+    {NULL, NULL, NULL, NULL, NULL, 0, 0, 0, 0, 0.0f, 0, 0, 0, 0, 0, 0, 0, 0}};
+
+// Processing delays (mean and standard deviation, in ms) of the MD1.39 MECHACON.
+static const struct SimDelay
+{
+    unsigned short int command;
+    unsigned short int mean, sd;
+} SimDelays[] = {
+    {MECHA_CMD_EEPROM_READ, 6, 1},
+    {MECHA_CMD_EEPROM_WRITE, 12, 2},
+    {MECHA_CMD_EEPROM_ERASE, 1500, 100},
+    {MECHA_CMD_WRITE_CHECKSUM, 300, 30},
+    {MECHA_CMD_READ_CHECKSUM, 80, 10},
+    {MECHA_CMD_UPLOAD_TO_RAM, 100, 10},
+    {MECHA_CMD_DISC_MODE_CD_8, 50, 5},
+    {MECHA_CMD_DISC_MODE_CD_12, 50, 5},
+    {MECHA_CMD_DISC_MODE_DVDSL_8, 50, 5},
+    {MECHA_CMD_DISC_MODE_DVDDL_8, 50, 5},
+    {MECHA_CMD_DISC_MODE_DVDSL_12, 50, 5},
+    {MECHA_CMD_DISC_MODE_DVDDL_12, 50, 5},
+    {MECHA_CMD_DISC_DETECT, 2500, 400},
+    {MECHA_CMD_FOCUS_UPDOWN, 400, 50},
+    {MECHA_CMD_FOCUS_AUTO_START, 300, 50},
+    {MECHA_CMD_FCS_SEARCH_CHECK, 8000, 1200},
+    {MECHA_CMD_SLED_POS_HOME, 800, 200},
+    {MECHA_CMD_TRAY, 2500, 300},
+    {MECHA_CMD_SP_CTL, 600, 100},
+    {MECHA_CMD_DETECT_ADJ, 3000, 400},
+    {MECHA_CMD_AUTO_ADJ_ST_1, 5000, 800},
+    {MECHA_CMD_AUTO_ADJ_ST_2, 5000, 800},
+    {MECHA_CMD_AUTO_ADJ_ST_12, 8000, 1200},
+    {MECHA_CMD_AUTO_ADJ_ST_2MD, 5000, 800},
+    {MECHA_CMD_AUTO_ADJ_FIX_GAIN, 4000, 600},
+    {MECHA_CMD_RFDC_LEVEL, 500, 50},
+    {MECHA_CMD_TPP, 500, 50},
+    {MECHA_CMD_MIRR_CHECK, 500, 50},
+    {MECHA_CMD_FE_OFFSET, 1500, 200},
+    {MECHA_CMD_CD_PLAY_1, 1000, 150},
+    {MECHA_CMD_DVD_PLAY_1, 1000, 150},
+    {MECHA_CMD_FOCUS_JUMP, 500, 80},
+    {MECHA_CMD_FOCUS_JUMP_NEW, 500, 80},
+    {MECHA_CMD_GAIN, 300, 40},
+    {MECHA_CMD_JITTER, 400, 50},
+    {MECHA_CMD_DSP_ERROR_RATE, 1500, 200},
+    {0, 20, 3}};
+
+static const struct SimProfile *profile;
+static MechaTransport_t SimTransport;
+static float SimSpeed;
+static u32 SimSeed;
+static u16 SimEEPROM[0x200];
+static char SimRTC[19];
+static unsigned char SimDisc, SimMode, SimLayer; // Inserted disc, working mode and DVD-DL layer.
+static unsigned char SimPlay;                    // Play speed (1-5 for a CD, 1-3 for a DVD), 0 when stopped.
+
+static char SimTxBuffer[MECHA_TX_BUFFER_SIZE];
+static unsigned char SimTxLen;
+static char SimRxBuffer[MECHA_RX_BUFFER_SIZE + 2];
+static unsigned char SimRxLen, SimRxPos;
+static u64 SimRxReady;
+
+// xorshift32, so that runs are reproducible on every platform.
+static u32 SimRandom(void)
+{
+    SimSeed ^= SimSeed << 13;
+    SimSeed ^= SimSeed >> 17;
+    SimSeed ^= SimSeed << 5;
+    return SimSeed;
+}
+
+// Approximately normal (sum of 12 uniform samples).
+static float SimGauss(float mean, float sd)
+{
+    float sum;
+    int i;
+
+    for (i = 0, sum = 0.0f; i < 12; i++)
+        sum += (SimRandom() & 0xFFFF) / 65536.0f;
+
+    return mean + sd * (sum - 6.0f);
+}
+
+static unsigned int SimValue(float mean, float sd, unsigned int max)
+{
+    float value;
+
+    value = SimGauss(mean, sd);
+    if (value < 0.0f)
+        return 0;
+
+    return value > max ? max : (unsigned int)(value + 0.5f);
+}
+
+static unsigned int SimGetDelay(unsigned short int command, const char *args)
+{
+    const struct SimDelay *delay;
+
+    // Writing the detected values to the EEPROM (03) does not involve the mechanics.
+    if (command == MECHA_CMD_DETECT_ADJ && !strcmp(args, "03"))
+        command = MECHA_CMD_EEPROM_WRITE;
+    // Treat all play commands like the 1x play command.
+    else if (command >= MECHA_CMD_CD_PLAY_1 && command <= MECHA_CMD_CD_PLAY_5 && command != MECHA_CMD_CD_STOP)
+        command = MECHA_CMD_CD_PLAY_1;
+    else if (command >= MECHA_CMD_DVD_PLAY_1 && command <= MECHA_CMD_DVD_PLAY_3)
+        command = MECHA_CMD_DVD_PLAY_1;
+
+    for (delay = SimDelays; delay->command != 0 && delay->command != command; delay++)
+        ;
+
+    return SimValue(delay->mean * profile->timing, delay->sd * profile->timing, 60000);
+}
+
+static void SimDetectAdjust(u16 word, u16 mean)
+{
+    if (word != SIM_NO_WORD)
+        SimEEPROM[word] = (u16)SimValue(mean, mean * 0.04f, 0xFFFF);
+}
+
+static void SimExecute(unsigned short int command, const char *args, char *response, int size)
+{
+    unsigned int word, value, value2, level;
+    char address[5];
+    float strain;
+    int IsDVD;
+
+    IsDVD  = (SimMode >= DISC_TYPE_DVDS8 && SimMode <= DISC_TYPE_DVDD12);
+    strain = SimPlay > 1 ? 1.0f + 0.1f * (SimPlay - 1) * (SimPlay - 1) : 1.0f; // Errors and jitter grow with the speed.
+
+    switch (command)
+    {
+        case MECHA_CMD_READ_MODEL:
+            snprintf(response, size, "0%s", profile->cfd);
+            break;
+        case MECHA_CMD_READ_MODEL_2:
+            snprintf(response, size, "0%s", profile->cfc);
+            break;
+        case MECHA_CMD_READ_CHECKSUM:
+            snprintf(response, size, "000");
+            break;
+        case MECHA_CMD_RTC_READ:
+            snprintf(response, size, "0%s", SimRTC);
+            break;
+        case MECHA_CMD_RTC_WRITE:
+            if (strlen(args) == 18)
+            {
+                strcpy(SimRTC, args);
+                snprintf(response, size, "0");
+            }
+            else
+                snprintf(response, size, "2A1");
+            break;
+        case MECHA_CMD_EEPROM_READ:
+            if (strlen(args) != 4)
+                snprintf(response, size, "2A1");
+            else if ((word = strtoul(args, NULL, 16)) >= 0x200)
+                snprintf(response, size, "2A2");
+            else
+                snprintf(response, size, "0%04x%04x", word, SimEEPROM[word]);
+            break;
+        case MECHA_CMD_EEPROM_WRITE:
+            if (strlen(args) != 8)
+                snprintf(response, size, "2A1");
+            else
+            {
+                value = strtoul(&args[4], NULL, 16);
+                strncpy(address, args, 4);
+                address[4] = '\0';
+                if ((word = strtoul(address, NULL, 16)) >= 0x200)
+                    snprintf(response, size, "2A2");
+                else
+                {
+                    SimEEPROM[word] = (u16)value;
+                    if (profile->ConWord == EEPROM_MAP_CON_NEW) // The Dragon does not echo the written word.
+                        snprintf(response, size, "0");
+                    else
+                        snprintf(response, size, "0%s", args);
+                }
+            }
+            break;
+        case MECHA_CMD_EEPROM_ERASE:
+            memset(SimEEPROM, 0xFF, sizeof(SimEEPROM));
+            snprintf(response, size, "0");
+            break;
+        case MECHA_CMD_DISC_MODE_CD_8:
+        case MECHA_CMD_DISC_MODE_CD_12:
+        case MECHA_CMD_DISC_MODE_DVDSL_8:
+        case MECHA_CMD_DISC_MODE_DVDDL_8:
+        case MECHA_CMD_DISC_MODE_DVDSL_12:
+        case MECHA_CMD_DISC_MODE_DVDDL_12:
+            SimMode  = DISC_TYPE_CD8 + (command - MECHA_CMD_DISC_MODE_CD_8);
+            SimLayer = 0;
+            SimPlay  = 0;
+            snprintf(response, size, "0");
+            break;
+        case MECHA_CMD_CD_PLAY_1:
+        case MECHA_CMD_CD_PLAY_2:
+        case MECHA_CMD_CD_PLAY_3:
+        case MECHA_CMD_CD_PLAY_4:
+            SimPlay = 1 + (command - MECHA_CMD_CD_PLAY_1);
+            snprintf(response, size, "0");
+            break;
+        case MECHA_CMD_CD_PLAY_5:
+            SimPlay = 5;
+            snprintf(response, size, "0");
+            break;
+        case MECHA_CMD_DVD_PLAY_1:
+        case MECHA_CMD_DVD_PLAY_2:
+        case MECHA_CMD_DVD_PLAY_3:
+            SimPlay = 1 + (command - MECHA_CMD_DVD_PLAY_1);
+            snprintf(response, size, "0");
+            break;
+        case MECHA_CMD_CD_STOP:
+        case MECHA_CMD_DVD_STOP:
+            SimPlay = 0;
+            snprintf(response, size, "0");
+            break;
+        case MECHA_CMD_DISC_DETECT:
+            SimMode = SimDisc;
+            snprintf(response, size, "0%03x", SimDisc);
+            break;
+        case MECHA_CMD_DISC_CUR_MODE:
+            snprintf(response, size, "0%03x", SimMode);
+            break;
+        case MECHA_CMD_FOCUS_JUMP:
+        case MECHA_CMD_FOCUS_JUMP_NEW:
+            if (SimMode == DISC_TYPE_DVDD8 || SimMode == DISC_TYPE_DVDD12)
+            {
+                SimLayer ^= 1;
+                snprintf(response, size, "0");
+            }
+            else
+                snprintf(response, size, "1");
+            break;
+        case MECHA_CMD_DETECT_ADJ:
+            if (!strcmp(args, "00"))
+            {
+                SimDetectAdjust(profile->CDminWord, profile->CDmin);
+                SimDetectAdjust(profile->CDmaxWord, profile->CDmax);
+                snprintf(response, size, "0");
+            }
+            else if (!strcmp(args, "01") && profile->DVDDetectAdj != '0')
+                snprintf(response, size, "%c", profile->DVDDetectAdj);
+            else
+            {
+                if (!strcmp(args, "01"))
+                    SimDetectAdjust(profile->DVDminWord, profile->DVDmin);
+                snprintf(response, size, "0");
+            }
+            break;
+        case MECHA_CMD_GAIN:
+            if (!strcmp(args, "13")) // FE loop gain
+                snprintf(response, size, "0%02x", SimValue(0x30, 4, 0xFF));
+            else // TE loop gain
+                snprintf(response, size, "0%02x", SimValue(0x38, 5, 0xFF));
+            break;
+        case MECHA_CMD_JITTER:
+            snprintf(response, size, "0%04x", SimValue(profile->jitter * (SimLayer ? 1.15f : 1.0f) * strain, profile->jitter * 0.1f, 0xFFFF));
+            break;
+        case MECHA_CMD_CD_ERROR: // C1, C2
+            snprintf(response, size, "0%04x%04x", SimValue(20 * strain, 6 * strain, 0xFFFF), SimPlay >= 5 ? SimValue(1, 1, 0xFFFF) : 0);
+            break;
+        case MECHA_CMD_DSP_ERROR_RATE:
+            if (!strcmp(args, "05")) // PO-NCC
+                snprintf(response, size, "00000");
+            else if (!strcmp(args, "00")) // PI-CC, PI-NCC, PI max, PO-CC, PO-NCC, PO max, jitter
+                snprintf(response, size, "0%04x%04x%04x%04x%04x%04x%04x", SimValue(12 * strain, 6, 0xFFFF), SimPlay >= 3 ? SimValue(1, 1, 0xFFFF) : 0,
+                         SimValue(4 * strain, 1, 0xFFFF), SimValue(2 * strain, 1, 0xFFFF), 0, SimValue(1, 1, 0xFFFF),
+                         SimValue(profile->jitter * (SimLayer ? 1.15f : 1.0f) * strain, profile->jitter * 0.1f, 0xFFFF));
+            else
+                snprintf(response, size, "0%04x", SimValue(12, 6, 0xFFFF));
+            break;
+        case MECHA_CMD_FCS_SEARCH_CHECK:
+            snprintf(response, size, "0%04x%04x", 0x400, SimValue(0x400, 0x400 * 0.03f, 0xFFFF));
+            break;
+        case MECHA_CMD_RFDC_LEVEL:
+            level = SimValue(IsDVD ? 0x50 : 0x68, 6, 0xA0);
+            snprintf(response, size, "0%02x%02x", 0xA0, 0xA0 - level);
+            break;
+        case MECHA_CMD_TPP:
+            value  = 0x40;
+            level  = SimValue(0x58, 5, 0xBF);
+            value2 = value + SimValue(level / 2.0f, 2, 0xFF - value);
+            snprintf(response, size, "0%02x%02x%02x", value + level, value, value2);
+            break;
+        case MECHA_CMD_FE_OFFSET:
+            value  = 0x40;
+            value2 = value + SimValue(0x40, 3, 0xBF);
+            snprintf(response, size, "000%02x%02x0000%02x", 0xC0, value, value2);
+            break;
+        case MECHA_CMD_MIRR_CHECK:
+            snprintf(response, size, "001");
+            break;
+        default:
+            snprintf(response, size, "0");
+    }
+}
+
+// The simulated operator does what the prompt asks for.
+static void SimPrompt(const char *label)
+{
+    if (strstr(label, "DVD-DL") != NULL)
+        SimDisc = DISC_TYPE_DVDD12;
+    else if (strstr(label, "DVD-SL") != NULL)
+        SimDisc = DISC_TYPE_DVDS12;
+    else if (strstr(label, "CD") != NULL)
+        SimDisc = (strstr(label, "8cm") != NULL) ? DISC_TYPE_CD8 : DISC_TYPE_CD12;
+    else if (strstr(label, "Remove") != NULL || strstr(label, "remove") != NULL)
+        SimDisc = DISC_TYPE_NO_DISC;
+}
+
+static int SimWrite(const char *data)
+{
+    unsigned short int command;
+    unsigned int delay, len;
+    char code[4];
+
+    for (len = 0; data[len] != '\0'; len++)
+    {
+        if (SimTxLen < sizeof(SimTxBuffer) - 1)
+            SimTxBuffer[SimTxLen++] = data[len];
+
+        if (SimTxLen >= 2 && SimTxBuffer[SimTxLen - 2] == '\r' && SimTxBuffer[SimTxLen - 1] == '\n')
+        {
+            SimTxBuffer[SimTxLen - 2] = '\0';
+            memcpy(code, SimTxBuffer, 3);
+            code[3] = '\0';
+            command = (unsigned short int)strtoul(code, NULL, 16);
+
+            if (strlen(SimTxBuffer) < 3)
+                snprintf(SimRxBuffer, sizeof(SimRxBuffer) - 2, "2A0");
+            else
+                SimExecute(command, &SimTxBuffer[3], SimRxBuffer, sizeof(SimRxBuffer) - 2);
+            delay = SimGetDelay(command, &SimTxBuffer[3]);
+            strcat(SimRxBuffer, "\r\n");
+            SimRxLen = strlen(SimRxBuffer);
+            SimRxPos = 0;
+
+            // Time on the wire (command and response), then the processing time of the MECHACON.
+            SimRxReady = PlatGetTime();
+            if (SimSpeed > 0.0f)
+                SimRxReady += (u64)((((SimTxLen + SimRxLen) * 1000000000ULL) / SIM_LINE_RATE + delay * 1000000ULL) / SimSpeed);
+
+            LogPrintf(LOG_WIRE, LOG_DEBUG, "SIM: %s -> %.*s (%u ms)\n", SimTxBuffer, SimRxLen - 2, SimRxBuffer, delay);
+            SimTxLen = 0;
+        }
+    }
+
+    return len;
+}
+
+static void SimWait(u64 ns)
+{
+    u64 ms;
+
+    for (ms = ns / 1000000; ms > 0; ms -= (ms > 60000 ? 60000 : ms))
+        PlatSleep((unsigned short int)(ms > 60000 ? 60000 : ms));
+}
+
+static int SimRead(char *data, int n, unsigned short timeout)
+{
+    u64 now, limit;
+    int len;
+
+    // Timeouts pass at the simulated speed too.
+    limit = SimSpeed > 0.0f ? (u64)(timeout * 1000000ULL / SimSpeed) : 0;
+
+    if (SimRxPos >= SimRxLen)
+    { // Nothing to send.
+        SimWait(limit);
+        return 0;
+    }
+
+    now = PlatGetTime();
+    if (SimRxReady > now)
+    {
+        if (SimRxReady - now > limit)
+        { // The response will arrive after the timeout.
+            SimWait(limit);
+            return 0;
+        }
+        SimWait(SimRxReady - now);
+    }
+
+    len = SimRxLen - SimRxPos < n ? SimRxLen - SimRxPos : n;
+    memcpy(data, &SimRxBuffer[SimRxPos], len);
+    SimRxPos += len;
+
+    return len;
+}
+
+int SimOpen(const char *spec)
+{
+    char name[16];
+    const char *p;
+    u16 word;
+    int len;
+
+    len = (p = strchr(spec, ':')) != NULL ? (int)(p - spec) : (int)strlen(spec);
+    snprintf(name, sizeof(name), "%.*s", len, spec);
+
+    for (profile = SimProfiles; profile->name != NULL; profile++)
+    {
+        if (!pstricmp(profile->name, name))
+            break;
+    }
+    if (profile->name == NULL)
+    {
+        PlatShowMessage("Unknown simulator profile: %s\n", name);
+        SimListProfiles();
+        profile = NULL;
+        return -EINVAL;
+    }
+
+    SimSpeed = 1.0f;
+    SimSeed  = 1;
+    if (p != NULL)
+    {
+        SimSpeed = (float)atof(p + 1);
+        if ((p = strchr(p + 1, ':')) != NULL)
+            SimSeed = (u32)strtoul(p + 1, NULL, 0);
+    }
+    if (SimSpeed < 0.0f)
+        SimSpeed = 1.0f;
+    if (SimSeed == 0)
+        SimSeed = 1;
+
+    memset(SimEEPROM, 0, sizeof(SimEEPROM));
+    SimEEPROM[profile->ConWord]   = profile->con;
+    SimEEPROM[EEPROM_MAP_OPT_12]  = profile->opt12;
+    SimEEPROM[EEPROM_MAP_OPT_13]  = profile->opt13;
+    SimEEPROM[0x004c]             = 0x0002; // DE-FOCUS offset
+    SimEEPROM[0x0057]             = 0x1020; // FB offset
+    if (profile->ConWord != EEPROM_MAP_CON_NEW)
+        SimEEPROM[0x0001] = 0x00c8; // DVD-SL pull-in level
+    // A SONY i.Link ID (08:00:46) that differs with the seed, so that simulated consoles can be told apart.
+    word                = profile->ConWord == EEPROM_MAP_CON_NEW ? EEPROM_MAP_ILINK_ID_NEW_0 : EEPROM_MAP_ILINK_ID_0;
+    SimEEPROM[word]     = 0x0008;
+    SimEEPROM[word + 1] = 0x0046;
+    SimEEPROM[word + 2] = (u16)(SimSeed >> 16);
+    SimEEPROM[word + 3] = (u16)SimSeed;
+    SimDetectAdjust(profile->CDminWord, profile->CDmin);
+    SimDetectAdjust(profile->CDmaxWord, profile->CDmax);
+    SimDetectAdjust(profile->DVDminWord, profile->DVDmin);
+    strcpy(SimRTC, profile->rtc);
+    SimDisc  = DISC_TYPE_NO_DISC;
+    SimMode  = DISC_TYPE_CD12;
+    SimLayer = 0;
+    SimPlay  = 0;
+    SimTxLen = 0;
+    SimRxLen = 0;
+    SimRxPos = 0;
+
+    SimTransport.read   = &SimRead;
+    SimTransport.write  = &SimWrite;
+    SimTransport.prompt = &SimPrompt;
+    SimTransport.times  = NULL;
+    MechaSetTransport(&SimTransport);
+
+    if (SimSpeed > 0.0f)
+        PlatShowMessage("Simulating %s at %gx speed.\n", profile->desc, SimSpeed);
+    else
+        PlatShowMessage("Simulating %s without delays.\n", profile->desc);
+
+    return 0;
+}
+
+void SimClose(void)
+{
+    if (profile != NULL)
+    {
+        MechaSetTransport(NULL);
+        profile = NULL;
+    }
+}
+
+/*  Runs the simulator as the console end of a serial link (i.e. a pty), until the link is closed.
+    Commands are received with receive() and the responses are sent with send() when they are ready. */
+int SimServe(const char *spec, SimReceiveHandler_t receive, SimSendHandler_t send)
+{
+    char data[MECHA_TX_BUFFER_SIZE], command[MECHA_TX_BUFFER_SIZE], response[MECHA_RX_BUFFER_SIZE + 2];
+    int result, i, len, ready;
+
+    if ((result = SimOpen(spec)) != 0)
+        return result;
+
+    while ((result = receive(data, sizeof(data))) > 0)
+    {
+        // Commands that were sent ahead (pipelined) wait for the response to the previous one, one at a time.
+        for (i = 0; i < result; i += len)
+        {
+            for (len = 0; i + len < result && len < (int)sizeof(command) - 1;)
+            {
+                command[len] = data[i + len];
+                if (command[len++] == '\n')
+                    break;
+            }
+            command[len] = '\0';
+            SimWrite(command);
+
+            while (SimRxPos < SimRxLen)
+            {
+                if ((ready = SimRead(response, sizeof(response), 0xFFFF)) > 0 && send(response, ready) != ready)
+                {
+                    SimClose();
+                    return -EPIPE;
+                }
+            }
+        }
+    }
+
+    SimClose();
+
+    return result;
+}
+
+void SimListProfiles(void)
+{
+    const struct SimProfile *p;
+
+    PlatShowMessage("Simulator profiles:\n");
+    for (p = SimProfiles; p->name != NULL; p++)
+        PlatShowMessage("\t%s\t%s\n", p->name, p->desc);
+}
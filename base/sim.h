@@ -0,0 +1,12 @@
+/*  Console simulator: answers MECHACON commands like a console of the selected chassis would,
+    with processing delays and measured values drawn from per-chassis distributions.
+    Selected with "sim:<profile>[:<speed>[:<seed>]]" in place of the COM port name.
+        speed: 1 = real time (default), 10 = ten times faster, 0 = no delays.
+        seed: seed for the measured values and delays, for reproducible runs. */
+typedef int (*SimReceiveHandler_t)(char *data, int n);
+typedef int (*SimSendHandler_t)(const char *data, int n);
+
+int SimOpen(const char *spec);
+void SimClose(void);
+int SimServe(const char *spec, SimReceiveHandler_t receive, SimSendHandler_t send);
+void SimListProfiles(void);
@@ -0,0 +1,826 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+
+#include "platform.h"
+#include "mecha.h"
+#include "trace.h"
+
+struct TraceEvent
+{
+    u64 time;
+    unsigned int seq;
+    unsigned char type;
+    char data[TRACE_DATA_MAX];
+};
+
+struct Trace
+{
+    struct TraceEvent *events;
+    unsigned int count, size;
+};
+
+struct TraceFrame
+{
+    u64 time;
+    unsigned char type, port, len, OrigLen;
+    char data[TRACE_RING_DATA];
+};
+
+static const char *TraceEventNames[] = {"TX", "RX", "STAGE"};
+static FILE *TraceFile = NULL, *ChromeFile = NULL, *PcapngFile = NULL;
+static u64 TraceStart, ChromeStart;
+static unsigned int ChromeEvents;
+static struct TraceFrame TraceRing[TRACE_RING_FRAMES];
+static unsigned int TraceRingCount; // Frames recorded since PMAP started, including those that were overwritten.
+static char PcapngPort[128];
+static unsigned int PcapngWritten; // Value of TraceRingCount up to which the frames were written.
+static unsigned char PcapngPorts;  // Interfaces described so far.
+static u64 PcapngEpoch;
+
+static void TraceWrite(FILE *file, u64 time, unsigned char type, const char *data)
+{
+    fprintf(file, "%llu %s %.*s\n", time, TraceEventNames[type], (int)strcspn(data, "\r\n"), data);
+}
+
+int TraceOpen(const char *filename)
+{
+    if ((TraceFile = fopen(filename, "w")) == NULL)
+        return -EIO;
+
+    TraceStart = PlatGetTime();
+    fprintf(TraceFile, TRACE_HEADER "\n");
+
+    return 0;
+}
+
+void TraceClose(void)
+{
+    if (TraceFile != NULL)
+    {
+        fclose(TraceFile);
+        TraceFile = NULL;
+    }
+}
+
+// time: PlatGetTime() value of the event (for frames, as taken by the I/O thread where there is one).
+void TraceRecord(unsigned char type, u64 time, const char *data)
+{
+    if (TraceFile != NULL)
+        TraceWrite(TraceFile, time > TraceStart ? time - TraceStart : 0, type, data);
+}
+
+/*  Chrome trace-event export (JSON array format), for Perfetto and chrome://tracing.
+    Spans are complete ("X") events, with times in microseconds since the file was opened. */
+static void TraceChromeString(const char *text)
+{
+    for (; *text != '\0'; text++)
+    {
+        if (*text == '"' || *text == '\\')
+            fprintf(ChromeFile, "\\%c", *text);
+        else if ((unsigned char)*text < 0x20)
+            fprintf(ChromeFile, "\\u%04x", (unsigned char)*text);
+        else
+            fputc(*text, ChromeFile);
+    }
+}
+
+static void TraceChromeBeginEvent(void)
+{
+    fprintf(ChromeFile, ChromeEvents++ > 0 ? ",\n" : "\n");
+}
+
+static void TraceChromeTrackName(unsigned char track, const char *name)
+{
+    TraceChromeBeginEvent();
+    fprintf(ChromeFile, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"", track);
+    TraceChromeString(name);
+    fprintf(ChromeFile, "\"}}");
+}
+
+int TraceChromeOpen(const char *filename, const char *port)
+{
+    if ((ChromeFile = fopen(filename, "w")) == NULL)
+        return -EIO;
+
+    ChromeStart  = PlatGetTime();
+    ChromeEvents = 0;
+    fprintf(ChromeFile, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    TraceChromeBeginEvent();
+    fprintf(ChromeFile, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"PMAP\"}}");
+    TraceChromeTrackName(TRACE_TRACK_PORT, port);
+    TraceChromeTrackName(TRACE_TRACK_OPERATOR, "Operator");
+    TraceChromeTrackName(TRACE_TRACK_STAGE, "Stages");
+
+    return 0;
+}
+
+void TraceChromeClose(void)
+{
+    if (ChromeFile != NULL)
+    {
+        fprintf(ChromeFile, "\n]}\n");
+        fclose(ChromeFile);
+        ChromeFile = NULL;
+    }
+}
+
+/*  Records a span from begin to end (PlatGetTime() values) on a track.
+    args is the body of a JSON object (i.e. "\"response\":\"0\""), or NULL. */
+void TraceChromeSpan(unsigned char track, const char *name, const char *category, u64 begin, u64 end, const char *args)
+{
+    if (ChromeFile == NULL)
+        return;
+
+    if (begin < ChromeStart)
+        begin = ChromeStart;
+    if (end < begin)
+        end = begin;
+
+    TraceChromeBeginEvent();
+    fprintf(ChromeFile, "{\"name\":\"");
+    TraceChromeString(name != NULL ? name : "");
+    fprintf(ChromeFile, "\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f",
+            category, track, (begin - ChromeStart) / 1e3, (end - begin) / 1e3);
+    if (args != NULL)
+        fprintf(ChromeFile, ",\"args\":{%s}", args);
+    fprintf(ChromeFile, "}");
+}
+
+void TraceChromeCounter(const char *name, u64 time, unsigned int value)
+{
+    if (ChromeFile == NULL)
+        return;
+
+    TraceChromeBeginEvent();
+    fprintf(ChromeFile, "{\"name\":\"%s\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{\"bytes\":%u}}",
+            name, (time > ChromeStart ? time - ChromeStart : 0) / 1e3, value);
+}
+
+// Escapes text for use within a JSON string in the args of TraceChromeSpan().
+void TraceChromeEscape(char *out, int size, const char *text)
+{
+    int len;
+
+    for (len = 0; *text != '\0' && len < size - 7; text++)
+    {
+        if (*text == '"' || *text == '\\')
+        {
+            out[len++] = '\\';
+            out[len++] = *text;
+        }
+        else if ((unsigned char)*text < 0x20)
+            len += snprintf(&out[len], size - len, "\\u%04x", (unsigned char)*text);
+        else
+            out[len++] = *text;
+    }
+    out[len] = '\0';
+}
+
+void TraceRingRecord(unsigned char type, unsigned char port, u64 time, const char *data, unsigned int len)
+{
+    struct TraceFrame *frame;
+
+    frame          = &TraceRing[TraceRingCount++ & (TRACE_RING_FRAMES - 1)];
+    frame->time    = time;
+    frame->type    = type;
+    frame->port    = port;
+    frame->OrigLen = len > 255 ? 255 : len;
+    frame->len     = len > TRACE_RING_DATA ? TRACE_RING_DATA : len;
+    memcpy(frame->data, data, frame->len);
+}
+
+/*  pcapng export of the capture ring. Blocks are written in the byte order of the host, which the byte-order magic
+    of the Section Header Block records. */
+static unsigned int TracePcapngOption(unsigned char *block, unsigned int offset, u16 code, const void *value, u16 len)
+{
+    memcpy(&block[offset], &code, 2);
+    memcpy(&block[offset + 2], &len, 2);
+    if (len > 0)
+        memcpy(&block[offset + 4], value, len);
+    memset(&block[offset + 4 + len], 0, ((len + 3) & ~3) - len);
+
+    return offset + 4 + ((len + 3) & ~3);
+}
+
+static void TracePcapngBlock(u32 type, const unsigned char *body, unsigned int len)
+{
+    u32 total = 12 + len;
+
+    fwrite(&type, 4, 1, PcapngFile);
+    fwrite(&total, 4, 1, PcapngFile);
+    fwrite(body, 1, len, PcapngFile);
+    fwrite(&total, 4, 1, PcapngFile);
+}
+
+// Interface Description Block of a port, so that the interface ID of a frame is its port.
+static void TracePcapngInterface(unsigned char port)
+{
+    unsigned char block[192], resolution = 9; // 10^-9 s
+    unsigned int offset;
+    char name[16];
+    u32 value;
+    u16 word;
+
+    word = TRACE_PCAPNG_LINK;
+    memcpy(&block[0], &word, 2);
+    word = 0;
+    memcpy(&block[2], &word, 2);
+    value = TRACE_RING_DATA;
+    memcpy(&block[4], &value, 4);
+    if (port == 0)
+        offset = TracePcapngOption(block, 8, 2, PcapngPort, (u16)strlen(PcapngPort)); // if_name
+    else
+    {
+        snprintf(name, sizeof(name), "port %u", port);
+        offset = TracePcapngOption(block, 8, 2, name, (u16)strlen(name));
+    }
+    offset = TracePcapngOption(block, offset, 9, &resolution, 1); // if_tsresol
+    offset = TracePcapngOption(block, offset, 0, NULL, 0);
+    TracePcapngBlock(0x00000001, block, offset);
+}
+
+int TracePcapngOpen(const char *filename, const char *port)
+{
+    static const char application[] = "PMAP v1.2";
+    unsigned char block[64];
+    struct timespec now;
+    unsigned int offset;
+    u32 value;
+    u16 word;
+
+    if ((PcapngFile = fopen(filename, "wb")) == NULL)
+        return -EIO;
+
+    snprintf(PcapngPort, sizeof(PcapngPort), "%s", port);
+    // The ring has monotonic times, which are made absolute with the offset of the monotonic clock from UTC.
+    timespec_get(&now, TIME_UTC);
+    PcapngEpoch   = (u64)now.tv_sec * 1000000000ULL + now.tv_nsec - PlatGetTime();
+    PcapngWritten = TraceRingCount;
+    PcapngPorts   = 0;
+
+    // Section Header Block: byte-order magic, version 1.0 and an unspecified section length.
+    value = 0x1A2B3C4D;
+    memcpy(&block[0], &value, 4);
+    word = 1;
+    memcpy(&block[4], &word, 2);
+    word = 0;
+    memcpy(&block[6], &word, 2);
+    memset(&block[8], 0xFF, 8);
+    offset = TracePcapngOption(block, 16, 4, application, sizeof(application) - 1); // shb_userappl
+    offset = TracePcapngOption(block, offset, 0, NULL, 0);
+    TracePcapngBlock(0x0A0D0D0A, block, offset);
+    TracePcapngInterface(PcapngPorts++);
+    fflush(PcapngFile);
+
+    return 0;
+}
+
+/*  Writes the frames recorded since the last flush, so that the file is complete up to this point even if PMAP is
+    terminated (i.e. with Ctrl-C while idle). Called before every operator prompt, so not while commands are running. */
+void TracePcapngFlush(void)
+{
+    unsigned char block[128];
+    unsigned int lost, offset;
+    struct TraceFrame *frame;
+    u64 time;
+    u32 value;
+
+    if (PcapngFile == NULL || PcapngWritten == TraceRingCount)
+        return;
+
+    if (TraceRingCount - PcapngWritten > TRACE_RING_FRAMES)
+    {
+        lost = TraceRingCount - PcapngWritten - TRACE_RING_FRAMES;
+        PlatShowMessage("pcapng: %u frames were overwritten before they could be written.\n", lost);
+        PcapngWritten += lost;
+    }
+
+    // Enhanced Packet Blocks, oldest first.
+    for (; PcapngWritten != TraceRingCount; PcapngWritten++)
+    {
+        frame = &TraceRing[PcapngWritten & (TRACE_RING_FRAMES - 1)];
+        while (PcapngPorts <= frame->port)
+            TracePcapngInterface(PcapngPorts++);
+
+        time  = PcapngEpoch + frame->time;
+        value = frame->port;
+        memcpy(&block[0], &value, 4);
+        value = (u32)(time >> 32);
+        memcpy(&block[4], &value, 4);
+        value = (u32)time;
+        memcpy(&block[8], &value, 4);
+        value = frame->len;
+        memcpy(&block[12], &value, 4);
+        value = frame->OrigLen;
+        memcpy(&block[16], &value, 4);
+        memcpy(&block[20], frame->data, frame->len);
+        memset(&block[20 + frame->len], 0, ((frame->len + 3) & ~3) - frame->len);
+        offset = 20 + ((frame->len + 3) & ~3);
+        value  = frame->type == TRACE_EVENT_TX ? 2 : 1; // Outbound or inbound.
+        offset = TracePcapngOption(block, offset, 2, &value, 4); // epb_flags
+        offset = TracePcapngOption(block, offset, 0, NULL, 0);
+        TracePcapngBlock(0x00000006, block, offset);
+    }
+    fflush(PcapngFile);
+}
+
+void TracePcapngClose(void)
+{
+    if (PcapngFile == NULL)
+        return;
+
+    TracePcapngFlush();
+    fclose(PcapngFile);
+    PcapngFile = NULL;
+}
+
+static int TraceAddEvent(struct Trace *trace, u64 time, unsigned char type, const char *data, int len)
+{
+    struct TraceEvent *events, *event;
+
+    if (trace->count >= trace->size)
+    {
+        if ((events = realloc(trace->events, (trace->size + 1024) * sizeof(struct TraceEvent))) == NULL)
+            return ENOMEM;
+        trace->events = events;
+        trace->size += 1024;
+    }
+
+    if (len >= TRACE_DATA_MAX)
+        len = TRACE_DATA_MAX - 1;
+
+    event       = &trace->events[trace->count];
+    event->time = time;
+    event->seq  = trace->count;
+    event->type = type;
+    memcpy(event->data, data, len);
+    event->data[len] = '\0';
+    trace->count++;
+
+    return 0;
+}
+
+static void TraceFree(struct Trace *trace)
+{
+    free(trace->events);
+    trace->events = NULL;
+    trace->count  = 0;
+    trace->size   = 0;
+}
+
+static int TraceLoad(const char *filename, struct Trace *trace)
+{
+    FILE *file;
+    char line[256], *data;
+    unsigned long long int time;
+    int type, result;
+
+    if ((file = fopen(filename, "r")) == NULL)
+        return -ENOENT;
+
+    result = 0;
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        if (line[0] == '#' || line[0] == '\n')
+            continue;
+
+        time = strtoull(line, &data, 10);
+        while (*data == ' ')
+            data++;
+
+        for (type = 0; type < 3; type++)
+        {
+            if (!strncmp(data, TraceEventNames[type], strlen(TraceEventNames[type])) && data[strlen(TraceEventNames[type])] == ' ')
+                break;
+        }
+        if (type == 3)
+            continue;
+
+        data += strlen(TraceEventNames[type]) + 1;
+        if ((result = TraceAddEvent(trace, time, type, data, strcspn(data, "\r\n"))) != 0)
+            break;
+    }
+
+    fclose(file);
+
+    return result;
+}
+
+/*  Capture import
+    Each line of the capture is: <timestamp> <channel> <data>
+        timestamp: seconds (i.e. 12.000125) or HH:MM:SS.ffffff
+        channel: TX/RX, H/C (host/console), A/B, 0/1, >/<, W/R
+        data: hex bytes separated by spaces (i.e. 63 65 31 0d 0a), or text with C-style escapes (i.e. ce10010\r\n)
+    Lines that are empty or start with '#' are ignored. Bytes are reassembled into frames for each channel. */
+static int TraceParseChannel(const char *token)
+{
+    static const char *tx[] = {"tx", "h", "host", "a", "0", ">", "w", "write", "out", NULL};
+    static const char *rx[] = {"rx", "c", "console", "b", "1", "<", "r", "read", "in", NULL};
+    int i;
+
+    for (i = 0; tx[i] != NULL; i++)
+    {
+        if (!pstricmp(token, tx[i]))
+            return TRACE_EVENT_TX;
+    }
+    for (i = 0; rx[i] != NULL; i++)
+    {
+        if (!pstricmp(token, rx[i]))
+            return TRACE_EVENT_RX;
+    }
+
+    return -1;
+}
+
+static char TraceParseHexByte(const char *text)
+{
+    char digits[3];
+
+    digits[0] = text[0];
+    digits[1] = text[1];
+    digits[2] = '\0';
+
+    return (char)strtoul(digits, NULL, 16);
+}
+
+static int TraceParseData(const char *text, char *bytes, int size)
+{
+    const char *p;
+    int len, hex;
+
+    // Hex dump, if every token is a pair of hex digits.
+    for (p = text, hex = 1; hex && *p != '\0'; p++)
+    {
+        if (isspace((unsigned char)*p))
+            continue;
+        hex = isxdigit((unsigned char)p[0]) && isxdigit((unsigned char)p[1]) && (p[2] == '\0' || isspace((unsigned char)p[2]));
+        if (!hex)
+            break; // Not past the end of a text that ends in a single digit.
+        p++;
+    }
+
+    len = 0;
+    if (hex)
+    {
+        for (p = text; *p != '\0' && len < size; p++)
+        {
+            if (!isspace((unsigned char)*p))
+            {
+                bytes[len++] = TraceParseHexByte(p);
+                p++;
+            }
+        }
+    }
+    else
+    {
+        for (p = text; *p != '\0' && *p != '\n' && len < size; p++)
+        {
+            if (*p == '\\' && p[1] != '\0')
+            {
+                p++;
+                switch (*p)
+                {
+                    case 'r':
+                        bytes[len++] = '\r';
+                        break;
+                    case 'n':
+                        bytes[len++] = '\n';
+                        break;
+                    case 'x':
+                        if (isxdigit((unsigned char)p[1]) && isxdigit((unsigned char)p[2]))
+                        {
+                            bytes[len++] = TraceParseHexByte(&p[1]);
+                            p += 2;
+                        }
+                        break;
+                    default:
+                        bytes[len++] = *p;
+                }
+            }
+            else if (*p != '\r')
+                bytes[len++] = *p;
+        }
+    }
+
+    return len;
+}
+
+static int TraceCompareEvents(const void *a, const void *b)
+{
+    const struct TraceEvent *e1 = a, *e2 = b;
+
+    if (e1->time != e2->time)
+        return e1->time < e2->time ? -1 : 1;
+    return (int)e1->seq - (int)e2->seq;
+}
+
+int TraceImportCapture(const char *capture, const char *output)
+{
+    FILE *file;
+    struct Trace trace;
+    char line[1024], bytes[512], frame[2][TRACE_DATA_MAX + 1], channel[16], previous[2];
+    unsigned int hours, minutes, i;
+    int result, type, len, FrameLen[2], overflow[2], offset, lines;
+    double seconds;
+    u64 time, base, FrameStart[2];
+
+    if ((file = fopen(capture, "r")) == NULL)
+    {
+        PlatShowMessage("Cannot open %s.\n", capture);
+        return -ENOENT;
+    }
+
+    memset(&trace, 0, sizeof(trace));
+    FrameLen[0] = FrameLen[1] = 0;
+    overflow[0] = overflow[1] = 0;
+    previous[0] = previous[1] = '\0';
+    base                      = 0;
+    result                    = 0;
+    lines                     = 0;
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        lines++;
+        if (line[0] == '#' || line[0] == '\n' || line[0] == '\r')
+            continue;
+
+        if (sscanf(line, "%u:%u:%lf %15s %n", &hours, &minutes, &seconds, channel, &offset) == 4)
+            seconds += hours * 3600.0 + minutes * 60.0;
+        else if (sscanf(line, "%lf %15s %n", &seconds, channel, &offset) != 2)
+        {
+            PlatShowMessage("Line %d: unrecognized format.\n", lines);
+            continue;
+        }
+
+        if ((type = TraceParseChannel(channel)) < 0)
+        {
+            PlatShowMessage("Line %d: unrecognized channel %s.\n", lines, channel);
+            continue;
+        }
+
+        time = (u64)(seconds * 1e9);
+        if (trace.count == 0 && FrameLen[0] == 0 && FrameLen[1] == 0 && base == 0)
+            base = time;
+        time = time >= base ? time - base : 0;
+
+        len = TraceParseData(line + offset, bytes, sizeof(bytes));
+        for (i = 0; i < (unsigned int)len; i++)
+        {
+            // The rest of a frame that was too long is skipped, up to its terminator.
+            if (overflow[type])
+            {
+                if (previous[type] == '\r' && bytes[i] == '\n')
+                    overflow[type] = 0;
+                previous[type] = bytes[i];
+                continue;
+            }
+
+            if (FrameLen[type] == 0)
+                FrameStart[type] = time;
+            frame[type][FrameLen[type]++] = bytes[i];
+
+            if (FrameLen[type] >= 2 && frame[type][FrameLen[type] - 2] == '\r' && frame[type][FrameLen[type] - 1] == '\n')
+            {
+                if ((result = TraceAddEvent(&trace, type == TRACE_EVENT_TX ? FrameStart[type] : time, type, frame[type], FrameLen[type] - 2)) != 0)
+                    break;
+                FrameLen[type] = 0;
+            }
+            else if (FrameLen[type] >= TRACE_DATA_MAX)
+            { // No terminator within TRACE_DATA_MAX bytes: keep the start of the frame (truncated).
+                PlatShowMessage("Line %d: %s frame longer than %d bytes, truncated.\n", lines, type == TRACE_EVENT_TX ? "TX" : "RX", TRACE_DATA_MAX);
+                if ((result = TraceAddEvent(&trace, type == TRACE_EVENT_TX ? FrameStart[type] : time, type, frame[type], FrameLen[type])) != 0)
+                    break;
+                previous[type] = frame[type][FrameLen[type] - 1];
+                overflow[type] = 1;
+                FrameLen[type] = 0;
+            }
+        }
+        if (result != 0)
+            break;
+    }
+    fclose(file);
+
+    if (result == 0)
+    {
+        qsort(trace.events, trace.count, sizeof(struct TraceEvent), &TraceCompareEvents);
+
+        if ((file = fopen(output, "w")) != NULL)
+        {
+            fprintf(file, TRACE_HEADER "\n"
+                          "# Imported from %s\n",
+                    capture);
+            for (i = 0; i < trace.count; i++)
+                TraceWrite(file, trace.events[i].time, trace.events[i].type, trace.events[i].data);
+            fclose(file);
+            PlatShowMessage("Imported %u frames from %s.\n", trace.count, capture);
+        }
+        else
+        {
+            PlatShowMessage("Cannot create %s.\n", output);
+            result = -EIO;
+        }
+    }
+
+    TraceFree(&trace);
+
+    return result;
+}
+
+/*  Comparison
+    Frames are paired into transactions (a TX frame and the first RX frame that follows it).
+    Latency is the time from TX to RX. Gap is the time from the previous response to the next command (the cadence of the tool). */
+struct TraceTransaction
+{
+    unsigned short int command;
+    unsigned char answered;
+    unsigned short int stage;
+    u64 tx, rx, gap;
+};
+
+struct TraceSummary
+{
+    struct TraceTransaction *transactions;
+    unsigned int count;
+    unsigned short int StageCount;
+    const char *labels[256];
+    u64 StageStart[256], StageEnd[256];
+    unsigned int StageCommands[256];
+};
+
+static int TraceSummarize(const struct Trace *trace, struct TraceSummary *summary)
+{
+    const struct TraceEvent *event;
+    struct TraceTransaction *current;
+    unsigned int i;
+    u64 LastEnd;
+    char code[4];
+
+    memset(summary, 0, sizeof(*summary));
+    if ((summary->transactions = malloc((trace->count + 1) * sizeof(struct TraceTransaction))) == NULL)
+        return ENOMEM;
+
+    current = NULL;
+    LastEnd = 0;
+    for (i = 0, event = trace->events; i < trace->count; i++, event++)
+    {
+        switch (event->type)
+        {
+            case TRACE_EVENT_STAGE:
+                if (summary->StageCount < 255 && summary->StageCommands[summary->StageCount] > 0)
+                    summary->StageCount++;
+                summary->labels[summary->StageCount] = event->data;
+                current                              = NULL;
+                break;
+            case TRACE_EVENT_TX:
+                if (strlen(event->data) < 3)
+                    break;
+                memcpy(code, event->data, 3);
+                code[3] = '\0';
+
+                if (summary->count > 0 && event->time - LastEnd >= TRACE_STAGE_GAP_NS && summary->StageCount < 255 && summary->StageCommands[summary->StageCount] > 0)
+                    summary->StageCount++;
+
+                current           = &summary->transactions[summary->count++];
+                current->command  = (unsigned short int)strtoul(code, NULL, 16);
+                current->tx       = event->time;
+                current->rx       = event->time;
+                current->gap      = (summary->StageCommands[summary->StageCount] > 0 && event->time > LastEnd) ? event->time - LastEnd : 0;
+                current->answered = 0;
+                current->stage    = summary->StageCount;
+                if (summary->StageCommands[summary->StageCount]++ == 0)
+                    summary->StageStart[summary->StageCount] = event->time;
+                summary->StageEnd[summary->StageCount] = event->time;
+                LastEnd                                = event->time;
+                break;
+            case TRACE_EVENT_RX:
+                if (current != NULL && !current->answered)
+                {
+                    current->rx                            = event->time;
+                    current->answered                      = 1;
+                    summary->StageEnd[summary->StageCount] = event->time;
+                    LastEnd                                = event->time;
+                }
+                break;
+        }
+    }
+    summary->StageCount++;
+
+    return 0;
+}
+
+struct TraceCommandStats
+{
+    unsigned int count, answered;
+    u64 latency, gap;
+};
+
+static void TraceAccumulate(const struct TraceSummary *summary, struct TraceCommandStats *stats)
+{
+    const struct TraceTransaction *transaction;
+    unsigned int i;
+
+    for (i = 0, transaction = summary->transactions; i < summary->count; i++, transaction++)
+    {
+        stats[transaction->command].count++;
+        stats[transaction->command].gap += transaction->gap;
+        if (transaction->answered)
+        {
+            stats[transaction->command].answered++;
+            stats[transaction->command].latency += transaction->rx - transaction->tx;
+        }
+    }
+}
+
+int TraceCompare(const char *reference, const char *trace)
+{
+    struct Trace traces[2];
+    struct TraceSummary *summaries;
+    struct TraceCommandStats *stats[2], *s;
+    const char *files[2], *label;
+    unsigned int command, i, stage, StageCount;
+    int result;
+
+    files[0] = reference;
+    files[1] = trace;
+    memset(traces, 0, sizeof(traces));
+    summaries = calloc(2, sizeof(struct TraceSummary));
+    stats[0]  = calloc(0x1000, sizeof(struct TraceCommandStats));
+    stats[1]  = calloc(0x1000, sizeof(struct TraceCommandStats));
+    if (summaries == NULL || stats[0] == NULL || stats[1] == NULL)
+    {
+        result = ENOMEM;
+        goto end;
+    }
+
+    for (i = 0; i < 2; i++)
+    {
+        if ((result = TraceLoad(files[i], &traces[i])) != 0)
+        {
+            PlatShowMessage("Cannot load %s.\n", files[i]);
+            goto end;
+        }
+        qsort(traces[i].events, traces[i].count, sizeof(struct TraceEvent), &TraceCompareEvents);
+        if ((result = TraceSummarize(&traces[i], &summaries[i])) != 0)
+            goto end;
+        TraceAccumulate(&summaries[i], stats[i]);
+    }
+
+    PlatShowMessage("Reference: %s (%u commands)\n"
+                    "PMAP:      %s (%u commands)\n\n"
+                    "Per command                       Reference                       PMAP\n"
+                    "Code Name                  Count Latency(ms)  Gap(ms)   Count Latency(ms)  Gap(ms)\n",
+                    reference, summaries[0].count, trace, summaries[1].count);
+    for (command = 0; command < 0x1000; command++)
+    {
+        if (stats[0][command].count == 0 && stats[1][command].count == 0)
+            continue;
+
+        PlatShowMessage("%03x  %-20.20s", command, MechaGetCommandName(command));
+        for (i = 0; i < 2; i++)
+        {
+            s = &stats[i][command];
+            if (s->count > 0)
+                PlatShowMessage("  %5u %11.2f %8.2f", s->count, s->answered > 0 ? s->latency / 1e6 / s->answered : 0.0, s->gap / 1e6 / s->count);
+            else
+                PlatShowMessage("  %5s %11s %8s", "-", "-", "-");
+        }
+        PlatShowMessage("\n");
+    }
+
+    StageCount = summaries[0].StageCount > summaries[1].StageCount ? summaries[0].StageCount : summaries[1].StageCount;
+    PlatShowMessage("\nPer stage        Reference              PMAP\n"
+                    "Stage        Commands  Time(s)   Commands  Time(s)   Label\n");
+    for (stage = 0; stage < StageCount; stage++)
+    {
+        PlatShowMessage("%5u     ", stage + 1);
+        for (i = 0; i < 2; i++)
+        {
+            if (stage < summaries[i].StageCount)
+                PlatShowMessage("   %8u %8.2f", summaries[i].StageCommands[stage], (summaries[i].StageEnd[stage] - summaries[i].StageStart[stage]) / 1e9);
+            else
+                PlatShowMessage("   %8s %8s", "-", "-");
+        }
+        label = summaries[1].labels[stage] != NULL ? summaries[1].labels[stage] : summaries[0].labels[stage];
+        if (label != NULL)
+            PlatShowMessage("   %.*s", (int)strcspn(label, "\n"), label);
+        PlatShowMessage("\n");
+    }
+
+    result = 0;
+
+end:
+    for (i = 0; i < 2; i++)
+    {
+        if (summaries != NULL)
+            free(summaries[i].transactions);
+        TraceFree(&traces[i]);
+    }
+    free(summaries);
+    free(stats[0]);
+    free(stats[1]);
+
+    return result;
+}
@@ -0,0 +1,47 @@
+/*  Session traces: a text file with one event per line.
+        <time in ns> TX <frame>
+        <time in ns> RX <frame>
+        <time in ns> STAGE <label>
+    Frames are stored without the CR/LF terminator. TX times are taken when the frame starts being sent,
+    RX times are taken when the frame has been completely received (by the RT I/O thread, with --rt-io). */
+#define TRACE_HEADER       "# PMAP trace 1"
+#define TRACE_DATA_MAX     64
+
+#define TRACE_EVENT_TX     0
+#define TRACE_EVENT_RX     1
+#define TRACE_EVENT_STAGE  2
+
+#define TRACE_STAGE_GAP_NS 2000000000ULL // An idle link for this long (i.e. operator action) starts a new stage.
+
+/*  Capture ring: the raw bytes of every frame sent and received (with the CR/LF terminator), with the port and the time
+    in ns. It is always recorded, as it costs one copy of the frame per command; only the last TRACE_RING_FRAMES frames
+    are kept. With "--pcapng=<file>", the frames in the ring are appended to a pcapng file before every operator prompt
+    and when PMAP exits: one interface per port with the LINKTYPE_USER0 link type and a resolution of 1 ns, and one
+    Enhanced Packet Block per frame, with its direction (outbound = TX, inbound = RX) in the epb_flags option.
+    pmap-mecha.lua is a Wireshark dissector for these files. */
+#define TRACE_RING_FRAMES    8192 // Must be a power of 2.
+#define TRACE_RING_DATA      48   // Longer frames are truncated, with their original length kept.
+#define TRACE_PCAPNG_LINK    147  // LINKTYPE_USER0
+
+// Tracks of the Chrome trace-event export.
+#define TRACE_TRACK_PORT     1 // Commands, machine waits and handlers.
+#define TRACE_TRACK_OPERATOR 2 // Operator prompts.
+#define TRACE_TRACK_STAGE    3 // Stages of a task list (i.e. ELECT), delimited by operator prompts.
+
+int TraceOpen(const char *filename);
+void TraceClose(void);
+void TraceRecord(unsigned char type, u64 time, const char *data);
+
+int TraceChromeOpen(const char *filename, const char *port);
+void TraceChromeClose(void);
+void TraceChromeSpan(unsigned char track, const char *name, const char *category, u64 begin, u64 end, const char *args);
+void TraceChromeCounter(const char *name, u64 time, unsigned int value);
+void TraceChromeEscape(char *out, int size, const char *text);
+
+void TraceRingRecord(unsigned char type, unsigned char port, u64 time, const char *data, unsigned int len);
+int TracePcapngOpen(const char *filename, const char *port);
+void TracePcapngFlush(void);
+void TracePcapngClose(void);
+
+int TraceImportCapture(const char *capture, const char *output);
+int TraceCompare(const char *reference, const char *trace);
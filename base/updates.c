@@ -141,7 +141,7 @@ int MechaUpdateChassisCex10000(int ClearOSD2InitBit, int ReplacedMecha, int lens
     }
 #endif
 
-    if (MechaAddPostUpdateCmds(0, id) != 0)
+    if (MechaAddPostUpdateCmds(UpdateStat, id) != 0)
     {
         MechaCommandListClear();
         return 0;
@@ -256,7 +256,9 @@ int MechaUpdateChassisA(int ClearOSD2InitBit, int ReplacedMecha, int lens, int o
     }
 #endif
 
-    if (MechaAddPostUpdateCmds(ClearOSD2InitBit, id) != 0)
+    if (ClearOSD2InitBit)
+        UpdateStat |= UPDATE_REGION_OSD2;
+    if (MechaAddPostUpdateCmds(UpdateStat, id) != 0)
     {
         MechaCommandListClear();
         return 0;
@@ -392,7 +394,9 @@ int MechaUpdateChassisAB(int ClearOSD2InitBit, int ReplacedMecha, int lens, int
     }
 #endif
 
-    if (MechaAddPostUpdateCmds(ClearOSD2InitBit, id) != 0)
+    if (ClearOSD2InitBit)
+        UpdateStat |= UPDATE_REGION_OSD2;
+    if (MechaAddPostUpdateCmds(UpdateStat, id) != 0)
     {
         MechaCommandListClear();
         return 0;
@@ -512,7 +516,9 @@ int MechaUpdateChassisB(int ClearOSD2InitBit, int ReplacedMecha, int lens, int o
     }
 #endif
 
-    if (MechaAddPostUpdateCmds(ClearOSD2InitBit, id) != 0)
+    if (ClearOSD2InitBit)
+        UpdateStat |= UPDATE_REGION_OSD2;
+    if (MechaAddPostUpdateCmds(UpdateStat, id) != 0)
     {
         MechaCommandListClear();
         return 0;
@@ -626,7 +632,9 @@ int MechaUpdateChassisC(int ClearOSD2InitBit, int ReplacedMecha, int lens, int o
     }
 #endif
 
-    if (MechaAddPostUpdateCmds(ClearOSD2InitBit, id) != 0)
+    if (ClearOSD2InitBit)
+        UpdateStat |= UPDATE_REGION_OSD2;
+    if (MechaAddPostUpdateCmds(UpdateStat, id) != 0)
     {
         MechaCommandListClear();
         return 0;
@@ -800,7 +808,9 @@ int MechaUpdateChassisD(int ClearOSD2InitBit, int ReplacedMecha, int lens, int o
     }
 #endif
 
-    if (MechaAddPostUpdateCmds(ClearOSD2InitBit, id) != 0)
+    if (ClearOSD2InitBit)
+        UpdateStat |= UPDATE_REGION_OSD2;
+    if (MechaAddPostUpdateCmds(UpdateStat, id) != 0)
     {
         MechaCommandListClear();
         return 0;
@@ -1049,7 +1059,9 @@ int MechaUpdateChassisF(int ClearOSD2InitBit, int ReplacedMecha, int lens, int o
             UpdateStat |= (UPDATE_REGION_RTC | UPDATE_REGION_RTC_CTL12 | UPDATE_REGION_RTC_TIME);
         }
     }
-    if (MechaAddPostUpdateCmds(ClearOSD2InitBit, id) != 0)
+    if (ClearOSD2InitBit)
+        UpdateStat |= UPDATE_REGION_OSD2;
+    if (MechaAddPostUpdateCmds(UpdateStat, id) != 0)
     {
         MechaCommandListClear();
         return 0;
@@ -1189,7 +1201,9 @@ int MechaUpdateChassisG(int ClearOSD2InitBit, int ReplacedMecha, int lens, int o
         MechaCommandAdd(MECHA_CMD_RTC_WRITE, RTCData, id++, 0, MECHA_TASK_NORMAL_TO, "RTC WRITE");
         UpdateStat |= (UPDATE_REGION_RTC | UPDATE_REGION_RTC_CTL12 | UPDATE_REGION_RTC_TIME);
     }
-    if (MechaAddPostUpdateCmds(ClearOSD2InitBit, id) != 0)
+    if (ClearOSD2InitBit)
+        UpdateStat |= UPDATE_REGION_OSD2;
+    if (MechaAddPostUpdateCmds(UpdateStat, id) != 0)
     {
         MechaCommandListClear();
         return 0;
@@ -1272,7 +1286,7 @@ int MechaUpdateChassisDexA(int ClearOSD2InitBit, int ReplacedMecha, int lens, in
     }
 #endif
 
-    if (MechaAddPostUpdateCmds(0, id) != 0)
+    if (MechaAddPostUpdateCmds(UpdateStat, id) != 0)
     {
         MechaCommandListClear();
         return 0;
@@ -1346,7 +1360,7 @@ int MechaUpdateChassisDexA2(int ClearOSD2InitBit, int ReplacedMecha, int lens, i
     }
 #endif
 
-    if (MechaAddPostUpdateCmds(0, id) != 0)
+    if (MechaAddPostUpdateCmds(UpdateStat, id) != 0)
     {
         MechaCommandListClear();
         return 0;
@@ -1425,7 +1439,7 @@ int MechaUpdateChassisDexA3(int ClearOSD2InitBit, int ReplacedMecha, int lens, i
     }
 #endif
 
-    if (MechaAddPostUpdateCmds(0, id) != 0)
+    if (MechaAddPostUpdateCmds(UpdateStat, id) != 0)
     {
         MechaCommandListClear();
         return 0;
@@ -1500,7 +1514,9 @@ int MechaUpdateChassisDexB(int ClearOSD2InitBit, int ReplacedMecha, int lens, in
     }
 #endif
 
-    if (MechaAddPostUpdateCmds(ClearOSD2InitBit, id) != 0)
+    if (ClearOSD2InitBit)
+        UpdateStat |= UPDATE_REGION_OSD2;
+    if (MechaAddPostUpdateCmds(UpdateStat, id) != 0)
     {
         MechaCommandListClear();
         return 0;
@@ -1569,7 +1585,9 @@ int MechaUpdateChassisDexD(int ClearOSD2InitBit, int ReplacedMecha, int lens, in
     }
 #endif
 
-    if (MechaAddPostUpdateCmds(ClearOSD2InitBit, id) != 0)
+    if (ClearOSD2InitBit)
+        UpdateStat |= UPDATE_REGION_OSD2;
+    if (MechaAddPostUpdateCmds(UpdateStat, id) != 0)
     {
         MechaCommandListClear();
         return 0;
@@ -1632,6 +1650,7 @@ int MechaUpdateChassisH(int ClearOSD2InitBit, int ReplacedMecha, int lens, int o
     MechaCommandAdd(MECHA_TASK_UI_CMD_WAIT, NULL, MECHA_TASK_ID_UI, 0, 100, "WAIT 100ms");
     if (!pstrincmp(MechaName, "000405", 6))
     { // The data here seems to appear at the end of the EEPROM (+0x320).
+        UpdateStat |= UPDATE_REGION_CONFIG;
         MechaCommandAdd(MECHA_CMD_WRITECONFIG, "00b1ea8bc0c8198435", id++, 0, MECHA_TASK_NORMAL_TO, "PCEA1240");
         MechaCommandAdd(MECHA_CMD_WRITECONFIG, "0103dccd7dd383ff90", id++, 0, MECHA_TASK_NORMAL_TO, "PCEA1240");
         MechaCommandAdd(MECHA_CMD_WRITECONFIG, "02a6848324ddf69aeb", id++, 0, MECHA_TASK_NORMAL_TO, "PCEA1240");
@@ -1661,7 +1680,9 @@ int MechaUpdateChassisH(int ClearOSD2InitBit, int ReplacedMecha, int lens, int o
         MechaCommandAdd(MECHA_CMD_WRITECONFIG, "1ae2e723073e3a51d2", id++, 0, MECHA_TASK_NORMAL_TO, "PCEA1240");
         MechaCommandAdd(MECHA_CMD_WRITECONFIG, "1bff90b77afdff00e3", id++, 0, MECHA_TASK_NORMAL_TO, "PCEA1240");
     }
-    if (MechaAddPostUpdateCmds(ClearOSD2InitBit, id) != 0)
+    if (ClearOSD2InitBit)
+        UpdateStat |= UPDATE_REGION_OSD2;
+    if (MechaAddPostUpdateCmds(UpdateStat, id) != 0)
     {
         MechaCommandListClear();
         return 0;
@@ -1724,6 +1745,7 @@ int MechaUpdateChassisDexH(int ClearOSD2InitBit, int ReplacedMecha, int lens, in
     { // Something here checks for 0x19, 0x1A, 0x1B and 0x1C. If it's any of those, then the codes for the CEX H-chassis are used instead.
         // No idea what it actually checks for because the UI doesn't seem to set it (always 0xFFFFFFFF).
         // The data here seems to appear at the very end of the EEPROM (+0x320)
+        UpdateStat |= UPDATE_REGION_CONFIG;
         MechaCommandAdd(MECHA_CMD_WRITECONFIG, "0003dccd7dd383ff90", id++, 0, MECHA_TASK_NORMAL_TO, "PCEA1240");
         MechaCommandAdd(MECHA_CMD_WRITECONFIG, "0103dccd7dd383ff90", id++, 0, MECHA_TASK_NORMAL_TO, "PCEA1240");
         MechaCommandAdd(MECHA_CMD_WRITECONFIG, "02ffffffffffffffff", id++, 0, MECHA_TASK_NORMAL_TO, "PCEA1240");
@@ -1753,7 +1775,9 @@ int MechaUpdateChassisDexH(int ClearOSD2InitBit, int ReplacedMecha, int lens, in
         MechaCommandAdd(MECHA_CMD_WRITECONFIG, "1affffffffffffffff", id++, 0, MECHA_TASK_NORMAL_TO, "PCEA1240");
         MechaCommandAdd(MECHA_CMD_WRITECONFIG, "1bffffffffffffffff", id++, 0, MECHA_TASK_NORMAL_TO, "PCEA1240");
     }
-    if (MechaAddPostUpdateCmds(ClearOSD2InitBit, id) != 0)
+    if (ClearOSD2InitBit)
+        UpdateStat |= UPDATE_REGION_OSD2;
+    if (MechaAddPostUpdateCmds(UpdateStat, id) != 0)
     {
         MechaCommandListClear();
         return 0;
@@ -17,7 +17,16 @@
 #define UPDATE_REGION_RTC       0x0080
 #define UPDATE_REGION_RTC_CTL12 0x0100
 #define UPDATE_REGION_RTC_TIME  0x0200
+#define UPDATE_REGION_OSD2      0x0400 // OSD2 init bit cleared
 #define UPDATE_REGION_DEFAULTS  0x0800
+#define UPDATE_REGION_CONFIG    0x1000 // MECHACON configuration (PCEA1240 data of the 000405/000505 H-chassis), at the end of the EEPROM
+
+// Regions within the EEPROM (the checksum must be rewritten), and those copied to the MECHACON RAM when changed.
+#define UPDATE_REGIONS_EEPROM   (UPDATE_REGION_EEP_ECR | UPDATE_REGION_DISCDET | UPDATE_REGION_SERVO | UPDATE_REGION_TILT | \
+                               UPDATE_REGION_TRAY | UPDATE_REGION_EEGS | UPDATE_REGION_OSD2 | UPDATE_REGION_DEFAULTS | \
+                               UPDATE_REGION_CONFIG)
+#define UPDATE_REGIONS_RAM      (UPDATE_REGION_EEP_ECR | UPDATE_REGION_DISCDET | UPDATE_REGION_SERVO | UPDATE_REGION_TILT | \
+                               UPDATE_REGION_TRAY | UPDATE_REGION_DEFAULTS | UPDATE_REGION_CONFIG)
 
 // Update functions
 int MechaUpdateChassisCex10000(int ClearOSD2InitBit, int ReplacedMecha, int lens, int opt);
@@ -0,0 +1,207 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "platform.h"
+#include "mecha.h"
+#include "eeprom.h"
+#include "watch.h"
+
+#define WATCH_REGION_EEGS  0x01
+#define WATCH_REGION_OSD2  0x02
+#define WATCH_REGION_MODEL 0x04
+#define WATCH_REGION_ILINK 0x08
+#define WATCH_REGION_CONID 0x10
+
+struct WatchRegion
+{
+    const char *name;
+    unsigned char flag;
+    u16 first, FirstNew; // Eight words each, for the old and new (Dragon) layouts.
+};
+
+static const struct WatchRegion WatchRegions[] = {
+    {"eegs", WATCH_REGION_EEGS, EEPROM_MAP_EEGS_0, EEPROM_MAP_EEGS_NEW_0},
+    {"osd2", WATCH_REGION_OSD2, EEPROM_MAP_OSD2_0, EEPROM_MAP_OSD2_NEW_0},
+    {"model", WATCH_REGION_MODEL, EEPROM_MAP_MODEL_NAME_0, EEPROM_MAP_MODEL_NAME_NEW_0},
+    {"ilink", WATCH_REGION_ILINK, EEPROM_MAP_ILINK_ID_0, EEPROM_MAP_ILINK_ID_NEW_0},
+    {"conid", WATCH_REGION_CONID, EEPROM_MAP_CON_ID_0, EEPROM_MAP_CON_ID_NEW_0},
+    {NULL, 0, 0, 0}};
+
+static unsigned char enabled = 0, polling = 0, resolved, regions;
+static u32 WatchMap[0x200 / 32], KnownMap[0x200 / 32];
+static u16 values[0x200];
+static unsigned short int next;
+static unsigned int interval, polls, changes, failures;
+static u64 start, LastPoll;
+
+static void WatchAdd(unsigned int first, unsigned int last)
+{
+    unsigned int word;
+
+    for (word = first; word <= last && word < 0x200; word++)
+        WatchMap[word / 32] |= (1 << (word % 32));
+}
+
+int WatchOpen(const char *spec)
+{
+    const struct WatchRegion *region;
+    const char *end;
+    char item[16], *p;
+    unsigned int first, last, len;
+
+    memset(WatchMap, 0, sizeof(WatchMap));
+    memset(KnownMap, 0, sizeof(KnownMap));
+    regions  = 0;
+    interval = 0;
+
+    for (; *spec != '\0' && *spec != '@'; spec = (*end == ',' ? end + 1 : end))
+    {
+        for (end = spec; *end != '\0' && *end != ',' && *end != '@'; end++)
+            ;
+        len = (unsigned int)(end - spec);
+        if (len == 0 || len >= sizeof(item))
+        {
+            PlatShowMessage("Invalid EEPROM watch: %s\n", spec);
+            return -EINVAL;
+        }
+        memcpy(item, spec, len);
+        item[len] = '\0';
+
+        for (region = WatchRegions; region->name != NULL; region++)
+        {
+            if (!pstricmp(item, region->name))
+                break;
+        }
+        if (region->name != NULL)
+            regions |= region->flag;
+        else if (!pstricmp(item, "all"))
+            WatchAdd(0, 0x1FF);
+        else
+        {
+            first = last = (unsigned int)strtoul(item, &p, 16);
+            if (*p == '-')
+                last = (unsigned int)strtoul(p + 1, &p, 16);
+            if (*p != '\0' || first > last || last >= 0x200)
+            {
+                PlatShowMessage("Invalid EEPROM word: %s\n", item);
+                return -EINVAL;
+            }
+            WatchAdd(first, last);
+        }
+    }
+    if (*spec == '@')
+        interval = (unsigned int)atoi(spec + 1);
+
+    next     = 0;
+    polls    = 0;
+    changes  = 0;
+    failures = 0;
+    resolved = 0;
+    LastPoll = 0;
+    enabled  = 1;
+
+    return 0;
+}
+
+// Regions are added once the MD version of the console is known.
+static void WatchResolve(void)
+{
+    const struct WatchRegion *region;
+    unsigned short int word;
+    u8 tm, md;
+
+    MechaGetMode(&tm, &md);
+    for (region = WatchRegions; region->name != NULL; region++)
+    {
+        if (regions & region->flag)
+            WatchAdd(md == 40 ? region->FirstNew : region->first, (md == 40 ? region->FirstNew : region->first) + 7);
+    }
+
+    // Values that were already read are the starting point, so that their first change is not missed.
+    for (word = 0; word < 0x200; word++)
+    {
+        if ((WatchMap[word / 32] & (1 << (word % 32))) && EEPMapIsValid(word))
+        {
+            KnownMap[word / 32] |= (1 << (word % 32));
+            values[word] = EEPMapRead(word);
+        }
+    }
+
+    start    = PlatGetTime();
+    resolved = 1;
+}
+
+void WatchPoll(const char *label)
+{
+    unsigned short int i, word;
+    u16 data;
+    u64 now;
+
+    if (!enabled || polling)
+        return;
+
+    now = PlatGetTime();
+    if (LastPoll != 0 && now - LastPoll < interval * 1000000ULL)
+        return;
+
+    if (!resolved)
+        WatchResolve();
+
+    // Next watched word, round-robin.
+    for (i = 0, word = next; i < 0x200; i++, word = (word + 1) % 0x200)
+    {
+        if (WatchMap[word / 32] & (1 << (word % 32)))
+            break;
+    }
+    if (i == 0x200)
+    {
+        enabled = 0;
+        return;
+    }
+    next = (word + 1) % 0x200;
+
+    polling = 1;
+    if (EEPROMReadWord(word, &data) != 0)
+    {
+        polling = 0;
+        if (++failures >= WATCH_MAX_FAILURES)
+        {
+            PlatShowMessage("EEPROM watch: stopped after %u read errors.\n", failures);
+            enabled = 0;
+        }
+        return;
+    }
+    polling  = 0;
+    failures = 0;
+    LastPoll = PlatGetTime();
+    polls++;
+
+    if (!(KnownMap[word / 32] & (1 << (word % 32))))
+    {
+        KnownMap[word / 32] |= (1 << (word % 32));
+        values[word] = data;
+        return;
+    }
+
+    if (values[word] != data)
+    {
+        PlatShowMessage("[%9.3fs] EEPROM %03x: %04x -> %04x (after %s)\n",
+                        (LastPoll - start) / 1e9, word, values[word], data, label != NULL ? label : "?");
+        values[word] = data;
+        changes++;
+    }
+}
+
+void WatchClose(void)
+{
+    double elapsed;
+
+    if (!enabled && polls == 0)
+        return;
+
+    elapsed = resolved ? (PlatGetTime() - start) / 1e9 : 0.0;
+    PlatShowMessage("\nEEPROM watch: %u changes in %u reads (%.1f reads/s).\n", changes, polls, elapsed > 0.0 ? polls / elapsed : 0.0);
+    enabled = 0;
+}
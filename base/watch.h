@@ -0,0 +1,12 @@
+/*  EEPROM watch: polls a set of EEPROM words between the commands of the running job, and shows every change.
+    Selected with "--watch=<word>[,<word>...][@<interval in ms>]", where a word is
+        <address>: a single word, in hex.
+        <first>-<last>: a range of words, in hex.
+        eegs, osd2, model, ilink, conid: a region, at its location for the MD version of the console.
+        all: the whole EEPROM.
+    One word is read after every command of the job (round-robin), but no more often than the interval. */
+#define WATCH_MAX_FAILURES 8 // Consecutive read errors, after which watching stops.
+
+int WatchOpen(const char *spec);
+void WatchPoll(const char *label); // Called between commands. label = the command that was just completed.
+void WatchClose(void);
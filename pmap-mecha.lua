@@ -0,0 +1,211 @@
+--  Wireshark dissector for the pcapng files written by PMAP with --pcapng=<file>.
+--  Frames are MECHACON test-mode commands ("<3-digit command code><args>\r\n") from the host and their responses
+--  ("<status><data>\r\n") from the console, with LINKTYPE_USER0 and the direction in the epb_flags option.
+--  Install by copying this file to the personal Lua plugins folder (see Help > About Wireshark > Folders),
+--  or run: wireshark -X lua_script:pmap-mecha.lua capture.pcapng
+--  The command names are those of the MECHA_CMD_* definitions in base/mecha.h.
+
+local mecha = Proto("pmap_mecha", "PMAP MECHACON test mode")
+
+local commands = {
+    [0xc00] = "INIT_SHIMUKE",
+    [0xc01] = "INIT_MECHACON",
+    [0xc10] = "DISC_MODE_CD_8",
+    [0xc11] = "DISC_MODE_CD_12",
+    [0xc12] = "DISC_MODE_DVDSL_8",
+    [0xc13] = "DISC_MODE_DVDDL_8",
+    [0xc14] = "DISC_MODE_DVDSL_12",
+    [0xc15] = "DISC_MODE_DVDDL_12",
+    [0xc16] = "DISC_DETECT",
+    [0xc17] = "DISC_CUR_MODE",
+    [0xc22] = "FOCUS_UPDOWN",
+    [0xc23] = "FOCUS_AUTO_START",
+    [0xc24] = "FOCUS_AUTO_STOP",
+    [0xc25] = "FCS_SEARCH_CHECK",
+    [0xc20] = "LASER_DIODE",
+    [0xc30] = "TRACKING",
+    [0xc41] = "SLED_CTL_MICRO",
+    [0xc42] = "SLED_CTL_BIPHS",
+    [0xc43] = "SLED_CTL_POS",
+    [0xc44] = "SLED_POS_HOME",
+    [0xc45] = "SLED_IN_SW",
+    [0xc50] = "SP_CTL",
+    [0xc51] = "SP_CLV_S",
+    [0xc52] = "SP_CLV_A",
+    [0xc60] = "TRAY",
+    [0xc61] = "TRAY_SW",
+    [0xc8d] = "CLEAR_CONF",
+    [0xc8e] = "UPLOAD_NEW",
+    [0xc93] = "UPLOAD_TO_RAM",
+    [0xc97] = "DETECT_ADJ",
+    [0xc99] = "WRITE_CHECKSUM",
+    [0xc9a] = "READ_CHECKSUM",
+    [0xc9b] = "SETUP_OSD",
+    [0xc9e] = "SETUP_SANYO",
+    [0xca1] = "AUTO_ADJ_ST_1",
+    [0xca2] = "AUTO_ADJ_ST_2",
+    [0xca3] = "AUTO_ADJ_ST_12",
+    [0xca4] = "AUTO_ADJ_ST_2MD",
+    [0xca5] = "AUTO_ADJ_FIX_GAIN",
+    [0xca7] = "RFDC_LEVEL",
+    [0xca8] = "TPP",
+    [0xcaa] = "MIRR_CHECK",
+    [0xcab] = "FE_OFFSET",
+    [0xcb0] = "CD_PLAY_1",
+    [0xcb1] = "CD_PLAY_2",
+    [0xcb2] = "CD_PLAY_3",
+    [0xcb3] = "CD_PLAY_4",
+    [0xcb4] = "CD_STOP",
+    [0xcb5] = "CD_PAUSE",
+    [0xcb6] = "CD_TRACK_CTL",
+    [0xcb8] = "CD_TRACK_LONG_CTL",
+    [0xcb9] = "CD_PLAY_5",
+    [0xcc0] = "DVD_PLAY_1",
+    [0xcc1] = "DVD_PLAY_2",
+    [0xcc2] = "DVD_PLAY_3",
+    [0xcc3] = "DVD_STOP",
+    [0xcc4] = "DVD_PAUSE",
+    [0xcc5] = "DVD_TRACK_CTL",
+    [0xcc7] = "DVD_TRACK_LONG_CTL",
+    [0xcc8] = "FOCUS_JUMP",
+    [0xcca] = "ADJ_AUTO_TILT",
+    [0xccb] = "INIT_AUTO_TILT",
+    [0xccd] = "MOV_AUTO_TILT",
+    [0xcd1] = "SET_DSP",
+    [0xcd3] = "GAIN",
+    [0xcde] = "DSP_ERROR_RATE_CTL",
+    [0xcdf] = "DSP_ERROR_RATE",
+    [0xce0] = "EEPROM_WRITE",
+    [0xce1] = "EEPROM_READ",
+    [0xce4] = "RTC_READ",
+    [0xce5] = "RTC_WRITE",
+    [0xce6] = "ECR_READ",
+    [0xce7] = "ECR_WRITE",
+    [0xce8] = "CD_ERROR",
+    [0xce9] = "JITTER",
+    [0xcf2] = "FOCUS_JUMP_NEW",
+    [0xcf4] = "WRITE_1A6",
+    [0xcf5] = "READ_1A6",
+    [0xcf6] = "READ_1EA_1FA",
+    [0xcf7] = "WRITE_1EA_1FA",
+    [0xcfa] = "WRITECONFIG",
+    [0xcfb] = "READCONFIG",
+    [0xcfc] = "READ_MODEL_2",
+    [0xcfd] = "READ_MODEL",
+    [0xcfe] = "EEPROM_ERASE",
+}
+
+local directions = {[0] = "Command", [1] = "Response"}
+
+local f_direction = ProtoField.uint8("pmap_mecha.direction", "Direction", base.DEC, directions)
+local f_command = ProtoField.uint16("pmap_mecha.command", "Command", base.HEX, commands)
+local f_args = ProtoField.string("pmap_mecha.args", "Arguments")
+local f_status = ProtoField.string("pmap_mecha.status", "Status")
+local f_data = ProtoField.string("pmap_mecha.data", "Data")
+local f_request = ProtoField.framenum("pmap_mecha.request", "Response to", base.NONE, frametype.REQUEST)
+local f_time = ProtoField.relative_time("pmap_mecha.time", "Time since command")
+local f_terminated = ProtoField.bool("pmap_mecha.terminated", "Terminated by CR/LF")
+mecha.fields = {f_direction, f_command, f_args, f_status, f_data, f_request, f_time, f_terminated}
+
+local frame_interface = Field.new("frame.interface_id")
+
+local e_unterminated = ProtoExpert.new("pmap_mecha.unterminated", "Frame without CR/LF (timeout or truncated response)",
+                                       expert.group.MALFORMED, expert.severity.WARN)
+local e_status = ProtoExpert.new("pmap_mecha.status.error", "Response with an error status",
+                                 expert.group.RESPONSE_CODE, expert.severity.NOTE)
+mecha.experts = {e_unterminated, e_status}
+
+-- Responses are matched to the commands sent on the same interface in order (first in, first out), in the first pass,
+-- as up to 8 commands may be in flight at once with a pipelined serial server.
+local pending = {}
+local requests = {}
+
+local function fifo(interface)
+    if pending[interface] == nil then
+        pending[interface] = {first = 1, last = 0}
+    end
+    return pending[interface]
+end
+
+function mecha.init()
+    pending = {}
+    requests = {}
+end
+
+local function command_name(code)
+    return commands[code] or string.format("UNKNOWN_%03X", code)
+end
+
+function mecha.dissector(tvb, pinfo, tree)
+    local len = tvb:len()
+    local text = tvb:raw(0, len)
+    local terminated = len >= 2 and text:sub(-2) == "\r\n"
+    local body = terminated and text:sub(1, -3) or text
+    local outbound = pinfo.p2p_dir == P2P_DIR_SENT
+    local interface = frame_interface()
+    local subtree = tree:add(mecha, tvb(), "PMAP MECHACON test mode")
+
+    interface = interface and interface.value or 0
+
+    pinfo.cols.protocol = "MECHA"
+    subtree:add(f_direction, outbound and 0 or 1):set_generated()
+
+    if outbound then
+        local code = tonumber(body:sub(1, 3), 16)
+
+        if code == nil then
+            pinfo.cols.info = "Command " .. body
+            return len
+        end
+
+        subtree:add(f_command, tvb(0, 3), code)
+        if #body > 3 then
+            subtree:add(f_args, tvb(3, #body - 3))
+        end
+        if not pinfo.visited then
+            local queue = fifo(interface)
+            queue.last = queue.last + 1
+            queue[queue.last] = {number = pinfo.number, code = code, time = pinfo.abs_ts}
+        end
+        pinfo.cols.info = string.format("%s (%03x) %s", command_name(code), code, body:sub(4))
+    else
+        if not pinfo.visited then
+            local queue = fifo(interface)
+            if queue.first <= queue.last then
+                requests[pinfo.number] = queue[queue.first]
+                queue[queue.first] = nil
+                queue.first = queue.first + 1
+            end
+        end
+
+        local request = requests[pinfo.number]
+        if request ~= nil then
+            local elapsed = pinfo.abs_ts - request.time
+            local seconds = math.floor(elapsed)
+
+            subtree:add(f_request, request.number):set_generated()
+            subtree:add(f_time, NSTime.new(seconds, math.floor((elapsed - seconds) * 1e9 + 0.5))):set_generated()
+        end
+
+        if #body > 0 then
+            local status = subtree:add(f_status, tvb(0, 1))
+            if body:sub(1, 1) ~= "0" then
+                status:add_proto_expert_info(e_status)
+            end
+            if #body > 1 then
+                subtree:add(f_data, tvb(1, #body - 1))
+            end
+        end
+        pinfo.cols.info = string.format("%s response %s", request and command_name(request.code) or "Unmatched", body)
+    end
+
+    local item = subtree:add(f_terminated, terminated):set_generated()
+    if not terminated then
+        item:add_proto_expert_info(e_unterminated)
+    end
+
+    return len
+end
+
+local encaps = wtap_encaps or wtap
+DissectorTable.get("wtap_encap"):add(encaps.USER0, mecha)